@@ -22,6 +22,10 @@
 #define ZoneNameV(x,y,z)
 #define ZoneValue(x)
 #define ZoneValueV(x,y)
+#define ZoneFlowOut(x)
+#define ZoneFlowOutV(x,y)
+#define ZoneFlowIn(x)
+#define ZoneFlowInV(x,y)
 
 #define FrameMark
 #define FrameMarkNamed(x)
@@ -29,6 +33,10 @@
 #define FrameMarkEnd(x)
 
 #define FrameImage(x,y,z,w,a)
+#define TracyFrameRetention(x,y,z)
+
+#define TracyStartCapture
+#define TracyStopCapture
 
 #define TracyLockable( type, varname ) type varname;
 #define TracyLockableN( type, varname, desc ) type varname;
@@ -39,9 +47,22 @@
 #define LockMark(x) (void)x;
 #define LockableName(x,y,z);
 
+#define TracyConditionVariable( type, varname ) type varname;
+#define TracyConditionVariableN( type, varname, desc ) type varname;
+#define TracySemaphore( type, varname, count ) type varname { count };
+#define TracySemaphoreN( type, varname, count, desc ) type varname { count };
+#define TracyWaitable(x)
+#define TracyWaitableN(x,y)
+#define TracyWaitScope(x)
+#define TracyWaitNotify(x,y)
+
 #define TracyPlot(x,y)
 #define TracyPlotConfig(x,y)
 
+#define TracyCounter(x)
+#define TracyCounterAdd(x,y)
+#define TracyHistogram(x,y)
+
 #define TracyMessage(x,y)
 #define TracyMessageL(x)
 #define TracyMessageC(x,y,z)
@@ -50,6 +71,8 @@
 
 #define TracyAlloc(x,y)
 #define TracyFree(x)
+#define TracyAllocN(x,y,z)
+#define TracyFreeN(x,y)
 
 #define ZoneNamedS(x,y,z)
 #define ZoneNamedNS(x,y,z,w)
@@ -63,6 +86,8 @@
 
 #define TracyAllocS(x,y,z)
 #define TracyFreeS(x,y)
+#define TracyAllocNS(x,y,z,w)
+#define TracyFreeNS(x,y,z)
 
 #define TracyMessageS(x,y,z)
 #define TracyMessageLS(x,y)
@@ -74,9 +99,11 @@
 
 #else
 
+#include "client/TracyCounter.hpp"
 #include "client/TracyLock.hpp"
 #include "client/TracyProfiler.hpp"
 #include "client/TracyScoped.hpp"
+#include "client/TracyWait.hpp"
 
 #if defined TRACY_HAS_CALLSTACK && defined TRACY_CALLSTACK
 #  define ZoneNamed( varname, active ) static const tracy::SourceLocationData TracyConcat(__tracy_source_location,__LINE__) { nullptr, __FUNCTION__,  __FILE__, (uint32_t)__LINE__, 0 }; tracy::ScopedZone varname( &TracyConcat(__tracy_source_location,__LINE__), TRACY_CALLSTACK, active );
@@ -101,6 +128,10 @@
 #define ZoneNameV( varname, txt, size ) varname.Name( txt, size );
 #define ZoneValue( value ) ___tracy_scoped_zone.Value( value );
 #define ZoneValueV( varname, value ) varname.Value( value );
+#define ZoneFlowOut( id ) ___tracy_scoped_zone.FlowOut( id );
+#define ZoneFlowOutV( varname, id ) varname.FlowOut( id );
+#define ZoneFlowIn( id ) ___tracy_scoped_zone.FlowIn( id );
+#define ZoneFlowInV( varname, id ) varname.FlowIn( id );
 
 #define FrameMark tracy::Profiler::SendFrameMark( nullptr );
 #define FrameMarkNamed( name ) tracy::Profiler::SendFrameMark( name );
@@ -108,6 +139,10 @@
 #define FrameMarkEnd( name ) tracy::Profiler::SendFrameMark( name, tracy::QueueType::FrameMarkMsgEnd );
 
 #define FrameImage( image, width, height, offset, flip ) tracy::Profiler::SendFrameImage( image, width, height, offset, flip );
+#define TracyFrameRetention( name, threshold, keepEvery ) tracy::Profiler::SetFrameRetention( name, threshold, keepEvery );
+
+#define TracyStartCapture tracy::Profiler::StartCapture();
+#define TracyStopCapture tracy::Profiler::StopCapture();
 
 #define TracyLockable( type, varname ) tracy::Lockable<type> varname { [] () -> const tracy::SourceLocationData* { static const tracy::SourceLocationData srcloc { nullptr, #type " " #varname, __FILE__, __LINE__, 0 }; return &srcloc; }() };
 #define TracyLockableN( type, varname, desc ) tracy::Lockable<type> varname { [] () -> const tracy::SourceLocationData* { static const tracy::SourceLocationData srcloc { nullptr, desc, __FILE__, __LINE__, 0 }; return &srcloc; }() };
@@ -118,9 +153,22 @@
 #define LockMark( varname ) static const tracy::SourceLocationData __tracy_lock_location_##varname { nullptr, __FUNCTION__,  __FILE__, (uint32_t)__LINE__, 0 }; varname.Mark( &__tracy_lock_location_##varname );
 #define LockableName( varname, txt, size ) varname.CustomName( txt, size );
 
+#define TracyConditionVariable( type, varname ) tracy::ConditionVariable<type> varname { [] () -> const tracy::SourceLocationData* { static const tracy::SourceLocationData srcloc { nullptr, #type " " #varname, __FILE__, __LINE__, 0 }; return &srcloc; }() };
+#define TracyConditionVariableN( type, varname, desc ) tracy::ConditionVariable<type> varname { [] () -> const tracy::SourceLocationData* { static const tracy::SourceLocationData srcloc { nullptr, desc, __FILE__, __LINE__, 0 }; return &srcloc; }() };
+#define TracySemaphore( type, varname, count ) tracy::Semaphore<type> varname { [] () -> const tracy::SourceLocationData* { static const tracy::SourceLocationData srcloc { nullptr, #type " " #varname, __FILE__, __LINE__, 0 }; return &srcloc; }(), count };
+#define TracySemaphoreN( type, varname, count, desc ) tracy::Semaphore<type> varname { [] () -> const tracy::SourceLocationData* { static const tracy::SourceLocationData srcloc { nullptr, desc, __FILE__, __LINE__, 0 }; return &srcloc; }(), count };
+#define TracyWaitable( varname ) tracy::WaitableCtx varname { [] () -> const tracy::SourceLocationData* { static const tracy::SourceLocationData srcloc { nullptr, #varname, __FILE__, __LINE__, 0 }; return &srcloc; }(), tracy::WaitType::Futex };
+#define TracyWaitableN( varname, desc ) tracy::WaitableCtx varname { [] () -> const tracy::SourceLocationData* { static const tracy::SourceLocationData srcloc { nullptr, desc, __FILE__, __LINE__, 0 }; return &srcloc; }(), tracy::WaitType::Futex };
+#define TracyWaitScope( varname ) tracy::ScopedWait TracyConcat(__tracy_scoped_wait,__LINE__)( varname );
+#define TracyWaitNotify( varname, count ) varname.Notify( count );
+
 #define TracyPlot( name, val ) tracy::Profiler::PlotData( name, val );
 #define TracyPlotConfig( name, type ) tracy::Profiler::ConfigurePlot( name, type );
 
+#define TracyCounter( name ) TracyCounterAdd( name, 1 )
+#define TracyCounterAdd( name, val ) { static tracy::Counter TracyConcat(__tracy_counter,__LINE__) { name }; TracyConcat(__tracy_counter,__LINE__).Add( val ); }
+#define TracyHistogram( name, val ) { static tracy::Histogram TracyConcat(__tracy_histogram,__LINE__) { name }; TracyConcat(__tracy_histogram,__LINE__).Add( val ); }
+
 #define TracyAppInfo( txt, size ) tracy::Profiler::MessageAppInfo( txt, size );
 
 #if defined TRACY_HAS_CALLSTACK && defined TRACY_CALLSTACK
@@ -131,6 +179,8 @@
 
 #  define TracyAlloc( ptr, size ) tracy::Profiler::MemAllocCallstack( ptr, size, TRACY_CALLSTACK );
 #  define TracyFree( ptr ) tracy::Profiler::MemFreeCallstack( ptr, TRACY_CALLSTACK );
+#  define TracyAllocN( ptr, size, name ) tracy::Profiler::MemAllocCallstack( ptr, size, TRACY_CALLSTACK, name );
+#  define TracyFreeN( ptr, name ) tracy::Profiler::MemFreeCallstack( ptr, TRACY_CALLSTACK, name );
 #else
 #  define TracyMessage( txt, size ) tracy::Profiler::Message( txt, size, 0 );
 #  define TracyMessageL( txt ) tracy::Profiler::Message( txt, 0 );
@@ -139,6 +189,8 @@
 
 #  define TracyAlloc( ptr, size ) tracy::Profiler::MemAlloc( ptr, size );
 #  define TracyFree( ptr ) tracy::Profiler::MemFree( ptr );
+#  define TracyAllocN( ptr, size, name ) tracy::Profiler::MemAlloc( ptr, size, name );
+#  define TracyFreeN( ptr, name ) tracy::Profiler::MemFree( ptr, name );
 #endif
 
 #ifdef TRACY_HAS_CALLSTACK
@@ -154,6 +206,8 @@
 
 #  define TracyAllocS( ptr, size, depth ) tracy::Profiler::MemAllocCallstack( ptr, size, depth );
 #  define TracyFreeS( ptr, depth ) tracy::Profiler::MemFreeCallstack( ptr, depth );
+#  define TracyAllocNS( ptr, size, depth, name ) tracy::Profiler::MemAllocCallstack( ptr, size, depth, name );
+#  define TracyFreeNS( ptr, depth, name ) tracy::Profiler::MemFreeCallstack( ptr, depth, name );
 
 #  define TracyMessageS( txt, size, depth ) tracy::Profiler::Message( txt, size, depth );
 #  define TracyMessageLS( txt, depth ) tracy::Profiler::Message( txt, depth );
@@ -172,6 +226,8 @@
 
 #  define TracyAllocS( ptr, size, depth ) TracyAlloc( ptr, size )
 #  define TracyFreeS( ptr, depth ) TracyFree( ptr )
+#  define TracyAllocNS( ptr, size, depth, name ) TracyAllocN( ptr, size, name )
+#  define TracyFreeNS( ptr, depth, name ) TracyFreeN( ptr, name )
 
 #  define TracyMessageS( txt, size, depth ) TracyMessage( txt, size )
 #  define TracyMessageLS( txt, depth ) TracyMessageL( txt )
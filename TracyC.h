@@ -11,6 +11,35 @@
 extern "C" {
 #endif
 
+struct ___tracy_source_location_data
+{
+    const char* name;
+    const char* function;
+    const char* file;
+    uint32_t line;
+    uint32_t color;
+};
+
+enum ___tracy_bulk_event_type
+{
+    TracyCBulkZoneBegin,
+    TracyCBulkZoneEnd,
+    TracyCBulkMessage,
+    TracyCBulkPlot
+};
+
+// Event record for TracyCEmitBulk. Times are in the units of TracyCGetTime.
+struct ___tracy_bulk_event
+{
+    int64_t time;
+    uint32_t type;                                          // ___tracy_bulk_event_type
+    uint32_t color;                                         // message color, 0 for none
+    const struct ___tracy_source_location_data* srcloc;     // zone begin, must stay valid
+    const char* text;                                       // message text (copied) or plot name (must stay valid)
+    size_t size;                                            // message text length
+    double value;                                           // plot value
+};
+
 #ifndef TRACY_ENABLE
 
 typedef const void* TracyCZoneCtx;
@@ -23,15 +52,23 @@ typedef const void* TracyCZoneCtx;
 #define TracyCZoneText(c,x,y)
 #define TracyCZoneName(c,x,y)
 #define TracyCZoneValue(c,x)
+#define TracyCZoneFlowOut(c,x)
+#define TracyCZoneFlowIn(c,x)
 
 #define TracyCAlloc(x,y)
 #define TracyCFree(x)
+#define TracyCAllocN(x,y,z)
+#define TracyCFreeN(x,y)
 
 #define TracyCFrameMark
 #define TracyCFrameMarkNamed(x)
 #define TracyCFrameMarkStart(x)
 #define TracyCFrameMarkEnd(x)
 #define TracyCFrameImage(x,y,z,w,a)
+#define TracyCFrameRetention(x,y,z)
+
+#define TracyCStartCapture
+#define TracyCStopCapture
 
 #define TracyCPlot(x,y)
 #define TracyCMessage(x,y)
@@ -47,12 +84,18 @@ typedef const void* TracyCZoneCtx;
 
 #define TracyCAllocS(x,y,z)
 #define TracyCFreeS(x,y)
+#define TracyCAllocNS(x,y,z,w)
+#define TracyCFreeNS(x,y,z)
 
 #define TracyCMessageS(x,y,z)
 #define TracyCMessageLS(x,y)
 #define TracyCMessageCS(x,y,z,w)
 #define TracyCMessageLCS(x,y,z)
 
+#define TracyCGetTime() 0
+#define TracyCEmitBulk(x,y)
+#define TracyCEmitBulkThread(x,y,z)
+
 #else
 
 #ifndef TracyConcat
@@ -62,15 +105,6 @@ typedef const void* TracyCZoneCtx;
 #  define TracyConcatIndirect(x,y) x##y
 #endif
 
-struct ___tracy_source_location_data
-{
-    const char* name;
-    const char* function;
-    const char* file;
-    uint32_t line;
-    uint32_t color;
-};
-
 struct ___tracy_c_zone_context
 {
     uint32_t id;
@@ -92,6 +126,8 @@ TRACY_API void ___tracy_emit_zone_end( TracyCZoneCtx ctx );
 TRACY_API void ___tracy_emit_zone_text( TracyCZoneCtx ctx, const char* txt, size_t size );
 TRACY_API void ___tracy_emit_zone_name( TracyCZoneCtx ctx, const char* txt, size_t size );
 TRACY_API void ___tracy_emit_zone_value( TracyCZoneCtx ctx, uint64_t value );
+TRACY_API void ___tracy_emit_zone_flow_out( TracyCZoneCtx ctx, uint64_t id );
+TRACY_API void ___tracy_emit_zone_flow_in( TracyCZoneCtx ctx, uint64_t id );
 
 #if defined TRACY_HAS_CALLSTACK && defined TRACY_CALLSTACK
 #  define TracyCZone( ctx, active ) static const struct ___tracy_source_location_data TracyConcat(__tracy_source_location,__LINE__) = { NULL, __FUNCTION__,  __FILE__, (uint32_t)__LINE__, 0 }; TracyCZoneCtx ctx = ___tracy_emit_zone_begin_callstack( &TracyConcat(__tracy_source_location,__LINE__), TRACY_CALLSTACK, active );
@@ -110,12 +146,18 @@ TRACY_API void ___tracy_emit_zone_value( TracyCZoneCtx ctx, uint64_t value );
 #define TracyCZoneText( ctx, txt, size ) ___tracy_emit_zone_text( ctx, txt, size );
 #define TracyCZoneName( ctx, txt, size ) ___tracy_emit_zone_name( ctx, txt, size );
 #define TracyCZoneValue( ctx, value ) ___tracy_emit_zone_value( ctx, value );
+#define TracyCZoneFlowOut( ctx, id ) ___tracy_emit_zone_flow_out( ctx, id );
+#define TracyCZoneFlowIn( ctx, id ) ___tracy_emit_zone_flow_in( ctx, id );
 
 
 TRACY_API void ___tracy_emit_memory_alloc( const void* ptr, size_t size );
 TRACY_API void ___tracy_emit_memory_alloc_callstack( const void* ptr, size_t size, int depth );
 TRACY_API void ___tracy_emit_memory_free( const void* ptr );
 TRACY_API void ___tracy_emit_memory_free_callstack( const void* ptr, int depth );
+TRACY_API void ___tracy_emit_memory_alloc_named( const void* ptr, size_t size, const char* name );
+TRACY_API void ___tracy_emit_memory_alloc_callstack_named( const void* ptr, size_t size, int depth, const char* name );
+TRACY_API void ___tracy_emit_memory_free_named( const void* ptr, const char* name );
+TRACY_API void ___tracy_emit_memory_free_callstack_named( const void* ptr, int depth, const char* name );
 
 TRACY_API void ___tracy_emit_message( const char* txt, size_t size, int callstack );
 TRACY_API void ___tracy_emit_messageL( const char* txt, int callstack );
@@ -125,6 +167,8 @@ TRACY_API void ___tracy_emit_messageLC( const char* txt, uint32_t color, int cal
 #if defined TRACY_HAS_CALLSTACK && defined TRACY_CALLSTACK
 #  define TracyCAlloc( ptr, size ) ___tracy_emit_memory_alloc_callstack( ptr, size, TRACY_CALLSTACK )
 #  define TracyCFree( ptr ) ___tracy_emit_memory_free_callstack( ptr, TRACY_CALLSTACK )
+#  define TracyCAllocN( ptr, size, name ) ___tracy_emit_memory_alloc_callstack_named( ptr, size, TRACY_CALLSTACK, name )
+#  define TracyCFreeN( ptr, name ) ___tracy_emit_memory_free_callstack_named( ptr, TRACY_CALLSTACK, name )
 
 #  define TracyCMessage( txt, size ) ___tracy_emit_message( txt, size, TRACY_CALLSTACK );
 #  define TracyCMessageL( txt ) ___tracy_emit_messageL( txt, TRACY_CALLSTACK );
@@ -133,6 +177,8 @@ TRACY_API void ___tracy_emit_messageLC( const char* txt, uint32_t color, int cal
 #else
 #  define TracyCAlloc( ptr, size ) ___tracy_emit_memory_alloc( ptr, size );
 #  define TracyCFree( ptr ) ___tracy_emit_memory_free( ptr );
+#  define TracyCAllocN( ptr, size, name ) ___tracy_emit_memory_alloc_named( ptr, size, name );
+#  define TracyCFreeN( ptr, name ) ___tracy_emit_memory_free_named( ptr, name );
 
 #  define TracyCMessage( txt, size ) ___tracy_emit_message( txt, size, 0 );
 #  define TracyCMessageL( txt ) ___tracy_emit_messageL( txt, 0 );
@@ -145,12 +191,19 @@ TRACY_API void ___tracy_emit_frame_mark( const char* name );
 TRACY_API void ___tracy_emit_frame_mark_start( const char* name );
 TRACY_API void ___tracy_emit_frame_mark_end( const char* name );
 TRACY_API void ___tracy_emit_frame_image( const void* image, uint16_t w, uint16_t h, uint8_t offset, int flip );
+TRACY_API void ___tracy_set_frame_retention( const char* name, uint64_t threshold, uint32_t keepEvery );
+TRACY_API void ___tracy_start_capture();
+TRACY_API void ___tracy_stop_capture();
 
 #define TracyCFrameMark ___tracy_emit_frame_mark( 0 );
 #define TracyCFrameMarkNamed( name ) ___tracy_emit_frame_mark( name );
 #define TracyCFrameMarkStart( name ) ___tracy_emit_frame_mark_start( name );
 #define TracyCFrameMarkEnd( name ) ___tracy_emit_frame_mark_end( name );
 #define TracyCFrameImage( image, width, height, offset, flip ) ___tracy_emit_frame_image( image, width, height, offset, flip );
+#define TracyCFrameRetention( name, threshold, keepEvery ) ___tracy_set_frame_retention( name, threshold, keepEvery );
+
+#define TracyCStartCapture ___tracy_start_capture();
+#define TracyCStopCapture ___tracy_stop_capture();
 
 
 TRACY_API void ___tracy_emit_plot( const char* name, double val );
@@ -160,6 +213,14 @@ TRACY_API void ___tracy_emit_message_appinfo( const char* txt, size_t size );
 #define TracyCAppInfo( txt, color ) ___tracy_emit_message_appinfo( txt, color );
 
 
+TRACY_API int64_t ___tracy_get_time( void );
+TRACY_API int ___tracy_emit_bulk( const struct ___tracy_bulk_event* events, size_t count, uint64_t thread );
+
+#define TracyCGetTime() ___tracy_get_time()
+#define TracyCEmitBulk( events, count ) ___tracy_emit_bulk( events, count, 0 );
+#define TracyCEmitBulkThread( events, count, thread ) ___tracy_emit_bulk( events, count, thread );
+
+
 #ifdef TRACY_HAS_CALLSTACK
 #  define TracyCZoneS( ctx, depth, active ) static const struct ___tracy_source_location_data TracyConcat(__tracy_source_location,__LINE__) = { NULL, __FUNCTION__,  __FILE__, (uint32_t)__LINE__, 0 }; TracyCZoneCtx ctx = ___tracy_emit_zone_begin_callstack( &TracyConcat(__tracy_source_location,__LINE__), depth, active );
 #  define TracyCZoneNS( ctx, name, depth, active ) static const struct ___tracy_source_location_data TracyConcat(__tracy_source_location,__LINE__) = { name, __FUNCTION__,  __FILE__, (uint32_t)__LINE__, 0 }; TracyCZoneCtx ctx = ___tracy_emit_zone_begin_callstack( &TracyConcat(__tracy_source_location,__LINE__), depth, active );
@@ -168,6 +229,8 @@ TRACY_API void ___tracy_emit_message_appinfo( const char* txt, size_t size );
 
 #  define TracyCAllocS( ptr, size, depth ) ___tracy_emit_memory_alloc_callstack( ptr, size, depth )
 #  define TracyCFreeS( ptr, depth ) ___tracy_emit_memory_free_callstack( ptr, depth )
+#  define TracyCAllocNS( ptr, size, depth, name ) ___tracy_emit_memory_alloc_callstack_named( ptr, size, depth, name )
+#  define TracyCFreeNS( ptr, depth, name ) ___tracy_emit_memory_free_callstack_named( ptr, depth, name )
 
 #  define TracyCMessageS( txt, size, depth ) ___tracy_emit_message( txt, size, depth );
 #  define TracyCMessageLS( txt, depth ) ___tracy_emit_messageL( txt, depth );
@@ -181,6 +244,8 @@ TRACY_API void ___tracy_emit_message_appinfo( const char* txt, size_t size );
 
 #  define TracyCAllocS( ptr, size, depth ) TracyCAlloc( ptr, size )
 #  define TracyCFreeS( ptr, depth ) TracyCFree( ptr )
+#  define TracyCAllocNS( ptr, size, depth, name ) TracyCAllocN( ptr, size, name )
+#  define TracyCFreeNS( ptr, depth, name ) TracyCFreeN( ptr, name )
 
 #  define TracyCMessageS( txt, size, depth ) TracyCMessage( txt, size )
 #  define TracyCMessageLS( txt, depth ) TracyCMessageL( txt )
@@ -0,0 +1,143 @@
+#ifndef __TRACYDEVICE_HPP__
+#define __TRACYDEVICE_HPP__
+
+#if !defined TRACY_ENABLE
+
+#define TracyDeviceContext(x,y,z) nullptr
+#define TracyDeviceDestroy(x)
+#define TracyDeviceZoneBegin(c,x,y)
+#define TracyDeviceZoneBeginC(c,x,y,z)
+#define TracyDeviceZoneEnd(c,x)
+#define TracyDeviceZone(c,x,y,z)
+#define TracyDeviceZoneC(c,x,y,z,w)
+
+using TracyDeviceCtx = void*;
+
+#else
+
+#include <assert.h>
+#include <stdlib.h>
+#include "Tracy.hpp"
+#include "client/TracyProfiler.hpp"
+
+namespace tracy
+{
+
+// Timeline of a device with its own clock, for example an offload engine. Zones are sent with
+// raw device timestamps, which the server converts to the profiler time base using the
+// calibration pair given at creation: the profiler time (Profiler::GetTime) and the device
+// timestamp taken at the same moment. The period is the length of a device clock tick in
+// nanoseconds. A context must not be used from more than one thread at a time.
+class DeviceCtx
+{
+public:
+    DeviceCtx( int64_t cpuTime, int64_t deviceTime, float period )
+        : m_context( GetGpuCtxCounter().fetch_add( 1, std::memory_order_relaxed ) )
+#ifdef TRACY_ON_DEMAND
+        , m_depth( 0 )
+        , m_active( false )
+#endif
+    {
+        assert( m_context != 255 );
+
+        auto item = Profiler::QueueSerial();
+        MemWrite( &item->hdr.type, QueueType::GpuNewContext );
+        MemWrite( &item->gpuNewContext.cpuTime, cpuTime );
+        MemWrite( &item->gpuNewContext.gpuTime, deviceTime );
+        MemWrite( &item->gpuNewContext.thread, GetThreadHandle() );
+        MemWrite( &item->gpuNewContext.period, period );
+        MemWrite( &item->gpuNewContext.context, m_context );
+        MemWrite( &item->gpuNewContext.accuracyBits, uint8_t( 0 ) );
+        MemWrite( &item->gpuNewContext.type, GpuContextType::Device );
+
+#ifdef TRACY_ON_DEMAND
+        GetProfiler().DeferItem( *item );
+#endif
+        Profiler::QueueSerialFinish();
+    }
+
+    tracy_force_inline void ZoneBegin( const SourceLocationData* srcloc, int64_t deviceTime )
+    {
+#ifdef TRACY_ON_DEMAND
+        // Decided at the outermost zone, so that the begin and end events always match.
+        if( m_depth++ == 0 ) m_active = GetProfiler().IsConnected();
+        if( !m_active ) return;
+#endif
+        auto item = Profiler::QueueSerial();
+        MemWrite( &item->hdr.type, QueueType::GpuZoneBeginSerial );
+        MemWrite( &item->gpuZoneBegin.cpuTime, Profiler::GetTime() );
+        MemWrite( &item->gpuZoneBegin.srcloc, (uint64_t)srcloc );
+        memset( &item->gpuZoneBegin.thread, 0, sizeof( item->gpuZoneBegin.thread ) );
+        MemWrite( &item->gpuZoneBegin.queryId, uint16_t( 0 ) );
+        MemWrite( &item->gpuZoneBegin.context, m_context );
+        Profiler::QueueSerialFinish();
+
+        SendTime( deviceTime );
+    }
+
+    tracy_force_inline void ZoneEnd( int64_t deviceTime )
+    {
+#ifdef TRACY_ON_DEMAND
+        assert( m_depth > 0 );
+        m_depth--;
+        if( !m_active ) return;
+#endif
+        auto item = Profiler::QueueSerial();
+        MemWrite( &item->hdr.type, QueueType::GpuZoneEndSerial );
+        MemWrite( &item->gpuZoneEnd.cpuTime, Profiler::GetTime() );
+        memset( &item->gpuZoneEnd.thread, 0, sizeof( item->gpuZoneEnd.thread ) );
+        MemWrite( &item->gpuZoneEnd.queryId, uint16_t( 0 ) );
+        MemWrite( &item->gpuZoneEnd.context, m_context );
+        Profiler::QueueSerialFinish();
+
+        SendTime( deviceTime );
+    }
+
+private:
+    // The timestamp is known right away, so the query slot is freed before it can be used again.
+    tracy_force_inline void SendTime( int64_t deviceTime )
+    {
+        auto item = Profiler::QueueSerial();
+        MemWrite( &item->hdr.type, QueueType::GpuTime );
+        MemWrite( &item->gpuTime.gpuTime, deviceTime );
+        MemWrite( &item->gpuTime.queryId, uint16_t( 0 ) );
+        MemWrite( &item->gpuTime.context, m_context );
+        Profiler::QueueSerialFinish();
+    }
+
+    uint8_t m_context;
+#ifdef TRACY_ON_DEMAND
+    uint32_t m_depth;
+    bool m_active;
+#endif
+};
+
+static inline DeviceCtx* CreateDeviceContext( int64_t cpuTime, int64_t deviceTime, float period )
+{
+    InitRPMallocThread();
+    auto ctx = (DeviceCtx*)tracy_malloc( sizeof( DeviceCtx ) );
+    new(ctx) DeviceCtx( cpuTime, deviceTime, period );
+    return ctx;
+}
+
+static inline void DestroyDeviceContext( DeviceCtx* ctx )
+{
+    ctx->~DeviceCtx();
+    tracy_free( ctx );
+}
+
+}
+
+using TracyDeviceCtx = tracy::DeviceCtx*;
+
+#define TracyDeviceContext( cpuTime, deviceTime, period ) tracy::CreateDeviceContext( cpuTime, deviceTime, period );
+#define TracyDeviceDestroy( ctx ) tracy::DestroyDeviceContext( ctx );
+#define TracyDeviceZoneBegin( ctx, name, deviceTime ) { static const tracy::SourceLocationData TracyConcat(__tracy_device_source_location,__LINE__) { name, __FUNCTION__,  __FILE__, (uint32_t)__LINE__, 0 }; ctx->ZoneBegin( &TracyConcat(__tracy_device_source_location,__LINE__), deviceTime ); }
+#define TracyDeviceZoneBeginC( ctx, name, color, deviceTime ) { static const tracy::SourceLocationData TracyConcat(__tracy_device_source_location,__LINE__) { name, __FUNCTION__,  __FILE__, (uint32_t)__LINE__, color }; ctx->ZoneBegin( &TracyConcat(__tracy_device_source_location,__LINE__), deviceTime ); }
+#define TracyDeviceZoneEnd( ctx, deviceTime ) ctx->ZoneEnd( deviceTime );
+#define TracyDeviceZone( ctx, name, beginTime, endTime ) { TracyDeviceZoneBegin( ctx, name, beginTime ); TracyDeviceZoneEnd( ctx, endTime ); }
+#define TracyDeviceZoneC( ctx, name, color, beginTime, endTime ) { TracyDeviceZoneBeginC( ctx, name, color, beginTime ); TracyDeviceZoneEnd( ctx, endTime ); }
+
+#endif
+
+#endif
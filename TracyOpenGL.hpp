@@ -127,7 +127,7 @@ public:
         if( m_tail == m_head ) return;
 
 #ifdef TRACY_ON_DEMAND
-        if( !GetProfiler().IsConnected() )
+        if( !GetProfiler().IsConnected() && !GetProfiler().IsCaptureSuspended() )
         {
             m_head = m_tail = 0;
             return;
@@ -128,7 +128,7 @@ public:
         if( m_tail == m_head ) return;
 
 #ifdef TRACY_ON_DEMAND
-        if( !GetProfiler().IsConnected() )
+        if( !GetProfiler().IsConnected() && !GetProfiler().IsCaptureSuspended() )
         {
             vkCmdResetQueryPool( cmdbuf, m_query, 0, m_queryCount );
             m_head = m_tail = 0;
@@ -0,0 +1,199 @@
+// Microbenchmark of the client instrumentation primitives. Each primitive is run on an increasing
+// number of threads, and the results are written to the standard output as CSV, one line per
+// primitive and thread count:
+//
+//   primitive,threads,iterations,ns_per_op,mops
+//
+// ns_per_op is the average cost of a single operation as seen by a thread, mops is the total
+// throughput of all threads, in millions of operations per second.
+//
+// The benchmark is built in on-demand mode and waits for a server to connect, for example the
+// capture utility, so that the events are drained by the profiler thread. Each run starts when
+// the events of the previous one have been sent.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "../Tracy.hpp"
+
+#ifndef TRACY_ON_DEMAND
+#  error "The benchmark must be built with TRACY_ON_DEMAND."
+#endif
+
+namespace tracy
+{
+TRACY_API moodycamel::ConcurrentQueue<QueueItem>& GetQueue();
+}
+
+static const char* s_text = "Benchmark text";
+static const size_t s_textLen = strlen( s_text );
+
+enum { ImageSize = 64 };
+static uint8_t s_image[ImageSize*ImageSize*4];
+
+struct Benchmark
+{
+    const char* name;
+    size_t iterations;      // per thread, at scale 1
+    void(*run)( int thread, size_t iterations );
+};
+
+static const Benchmark s_benchmarks[] = {
+    { "Baseline", 1 << 22, []( int, size_t n ) {
+        for( size_t i=0; i<n; i++ ) __asm__ __volatile__( "" ::: "memory" );
+    } },
+    { "ZoneScoped", 1 << 20, []( int, size_t n ) {
+        for( size_t i=0; i<n; i++ ) { ZoneScopedN( "Bench zone" ); }
+    } },
+    { "ZoneScopedS", 1 << 14, []( int, size_t n ) {
+        for( size_t i=0; i<n; i++ ) { ZoneScopedNS( "Bench zone callstack", 16 ); }
+    } },
+    { "ZoneText", 1 << 18, []( int, size_t n ) {
+        for( size_t i=0; i<n; i++ ) { ZoneScopedN( "Bench zone text" ); ZoneText( s_text, s_textLen ); }
+    } },
+    { "TracyPlot", 1 << 20, []( int, size_t n ) {
+        for( size_t i=0; i<n; i++ ) TracyPlot( "Bench plot", int64_t( i ) );
+    } },
+    { "TracyMessage", 1 << 18, []( int, size_t n ) {
+        for( size_t i=0; i<n; i++ ) TracyMessage( s_text, s_textLen );
+    } },
+    { "TracyMessageL", 1 << 20, []( int, size_t n ) {
+        for( size_t i=0; i<n; i++ ) TracyMessageL( "Bench message" );
+    } },
+    { "TracyAllocFree", 1 << 18, []( int thread, size_t n ) {
+        // The pointers are never dereferenced, they only have to be unique.
+        const auto base = ( uint64_t( thread ) + 1 ) << 40;
+        for( size_t i=0; i<n; i++ )
+        {
+            const auto ptr = (void*)( base + i * 16 );
+            TracyAlloc( ptr, 16 );
+            TracyFree( ptr );
+        }
+    } },
+    { "LockableCtx", 1 << 18, []( int, size_t n ) {
+        // All threads contend for the same lock, which is announced only once.
+        static TracyLockableN( std::mutex, lock, "Bench lock" );
+        for( size_t i=0; i<n; i++ )
+        {
+            lock.lock();
+            lock.unlock();
+        }
+    } },
+    { "FrameMark", 1 << 20, []( int, size_t n ) {
+        for( size_t i=0; i<n; i++ ) { FrameMark; }
+    } },
+    { "FrameImage", 1 << 8, []( int, size_t n ) {
+        for( size_t i=0; i<n; i++ ) { FrameImage( s_image, ImageSize, ImageSize, 0, false ); }
+    } },
+};
+
+static bool IsConnected()
+{
+    return tracy::GetProfiler().IsConnected();
+}
+
+static void WaitForDrain()
+{
+    while( IsConnected() && tracy::GetQueue().size_approx() != 0 ) std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+}
+
+static void Run( const Benchmark& bench, int threads, size_t iterations )
+{
+    // Events are not collected without a server, which would only measure the connection check.
+    WaitForDrain();
+    if( !IsConnected() )
+    {
+        fprintf( stderr, "The server has disconnected.\n" );
+        exit( 1 );
+    }
+    std::atomic<int> ready( 0 );
+    std::atomic<bool> go( false );
+    std::vector<int64_t> time( threads );
+    std::vector<std::thread> pool;
+    for( int t=0; t<threads; t++ )
+    {
+        pool.emplace_back( [&, t] {
+            // The first event of a thread sets up its queue producer, which is not measured.
+            bench.run( t, 1 );
+            ready.fetch_add( 1, std::memory_order_release );
+            while( !go.load( std::memory_order_acquire ) ) std::this_thread::yield();
+            const auto t0 = std::chrono::steady_clock::now();
+            bench.run( t, iterations );
+            const auto t1 = std::chrono::steady_clock::now();
+            time[t] = std::chrono::duration_cast<std::chrono::nanoseconds>( t1 - t0 ).count();
+        } );
+    }
+    while( ready.load( std::memory_order_acquire ) != threads ) std::this_thread::yield();
+    const auto t0 = std::chrono::steady_clock::now();
+    go.store( true, std::memory_order_release );
+    for( auto& v : pool ) v.join();
+    const auto t1 = std::chrono::steady_clock::now();
+    const auto wall = std::chrono::duration_cast<std::chrono::nanoseconds>( t1 - t0 ).count();
+
+    int64_t sum = 0;
+    for( auto& v : time ) sum += v;
+    const auto nsPerOp = double( sum ) / threads / iterations;
+    const auto mops = double( iterations ) * threads * 1000. / std::max<int64_t>( wall, 1 );
+    printf( "%s,%i,%zu,%.2f,%.2f\n", bench.name, threads, iterations, nsPerOp, mops );
+    fflush( stdout );
+}
+
+static void Usage()
+{
+    printf( "Usage: bench [-t max threads] [-s iteration scale] [primitive...]\n" );
+    exit( 1 );
+}
+
+int main( int argc, char** argv )
+{
+    int maxThreads = std::max<int>( 1, std::thread::hardware_concurrency() );
+    double scale = 1;
+    std::vector<const char*> filter;
+    for( int i=1; i<argc; i++ )
+    {
+        if( strcmp( argv[i], "-t" ) == 0 && i+1 < argc )
+        {
+            maxThreads = atoi( argv[++i] );
+            if( maxThreads < 1 ) Usage();
+        }
+        else if( strcmp( argv[i], "-s" ) == 0 && i+1 < argc )
+        {
+            scale = atof( argv[++i] );
+            if( scale <= 0 ) Usage();
+        }
+        else if( argv[i][0] == '-' )
+        {
+            Usage();
+        }
+        else
+        {
+            filter.push_back( argv[i] );
+        }
+    }
+
+    for( size_t i=0; i<sizeof( s_image ); i++ ) s_image[i] = uint8_t( i * 7 );
+
+    fprintf( stderr, "Waiting for a server to connect...\n" );
+    while( !IsConnected() ) std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+
+    printf( "primitive,threads,iterations,ns_per_op,mops\n" );
+    for( auto& bench : s_benchmarks )
+    {
+        if( !filter.empty() && std::none_of( filter.begin(), filter.end(), [&bench]( const char* f ) { return strcmp( f, bench.name ) == 0; } ) ) continue;
+        const auto iterations = std::max<size_t>( 1, size_t( bench.iterations * scale ) );
+        for( int threads=1; threads<=maxThreads; threads*=2 )
+        {
+            Run( bench, threads, iterations );
+            if( threads < maxThreads && threads*2 > maxThreads ) Run( bench, maxThreads, iterations );
+        }
+    }
+    WaitForDrain();
+}
@@ -2,15 +2,20 @@
 #  include <windows.h>
 #endif
 
+#include <algorithm>
 #include <chrono>
 #include <inttypes.h>
+#include <memory>
 #include <mutex>
 #include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string>
+#include <vector>
 
 #include "../../common/TracyProtocol.hpp"
+#include "../../common/TracySocket.hpp"
 #include "../../server/TracyFileWrite.hpp"
 #include "../../server/TracyMemory.hpp"
 #include "../../server/TracyPrint.hpp"
@@ -20,6 +25,13 @@
 
 bool disconnect = false;
 
+struct Child
+{
+    std::unique_ptr<tracy::Worker> worker;
+    uint64_t pid;
+    std::chrono::high_resolution_clock::time_point start;
+};
+
 void SigInt( int )
 {
     disconnect = true;
@@ -27,10 +39,75 @@ void SigInt( int )
 
 void Usage()
 {
-    printf( "Usage: capture -o output.tracy [-a address] [-p port]\n" );
+    printf( "Usage: capture -o output.tracy [-a address] [-p port] [-f] [-b port] [-r stream]\n" );
+    printf( "  -f: also capture processes forked from the client, each to output.<pid>.tracy\n" );
+    printf( "  -b: port on which the client broadcasts its presence, used with -f (default: -p port)\n" );
+    printf( "  -r: record the received event stream, to be played back with the replay utility\n" );
     exit( 1 );
 }
 
+std::string ChildOutputName( const char* output, uint64_t pid )
+{
+    std::string name( output );
+    const auto ext = name.rfind( '.' );
+    const auto sep = name.find_last_of( "/\\" );
+    const auto suffix = "." + std::to_string( pid );
+    if( ext == std::string::npos || ( sep != std::string::npos && ext < sep ) )
+    {
+        name += suffix;
+    }
+    else
+    {
+        name.insert( ext, suffix );
+    }
+    return name;
+}
+
+// Children announce themselves through the same UDP broadcast which is used for client discovery.
+void FollowChildren( tracy::UdpListen& broadcastListen, std::vector<uint64_t>& pids, std::vector<Child>& children, const char* address )
+{
+    tracy::IpAddress addr;
+    size_t len;
+    while( auto msg = broadcastListen.Read( len, addr ) )
+    {
+        if( len > sizeof( tracy::BroadcastMessage ) ) continue;
+        tracy::BroadcastMessage bm;
+        memcpy( &bm, msg, len );
+        if( bm.broadcastVersion != tracy::BroadcastVersion || bm.protocolVersion != tracy::ProtocolVersion ) continue;
+        if( std::find( pids.begin(), pids.end(), bm.parentPid ) == pids.end() ) continue;
+        if( std::find( pids.begin(), pids.end(), bm.pid ) != pids.end() ) continue;
+
+        printf( "\33[2K\rFollowing process %" PRIu64 " (forked from %" PRIu64 ") on port %u\n", bm.pid, bm.parentPid, bm.listenPort );
+        pids.emplace_back( bm.pid );
+        children.emplace_back( Child { std::make_unique<tracy::Worker>( address, bm.listenPort ), bm.pid, std::chrono::high_resolution_clock::now() } );
+    }
+}
+
+bool IsChildActive( const Child& child )
+{
+    if( child.worker->IsConnected() ) return true;
+    // The child may have exited before it could be connected to.
+    return !child.worker->HasData() && child.worker->GetHandshakeStatus() == tracy::HandshakePending &&
+        std::chrono::high_resolution_clock::now() - child.start < std::chrono::seconds( 10 );
+}
+
+void SaveTrace( tracy::Worker& worker, const char* output )
+{
+    auto f = std::unique_ptr<tracy::FileWrite>( tracy::FileWrite::Open( output ) );
+    if( f )
+    {
+        worker.Write( *f );
+        printf( " \033[32;1mdone!\033[0m\n" );
+        f->Finish();
+        const auto stats = f->GetCompressionStatistics();
+        printf( "Trace size %s (%.2f%% ratio)\n", tracy::MemSizeToString( stats.second ), 100.f * stats.second / stats.first );
+    }
+    else
+    {
+        printf( " \033[31;1failed!\033[0m\n" );
+    }
+}
+
 int main( int argc, char** argv )
 {
 #ifdef _WIN32
@@ -43,10 +120,13 @@ int main( int argc, char** argv )
 
     const char* address = "localhost";
     const char* output = nullptr;
+    const char* record = nullptr;
     int port = 8086;
+    int broadcastPort = -1;
+    bool follow = false;
 
     int c;
-    while( ( c = getopt( argc, argv, "a:o:p:" ) ) != -1 )
+    while( ( c = getopt( argc, argv, "a:o:p:fb:r:" ) ) != -1 )
     {
         switch( c )
         {
@@ -59,6 +139,15 @@ int main( int argc, char** argv )
         case 'p':
             port = atoi( optarg );
             break;
+        case 'f':
+            follow = true;
+            break;
+        case 'b':
+            broadcastPort = atoi( optarg );
+            break;
+        case 'r':
+            record = optarg;
+            break;
         default:
             Usage();
             break;
@@ -66,10 +155,23 @@ int main( int argc, char** argv )
     }
 
     if( !address || !output ) Usage();
+    // Clients broadcast on their listening port, unless built with a different TRACY_BROADCAST_PORT.
+    if( broadcastPort < 0 ) broadcastPort = port;
+
+    std::unique_ptr<tracy::FileWrite> recording;
+    if( record )
+    {
+        recording.reset( tracy::FileWrite::Open( record ) );
+        if( !recording )
+        {
+            printf( "Cannot open %s for writing.\n", record );
+            return 4;
+        }
+    }
 
     printf( "Connecting to %s:%i...", address, port );
     fflush( stdout );
-    tracy::Worker worker( address, port );
+    tracy::Worker worker( address, port, recording.get() );
     while( !worker.IsConnected() )
     {
         const auto handshake = worker.GetHandshakeStatus();
@@ -101,16 +203,28 @@ int main( int argc, char** argv )
     sigaction( SIGINT, &sigint, &oldsigint );
 #endif
 
+    std::vector<uint64_t> pids { worker.GetPid() };
+    std::vector<Child> children;
+    tracy::UdpListen broadcastListen;
+    if( follow && !broadcastListen.Listen( broadcastPort ) )
+    {
+        printf( "\033[31;1mCannot listen for broadcasts, forked processes won't be captured.\033[0m\n" );
+        follow = false;
+    }
+
     auto& lock = worker.GetMbpsDataLock();
 
     const auto t0 = std::chrono::high_resolution_clock::now();
-    while( worker.IsConnected() )
+    while( worker.IsConnected() || std::any_of( children.begin(), children.end(), IsChildActive ) )
     {
         if( disconnect )
         {
             worker.Disconnect();
+            for( auto& child : children ) child.worker->Disconnect();
+            follow = false;
             disconnect = false;
         }
+        if( follow ) FollowChildren( broadcastListen, pids, children, address );
 
         lock.lock();
         const auto mbps = worker.GetMbpsData().back();
@@ -132,11 +246,13 @@ int main( int argc, char** argv )
             tracy::MemSizeToString( netTotal ),
             tracy::MemSizeToString( tracy::memUsage ),
             tracy::TimeToString( worker.GetLastTime() ) );
+        if( !children.empty() ) printf( " | \033[33mChildren: %zu\033[0m", children.size() );
         fflush( stdout );
 
         std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
     }
     const auto t1 = std::chrono::high_resolution_clock::now();
+    if( recording ) recording->Finish();
 
     const auto& failure = worker.GetFailureType();
     if( failure != tracy::Worker::Failure::None )
@@ -148,18 +264,15 @@ int main( int argc, char** argv )
         worker.GetFrameCount( *worker.GetFramesBase() ), tracy::TimeToString( worker.GetLastTime() ), tracy::RealToString( worker.GetZoneCount() ),
         tracy::TimeToString( std::chrono::duration_cast<std::chrono::nanoseconds>( t1 - t0 ).count() ) );
     fflush( stdout );
-    auto f = std::unique_ptr<tracy::FileWrite>( tracy::FileWrite::Open( output ) );
-    if( f )
-    {
-        worker.Write( *f );
-        printf( " \033[32;1mdone!\033[0m\n" );
-        f->Finish();
-        const auto stats = f->GetCompressionStatistics();
-        printf( "Trace size %s (%.2f%% ratio)\n", tracy::MemSizeToString( stats.second ), 100.f * stats.second / stats.first );
-    }
-    else
+    SaveTrace( worker, output );
+
+    for( auto& child : children )
     {
-        printf( " \033[31;1failed!\033[0m\n" );
+        if( !child.worker->HasData() ) continue;
+        const auto childOutput = ChildOutputName( output, child.pid );
+        printf( "Process %" PRIu64 ": %s zones. Saving trace to %s...", child.pid, tracy::RealToString( child.worker->GetZoneCount() ), childOutput.c_str() );
+        fflush( stdout );
+        SaveTrace( *child.worker, childOutput.c_str() );
     }
 
     return 0;
@@ -1,3 +1,4 @@
+#include <limits>
 #include <new>
 #include <stdio.h>
 #include <string.h>
@@ -25,6 +26,10 @@
 #  include "../libbacktrace/backtrace.hpp"
 #  include <dlfcn.h>
 #  include <cxxabi.h>
+#  ifdef TRACY_HAS_MODULE_BUILD_ID
+#    include <elf.h>
+#    include <link.h>
+#  endif
 #elif TRACY_HAS_CALLSTACK == 5
 #  include <dlfcn.h>
 #  include <cxxabi.h>
@@ -90,10 +95,13 @@ struct ModuleCache
 static FastVector<ModuleCache>* s_modCache;
 #endif
 
-void InitCallstack()
+void InitCallstackCritical()
 {
     RtlWalkFrameChain = (t_RtlWalkFrameChain)GetProcAddress( GetModuleHandleA( "ntdll.dll" ), "RtlWalkFrameChain" );
+}
 
+void InitCallstack()
+{
     SymInitialize( GetCurrentProcess(), nullptr, true );
     SymSetOptions( SYMOPT_LOAD_LINES );
 
@@ -396,9 +404,15 @@ int cb_num;
 CallstackEntry cb_data[MaxCbTrace];
 int cb_fixup;
 
+void InitCallstackCritical()
+{
+}
+
 void InitCallstack()
 {
     cb_bts = backtrace_create_state( nullptr, 0, nullptr, nullptr );
+    // Read the executable's debug info now, instead of at the first decode.
+    DecodeCallstackPtrFast( uint64_t( InitCallstack ) );
 }
 
 static int FastCallstackDataCb( void* data, uintptr_t pc, const char* fn, int lineno, const char* function )
@@ -626,8 +640,89 @@ CallstackEntryData DecodeCallstackPtr( uint64_t ptr )
     return { cb_data, uint8_t( cb_num ), symloc ? symloc : "[unknown]" };
 }
 
+#ifdef TRACY_HAS_MODULE_BUILD_ID
+static int ModuleGenerationCallback( struct dl_phdr_info* info, size_t, void* data )
+{
+    *(uint64_t*)data = info->dlpi_adds + info->dlpi_subs;
+    return 1;
+}
+
+static uint64_t GetBuildId( const struct dl_phdr_info* info )
+{
+    for( int i=0; i<info->dlpi_phnum; i++ )
+    {
+        const auto& phdr = info->dlpi_phdr[i];
+        if( phdr.p_type != PT_NOTE ) continue;
+        auto ptr = (const char*)( info->dlpi_addr + phdr.p_vaddr );
+        const auto end = ptr + phdr.p_memsz;
+        while( ptr + sizeof( ElfW(Nhdr) ) <= end )
+        {
+            auto note = (const ElfW(Nhdr)*)ptr;
+            auto name = ptr + sizeof( ElfW(Nhdr) );
+            auto desc = name + ( ( note->n_namesz + 3 ) & ~3 );
+            if( desc + note->n_descsz > end ) break;
+            if( note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4 && memcmp( name, "GNU", 4 ) == 0 )
+            {
+                // The build id is usually a 160-bit SHA1 hash, fold it into 64 bits.
+                uint64_t hash = 0xcbf29ce484222325;
+                for( ElfW(Word) j=0; j<note->n_descsz; j++ )
+                {
+                    hash ^= uint8_t( desc[j] );
+                    hash *= 0x100000001b3;
+                }
+                return hash != 0 ? hash : 1;
+            }
+            ptr = desc + ( ( note->n_descsz + 3 ) & ~3 );
+        }
+    }
+    return 0;
+}
+
+static int ModuleListCallback( struct dl_phdr_info* info, size_t, void* data )
+{
+    const auto buildId = GetBuildId( info );
+    if( buildId == 0 ) return 0;
+
+    uint64_t start = std::numeric_limits<uint64_t>::max();
+    uint64_t end = 0;
+    for( int i=0; i<info->dlpi_phnum; i++ )
+    {
+        const auto& phdr = info->dlpi_phdr[i];
+        if( phdr.p_type != PT_LOAD ) continue;
+        if( phdr.p_vaddr < start ) start = phdr.p_vaddr;
+        if( phdr.p_vaddr + phdr.p_memsz > end ) end = phdr.p_vaddr + phdr.p_memsz;
+    }
+    if( start >= end ) return 0;
+
+    auto modules = (FastVector<ModuleData>*)data;
+    auto module = modules->push_next();
+    module->base = info->dlpi_addr + start;
+    module->size = end - start;
+    module->buildId = buildId;
+    return 0;
+}
+
+bool ModuleListChanged( uint64_t& generation )
+{
+    uint64_t current = 0;
+    dl_iterate_phdr( ModuleGenerationCallback, &current );
+    if( current == generation ) return false;
+    generation = current;
+    return true;
+}
+
+void GetModuleList( FastVector<ModuleData>& modules )
+{
+    dl_iterate_phdr( ModuleListCallback, &modules );
+}
+#endif
+
 #elif TRACY_HAS_CALLSTACK == 5
 
+void InitCallstackCritical()
+{
+}
+
 void InitCallstack()
 {
 }
@@ -25,4 +25,8 @@
 #  define TRACY_HAS_CALLSTACK 6
 #endif
 
+#if TRACY_HAS_CALLSTACK == 3
+#  define TRACY_HAS_MODULE_BUILD_ID
+#endif
+
 #endif
@@ -22,6 +22,8 @@
 namespace tracy
 {
 
+template<typename T> class FastVector;
+
 struct SymbolData
 {
     const char* file;
@@ -49,8 +51,24 @@ SymbolData DecodeSymbolAddress( uint64_t ptr );
 SymbolData DecodeCodeAddress( uint64_t ptr );
 const char* DecodeCallstackPtrFast( uint64_t ptr );
 CallstackEntryData DecodeCallstackPtr( uint64_t ptr );
+void InitCallstackCritical();
 void InitCallstack();
 
+#ifdef TRACY_HAS_MODULE_BUILD_ID
+struct ModuleData
+{
+    uint64_t base;
+    uint64_t size;
+    uint64_t buildId;
+};
+
+// Returns true and updates the generation counter, if modules were loaded or
+// unloaded since the generation was last retrieved.
+bool ModuleListChanged( uint64_t& generation );
+// Retrieves the address ranges of loaded modules which have a build id.
+void GetModuleList( FastVector<ModuleData>& modules );
+#endif
+
 #if TRACY_HAS_CALLSTACK == 1
 
 TRACY_API uintptr_t* CallTrace( int depth );
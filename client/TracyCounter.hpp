@@ -0,0 +1,88 @@
+#ifndef __TRACYCOUNTER_HPP__
+#define __TRACYCOUNTER_HPP__
+
+#include <atomic>
+#include <stdint.h>
+
+#include "../common/TracyApi.h"
+#include "../common/TracyForceInline.hpp"
+#include "../common/TracyHistogram.hpp"
+
+namespace tracy
+{
+
+enum { CounterSlots = 256 };
+enum { HistogramSlots = 64 };
+
+// Returns CounterSlots if no more counters can be registered.
+TRACY_API uint32_t RegisterCounter( const char* name );
+TRACY_API std::atomic<int64_t>* GetCounterBlock();
+// Returns HistogramSlots if no more histograms can be registered.
+TRACY_API uint32_t RegisterHistogram( const char* name );
+TRACY_API std::atomic<std::atomic<uint64_t>*>* GetHistogramBlock();
+TRACY_API std::atomic<uint64_t>* AllocHistogramBuckets( uint32_t id );
+
+// Counted events are sent to the server as a rate plot. Increments only touch an accumulator
+// owned by the calling thread. The profiler thread periodically sums the accumulators of all
+// threads and emits a single plot point for each sampling interval.
+class Counter
+{
+public:
+    Counter( const char* name )
+        : m_id( RegisterCounter( name ) )
+    {
+    }
+
+    Counter( const Counter& ) = delete;
+    Counter( Counter&& ) = delete;
+
+    Counter& operator=( const Counter& ) = delete;
+    Counter& operator=( Counter&& ) = delete;
+
+    tracy_force_inline void Add( int64_t val )
+    {
+        if( m_id >= CounterSlots ) return;
+        // Block is looked up on each call, as it is released when the thread exits.
+        auto block = GetCounterBlock();
+        // Only this thread writes to the accumulator, no atomic read-modify-write is needed.
+        auto& v = block[m_id];
+        v.store( v.load( std::memory_order_relaxed ) + val, std::memory_order_relaxed );
+    }
+
+private:
+    uint32_t m_id;
+};
+
+// Values are counted in log-linear buckets owned by the calling thread. The profiler thread
+// periodically merges the buckets of all threads and sends the counts of each sampling interval.
+class Histogram
+{
+public:
+    Histogram( const char* name )
+        : m_id( RegisterHistogram( name ) )
+    {
+    }
+
+    Histogram( const Histogram& ) = delete;
+    Histogram( Histogram&& ) = delete;
+
+    Histogram& operator=( const Histogram& ) = delete;
+    Histogram& operator=( Histogram&& ) = delete;
+
+    tracy_force_inline void Add( int64_t val )
+    {
+        if( m_id >= HistogramSlots ) return;
+        auto block = GetHistogramBlock();
+        auto buckets = block[m_id].load( std::memory_order_relaxed );
+        if( !buckets ) buckets = AllocHistogramBuckets( m_id );
+        auto& v = buckets[HistogramBucket( val )];
+        v.store( v.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+    }
+
+private:
+    uint32_t m_id;
+};
+
+}
+
+#endif
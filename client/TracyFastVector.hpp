@@ -38,6 +38,7 @@ public:
 
     bool empty() const { return m_ptr == m_write; }
     size_t size() const { return m_write - m_ptr; }
+    size_t capacity() const { return m_end - m_ptr; }
 
     T* data() { return m_ptr; }
     const T* data() const { return m_ptr; };
@@ -95,6 +96,21 @@ public:
         vec.m_end = end1;
     }
 
+    // Reallocates the storage, if the current contents fit in the requested capacity.
+    bool shrink( size_t capacity )
+    {
+        assert( capacity != 0 );
+        const auto size = size_t( m_write - m_ptr );
+        if( capacity < size || capacity >= size_t( m_end - m_ptr ) ) return false;
+        T* ptr = (T*)tracy_malloc( sizeof( T ) * capacity );
+        memcpy( ptr, m_ptr, size * sizeof( T ) );
+        tracy_free( m_ptr );
+        m_ptr = ptr;
+        m_write = m_ptr + size;
+        m_end = m_ptr + capacity;
+        return true;
+    }
+
 private:
     tracy_no_inline void AllocMore()
     {
@@ -19,6 +19,11 @@ public:
 #ifdef TRACY_ON_DEMAND
         , m_lockCount( 0 )
         , m_active( false )
+#endif
+#ifdef TRACY_LOCK_SAMPLING
+        , m_uncontended( 0 )
+        , m_sampleSkip( 0 )
+        , m_counted( false )
 #endif
     {
         assert( m_id != std::numeric_limits<uint32_t>::max() );
@@ -39,6 +44,9 @@ public:
 
     tracy_force_inline ~LockableCtx()
     {
+#ifdef TRACY_LOCK_SAMPLING
+        SendUncontended();
+#endif
         TracyLfqPrepare( QueueType::LockTerminate );
         MemWrite( &item->lockTerminate.id, m_id );
         MemWrite( &item->lockTerminate.time, Profiler::GetTime() );
@@ -57,7 +65,8 @@ public:
         const auto active = m_active.load( std::memory_order_relaxed );
         if( locks == 0 || active )
         {
-            const bool connected = GetProfiler().IsConnected();
+            bool connected = GetProfiler().IsConnected();
+            if( !connected && active && locks != 0 && GetProfiler().IsCaptureSuspended() ) connected = true;
             if( active != connected ) m_active.store( connected, std::memory_order_relaxed );
             if( connected ) queue = true;
         }
@@ -87,12 +96,14 @@ public:
     tracy_force_inline void AfterUnlock()
     {
 #ifdef TRACY_ON_DEMAND
-        m_lockCount.fetch_sub( 1, std::memory_order_relaxed );
+        const auto locks = m_lockCount.fetch_sub( 1, std::memory_order_relaxed );
         if( !m_active.load( std::memory_order_relaxed ) ) return;
         if( !GetProfiler().IsConnected() )
         {
-            m_active.store( false, std::memory_order_relaxed );
-            return;
+            // Lock in use at the end of capture window is tracked until released by all threads.
+            const auto suspended = GetProfiler().IsCaptureSuspended();
+            if( !suspended || locks == 1 ) m_active.store( false, std::memory_order_relaxed );
+            if( !suspended ) return;
         }
 #endif
 
@@ -104,8 +115,54 @@ public:
         Profiler::QueueSerialFinish();
     }
 
+#ifdef TRACY_LOCK_SAMPLING
+    // Called with the lock held, after it was acquired with try_lock() on the first attempt.
+    // Only every TRACY_LOCK_SAMPLING-th such acquisition is reported, the rest are counted.
+    tracy_force_inline void AfterUncontendedLock()
+    {
+        if( ++m_sampleSkip < TRACY_LOCK_SAMPLING )
+        {
+#ifdef TRACY_ON_DEMAND
+            m_lockCount.fetch_add( 1, std::memory_order_relaxed );
+#endif
+            m_uncontended++;
+            m_counted = true;
+            return;
+        }
+        m_sampleSkip = 0;
+        m_counted = false;
+        if( BeforeLock() )
+        {
+            SendUncontended();
+            AfterLock();
+        }
+        else
+        {
+            m_uncontended = 0;
+        }
+    }
+
+    tracy_force_inline void AfterContendedLock( bool runAfter )
+    {
+        m_counted = false;
+        if( runAfter ) AfterLock();
+    }
+
+    tracy_force_inline bool IsCounted() const { return m_counted; }
+
+    tracy_force_inline void AfterCountedUnlock()
+    {
+#ifdef TRACY_ON_DEMAND
+        m_lockCount.fetch_sub( 1, std::memory_order_relaxed );
+#endif
+    }
+#endif
+
     tracy_force_inline void AfterTryLock( bool acquired )
     {
+#ifdef TRACY_LOCK_SAMPLING
+        if( acquired ) m_counted = false;
+#endif
 #ifdef TRACY_ON_DEMAND
         if( !acquired ) return;
 
@@ -114,7 +171,8 @@ public:
         const auto active = m_active.load( std::memory_order_relaxed );
         if( locks == 0 || active )
         {
-            const bool connected = GetProfiler().IsConnected();
+            bool connected = GetProfiler().IsConnected();
+            if( !connected && active && locks != 0 && GetProfiler().IsCaptureSuspended() ) connected = true;
             if( active != connected ) m_active.store( connected, std::memory_order_relaxed );
             if( connected ) queue = true;
         }
@@ -134,13 +192,17 @@ public:
 
     tracy_force_inline void Mark( const SourceLocationData* srcloc )
     {
+#ifdef TRACY_LOCK_SAMPLING
+        // The current acquisition was only counted, there is no event to attach the mark to.
+        if( m_counted ) return;
+#endif
 #ifdef TRACY_ON_DEMAND
         const auto active = m_active.load( std::memory_order_relaxed );
         if( !active ) return;
         const auto connected = GetProfiler().IsConnected();
         if( !connected )
         {
-            if( active ) m_active.store( false, std::memory_order_relaxed );
+            if( active && !GetProfiler().IsCaptureSuspended() ) m_active.store( false, std::memory_order_relaxed );
             return;
         }
 #endif
@@ -174,6 +236,31 @@ private:
     std::atomic<uint32_t> m_lockCount;
     std::atomic<bool> m_active;
 #endif
+
+#ifdef TRACY_LOCK_SAMPLING
+    tracy_force_inline void SendUncontended()
+    {
+        if( m_uncontended == 0 ) return;
+#ifdef TRACY_ON_DEMAND
+        if( !GetProfiler().IsConnected() )
+        {
+            m_uncontended = 0;
+            return;
+        }
+#endif
+        auto item = Profiler::QueueSerial();
+        MemWrite( &item->hdr.type, QueueType::LockUncontended );
+        MemWrite( &item->lockUncontended.id, m_id );
+        MemWrite( &item->lockUncontended.count, m_uncontended );
+        MemWrite( &item->lockUncontended.type, LockType::Lockable );
+        Profiler::QueueSerialFinish();
+        m_uncontended = 0;
+    }
+
+    uint32_t m_uncontended;
+    uint32_t m_sampleSkip;
+    bool m_counted;
+#endif
 };
 
 template<class T>
@@ -190,13 +277,32 @@ public:
 
     tracy_force_inline void lock()
     {
+#ifdef TRACY_LOCK_SAMPLING
+        if( m_lockable.try_lock() )
+        {
+            m_ctx.AfterUncontendedLock();
+            return;
+        }
+        const auto runAfter = m_ctx.BeforeLock();
+        m_lockable.lock();
+        m_ctx.AfterContendedLock( runAfter );
+#else
         const auto runAfter = m_ctx.BeforeLock();
         m_lockable.lock();
         if( runAfter ) m_ctx.AfterLock();
+#endif
     }
 
     tracy_force_inline void unlock()
     {
+#ifdef TRACY_LOCK_SAMPLING
+        if( m_ctx.IsCounted() )
+        {
+            m_lockable.unlock();
+            m_ctx.AfterCountedUnlock();
+            return;
+        }
+#endif
         m_lockable.unlock();
         m_ctx.AfterUnlock();
     }
@@ -232,6 +338,11 @@ public:
 #ifdef TRACY_ON_DEMAND
         , m_lockCount( 0 )
         , m_active( false )
+#endif
+#ifdef TRACY_LOCK_SAMPLING
+        , m_uncontended( 0 )
+        , m_sampleSkip( 0 )
+        , m_counted( false )
 #endif
     {
         assert( m_id != std::numeric_limits<uint32_t>::max() );
@@ -254,6 +365,9 @@ public:
 
     tracy_force_inline ~SharedLockableCtx()
     {
+#ifdef TRACY_LOCK_SAMPLING
+        SendUncontended();
+#endif
         TracyLfqPrepare( QueueType::LockTerminate );
         MemWrite( &item->lockTerminate.id, m_id );
         MemWrite( &item->lockTerminate.time, Profiler::GetTime() );
@@ -274,7 +388,8 @@ public:
         const auto active = m_active.load( std::memory_order_relaxed );
         if( locks == 0 || active )
         {
-            const bool connected = GetProfiler().IsConnected();
+            bool connected = GetProfiler().IsConnected();
+            if( !connected && active && locks != 0 && GetProfiler().IsCaptureSuspended() ) connected = true;
             if( active != connected ) m_active.store( connected, std::memory_order_relaxed );
             if( connected ) queue = true;
         }
@@ -304,12 +419,14 @@ public:
     tracy_force_inline void AfterUnlock()
     {
 #ifdef TRACY_ON_DEMAND
-        m_lockCount.fetch_sub( 1, std::memory_order_relaxed );
+        const auto locks = m_lockCount.fetch_sub( 1, std::memory_order_relaxed );
         if( !m_active.load( std::memory_order_relaxed ) ) return;
         if( !GetProfiler().IsConnected() )
         {
-            m_active.store( false, std::memory_order_relaxed );
-            return;
+            // Lock in use at the end of capture window is tracked until released by all threads.
+            const auto suspended = GetProfiler().IsCaptureSuspended();
+            if( !suspended || locks == 1 ) m_active.store( false, std::memory_order_relaxed );
+            if( !suspended ) return;
         }
 #endif
 
@@ -321,8 +438,54 @@ public:
         Profiler::QueueSerialFinish();
     }
 
+#ifdef TRACY_LOCK_SAMPLING
+    // Called with the lock held, after it was acquired with try_lock() on the first attempt.
+    // Only every TRACY_LOCK_SAMPLING-th such acquisition is reported, the rest are counted.
+    tracy_force_inline void AfterUncontendedLock()
+    {
+        if( ++m_sampleSkip < TRACY_LOCK_SAMPLING )
+        {
+#ifdef TRACY_ON_DEMAND
+            m_lockCount.fetch_add( 1, std::memory_order_relaxed );
+#endif
+            m_uncontended++;
+            m_counted = true;
+            return;
+        }
+        m_sampleSkip = 0;
+        m_counted = false;
+        if( BeforeLock() )
+        {
+            SendUncontended();
+            AfterLock();
+        }
+        else
+        {
+            m_uncontended = 0;
+        }
+    }
+
+    tracy_force_inline void AfterContendedLock( bool runAfter )
+    {
+        m_counted = false;
+        if( runAfter ) AfterLock();
+    }
+
+    tracy_force_inline bool IsCounted() const { return m_counted; }
+
+    tracy_force_inline void AfterCountedUnlock()
+    {
+#ifdef TRACY_ON_DEMAND
+        m_lockCount.fetch_sub( 1, std::memory_order_relaxed );
+#endif
+    }
+#endif
+
     tracy_force_inline void AfterTryLock( bool acquired )
     {
+#ifdef TRACY_LOCK_SAMPLING
+        if( acquired ) m_counted = false;
+#endif
 #ifdef TRACY_ON_DEMAND
         if( !acquired ) return;
 
@@ -331,7 +494,8 @@ public:
         const auto active = m_active.load( std::memory_order_relaxed );
         if( locks == 0 || active )
         {
-            const bool connected = GetProfiler().IsConnected();
+            bool connected = GetProfiler().IsConnected();
+            if( !connected && active && locks != 0 && GetProfiler().IsCaptureSuspended() ) connected = true;
             if( active != connected ) m_active.store( connected, std::memory_order_relaxed );
             if( connected ) queue = true;
         }
@@ -357,7 +521,8 @@ public:
         const auto active = m_active.load( std::memory_order_relaxed );
         if( locks == 0 || active )
         {
-            const bool connected = GetProfiler().IsConnected();
+            bool connected = GetProfiler().IsConnected();
+            if( !connected && active && locks != 0 && GetProfiler().IsCaptureSuspended() ) connected = true;
             if( active != connected ) m_active.store( connected, std::memory_order_relaxed );
             if( connected ) queue = true;
         }
@@ -387,12 +552,14 @@ public:
     tracy_force_inline void AfterUnlockShared()
     {
 #ifdef TRACY_ON_DEMAND
-        m_lockCount.fetch_sub( 1, std::memory_order_relaxed );
+        const auto locks = m_lockCount.fetch_sub( 1, std::memory_order_relaxed );
         if( !m_active.load( std::memory_order_relaxed ) ) return;
         if( !GetProfiler().IsConnected() )
         {
-            m_active.store( false, std::memory_order_relaxed );
-            return;
+            // Lock in use at the end of capture window is tracked until released by all threads.
+            const auto suspended = GetProfiler().IsCaptureSuspended();
+            if( !suspended || locks == 1 ) m_active.store( false, std::memory_order_relaxed );
+            if( !suspended ) return;
         }
 #endif
 
@@ -414,7 +581,8 @@ public:
         const auto active = m_active.load( std::memory_order_relaxed );
         if( locks == 0 || active )
         {
-            const bool connected = GetProfiler().IsConnected();
+            bool connected = GetProfiler().IsConnected();
+            if( !connected && active && locks != 0 && GetProfiler().IsCaptureSuspended() ) connected = true;
             if( active != connected ) m_active.store( connected, std::memory_order_relaxed );
             if( connected ) queue = true;
         }
@@ -434,13 +602,17 @@ public:
 
     tracy_force_inline void Mark( const SourceLocationData* srcloc )
     {
+#ifdef TRACY_LOCK_SAMPLING
+        // The current acquisition was only counted, there is no event to attach the mark to.
+        if( m_counted ) return;
+#endif
 #ifdef TRACY_ON_DEMAND
         const auto active = m_active.load( std::memory_order_relaxed );
         if( !active ) return;
         const auto connected = GetProfiler().IsConnected();
         if( !connected )
         {
-            if( active ) m_active.store( false, std::memory_order_relaxed );
+            if( active && !GetProfiler().IsCaptureSuspended() ) m_active.store( false, std::memory_order_relaxed );
             return;
         }
 #endif
@@ -474,6 +646,31 @@ private:
     std::atomic<uint32_t> m_lockCount;
     std::atomic<bool> m_active;
 #endif
+
+#ifdef TRACY_LOCK_SAMPLING
+    tracy_force_inline void SendUncontended()
+    {
+        if( m_uncontended == 0 ) return;
+#ifdef TRACY_ON_DEMAND
+        if( !GetProfiler().IsConnected() )
+        {
+            m_uncontended = 0;
+            return;
+        }
+#endif
+        auto item = Profiler::QueueSerial();
+        MemWrite( &item->hdr.type, QueueType::LockUncontended );
+        MemWrite( &item->lockUncontended.id, m_id );
+        MemWrite( &item->lockUncontended.count, m_uncontended );
+        MemWrite( &item->lockUncontended.type, LockType::SharedLockable );
+        Profiler::QueueSerialFinish();
+        m_uncontended = 0;
+    }
+
+    uint32_t m_uncontended;
+    uint32_t m_sampleSkip;
+    bool m_counted;
+#endif
 };
 
 template<class T>
@@ -490,13 +687,32 @@ public:
 
     tracy_force_inline void lock()
     {
+#ifdef TRACY_LOCK_SAMPLING
+        if( m_lockable.try_lock() )
+        {
+            m_ctx.AfterUncontendedLock();
+            return;
+        }
+        const auto runAfter = m_ctx.BeforeLock();
+        m_lockable.lock();
+        m_ctx.AfterContendedLock( runAfter );
+#else
         const auto runAfter = m_ctx.BeforeLock();
         m_lockable.lock();
         if( runAfter ) m_ctx.AfterLock();
+#endif
     }
 
     tracy_force_inline void unlock()
     {
+#ifdef TRACY_LOCK_SAMPLING
+        if( m_ctx.IsCounted() )
+        {
+            m_lockable.unlock();
+            m_ctx.AfterCountedUnlock();
+            return;
+        }
+#endif
         m_lockable.unlock();
         m_ctx.AfterUnlock();
     }
@@ -0,0 +1,149 @@
+#ifndef __TRACYMEMSAMPLESET_HPP__
+#define __TRACYMEMSAMPLESET_HPP__
+
+#include <assert.h>
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+#include "../common/TracyAlloc.hpp"
+#include "../common/TracyForceInline.hpp"
+
+namespace tracy
+{
+
+// Set of sampled memory allocations, keyed by memory pool and pointer, as the
+// same address may be live in several pools. The pool is the name pointer
+// passed to the allocation, or null for the default pool. Frees not in the set
+// are not reported, which is decided by a lock-free counting filter, so that
+// the common case doesn't need to touch the serial lock. Insert() and Erase()
+// must be called with the serial lock held.
+class MemSampleSet
+{
+    struct Slot
+    {
+        uint64_t ptr;
+        uint64_t pool;
+    };
+
+    enum { FilterBits = 15 };
+    enum { FilterSize = 1 << FilterBits };
+    enum { InitialCapacity = 1024 };
+
+public:
+    MemSampleSet()
+        : m_data( nullptr )
+        , m_mask( 0 )
+        , m_size( 0 )
+        , m_filter {}
+    {
+    }
+
+    MemSampleSet( const MemSampleSet& ) = delete;
+    MemSampleSet( MemSampleSet&& ) = delete;
+
+    ~MemSampleSet()
+    {
+        if( m_data ) tracy_free( m_data );
+    }
+
+    MemSampleSet& operator=( const MemSampleSet& ) = delete;
+    MemSampleSet& operator=( MemSampleSet&& ) = delete;
+
+    tracy_force_inline bool MayContain( const void* ptr, const char* pool ) const
+    {
+        return m_filter[FilterIdx( Mix( uint64_t( ptr ), uint64_t( pool ) ) )].load( std::memory_order_relaxed ) != 0;
+    }
+
+    void Insert( const void* ptr, const char* pool )
+    {
+        const Slot key = { uint64_t( ptr ), uint64_t( pool ) };
+        assert( key.ptr != 0 );
+        if( ( m_size + 1 ) * 4 > ( m_mask + 1 ) * 3 ) Grow();
+        InsertKey( key );
+        m_size++;
+        auto& cnt = m_filter[FilterIdx( Mix( key.ptr, key.pool ) )];
+        cnt.store( cnt.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+    }
+
+    bool Erase( const void* ptr, const char* pool )
+    {
+        const Slot key = { uint64_t( ptr ), uint64_t( pool ) };
+        if( m_size == 0 || key.ptr == 0 ) return false;
+        auto idx = Hash( key ) & m_mask;
+        for(;;)
+        {
+            if( m_data[idx].ptr == 0 ) return false;
+            if( m_data[idx].ptr == key.ptr && m_data[idx].pool == key.pool ) break;
+            idx = ( idx + 1 ) & m_mask;
+        }
+
+        // Backward shift deletion keeps probe sequences intact without tombstones.
+        auto hole = idx;
+        for(;;)
+        {
+            idx = ( idx + 1 ) & m_mask;
+            const auto v = m_data[idx];
+            if( v.ptr == 0 ) break;
+            const auto home = Hash( v ) & m_mask;
+            if( ( ( idx - home ) & m_mask ) >= ( ( idx - hole ) & m_mask ) )
+            {
+                m_data[hole] = v;
+                hole = idx;
+            }
+        }
+        m_data[hole].ptr = 0;
+        m_size--;
+
+        auto& cnt = m_filter[FilterIdx( Mix( key.ptr, key.pool ) )];
+        cnt.store( cnt.load( std::memory_order_relaxed ) - 1, std::memory_order_relaxed );
+        return true;
+    }
+
+private:
+    static tracy_force_inline uint64_t Mix( uint64_t ptr, uint64_t pool )
+    {
+        return ptr ^ ( pool * 0xFF51AFD7ED558CCDull );
+    }
+
+    static tracy_force_inline uint64_t Hash( const Slot& key )
+    {
+        return ( Mix( key.ptr, key.pool ) * 0x9E3779B97F4A7C15ull ) >> 16;
+    }
+
+    static tracy_force_inline uint32_t FilterIdx( uint64_t key )
+    {
+        return uint32_t( ( key * 0xC2B2AE3D27D4EB4Full ) >> ( 64 - FilterBits ) );
+    }
+
+    tracy_force_inline void InsertKey( const Slot& key )
+    {
+        auto idx = Hash( key ) & m_mask;
+        while( m_data[idx].ptr != 0 ) idx = ( idx + 1 ) & m_mask;
+        m_data[idx] = key;
+    }
+
+    void Grow()
+    {
+        const auto oldData = m_data;
+        const auto oldCapacity = m_data ? m_mask + 1 : 0;
+        const auto capacity = oldCapacity == 0 ? uint64_t( InitialCapacity ) : oldCapacity * 2;
+        m_data = (Slot*)tracy_malloc( sizeof( Slot ) * capacity );
+        memset( m_data, 0, sizeof( Slot ) * capacity );
+        m_mask = capacity - 1;
+        for( uint64_t i=0; i<oldCapacity; i++ )
+        {
+            if( oldData[i].ptr != 0 ) InsertKey( oldData[i] );
+        }
+        if( oldData ) tracy_free( oldData );
+    }
+
+    Slot* m_data;
+    uint64_t m_mask;
+    uint64_t m_size;
+    std::atomic<uint32_t> m_filter[FilterSize];
+};
+
+}
+
+#endif
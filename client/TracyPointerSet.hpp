@@ -0,0 +1,106 @@
+#ifndef __TRACYPOINTERSET_HPP__
+#define __TRACYPOINTERSET_HPP__
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../common/TracyAlloc.hpp"
+#include "../common/TracyForceInline.hpp"
+
+namespace tracy
+{
+
+// Open addressed set of non-null pointers, keyed by the full pointer value.
+// Not thread safe. Storage grows on insertion, unless growth is disallowed,
+// in which case pointers which don't fit are not remembered.
+class PointerSet
+{
+    enum { InitialCapacity = 1024 };
+
+public:
+    PointerSet()
+        : m_data( nullptr )
+        , m_mask( 0 )
+        , m_size( 0 )
+    {
+    }
+
+    PointerSet( const PointerSet& ) = delete;
+    PointerSet( PointerSet&& ) = delete;
+
+    ~PointerSet()
+    {
+        if( m_data ) tracy_free( m_data );
+    }
+
+    PointerSet& operator=( const PointerSet& ) = delete;
+    PointerSet& operator=( PointerSet&& ) = delete;
+
+    // Returns true if the pointer was not in the set before.
+    tracy_force_inline bool Insert( uint64_t ptr, bool canGrow = true )
+    {
+        assert( ptr != 0 );
+        if( m_data )
+        {
+            auto idx = Hash( ptr ) & m_mask;
+            for(;;)
+            {
+                const auto v = m_data[idx];
+                if( v == ptr ) return false;
+                if( v == 0 ) break;
+                idx = ( idx + 1 ) & m_mask;
+            }
+        }
+        if( ( m_size + 1 ) * 4 > ( m_mask + 1 ) * 3 || !m_data )
+        {
+            if( !canGrow ) return true;
+            Grow();
+        }
+        InsertKey( ptr );
+        m_size++;
+        return true;
+    }
+
+    void Clear()
+    {
+        if( m_data ) memset( m_data, 0, sizeof( uint64_t ) * ( m_mask + 1 ) );
+        m_size = 0;
+    }
+
+private:
+    static tracy_force_inline uint64_t Hash( uint64_t ptr )
+    {
+        return ( ptr * 0x9E3779B97F4A7C15ull ) >> 16;
+    }
+
+    tracy_force_inline void InsertKey( uint64_t ptr )
+    {
+        auto idx = Hash( ptr ) & m_mask;
+        while( m_data[idx] != 0 ) idx = ( idx + 1 ) & m_mask;
+        m_data[idx] = ptr;
+    }
+
+    void Grow()
+    {
+        const auto oldData = m_data;
+        const auto oldCapacity = m_data ? m_mask + 1 : 0;
+        const auto capacity = oldCapacity == 0 ? uint64_t( InitialCapacity ) : oldCapacity * 2;
+        m_data = (uint64_t*)tracy_malloc( sizeof( uint64_t ) * capacity );
+        memset( m_data, 0, sizeof( uint64_t ) * capacity );
+        m_mask = capacity - 1;
+        for( uint64_t i=0; i<oldCapacity; i++ )
+        {
+            if( oldData[i] != 0 ) InsertKey( oldData[i] );
+        }
+        if( oldData ) tracy_free( oldData );
+    }
+
+    uint64_t* m_data;
+    uint64_t m_mask;
+    uint64_t m_size;
+};
+
+}
+
+#endif
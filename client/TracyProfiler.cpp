@@ -10,8 +10,10 @@
 #  include <inttypes.h>
 #  include <intrin.h>
 #else
+#  include <pthread.h>
 #  include <sys/time.h>
 #  include <sys/param.h>
+#  include <unistd.h>
 #endif
 
 #ifdef __CYGWIN__
@@ -26,8 +28,11 @@
 
 #ifdef __linux__
 #  include <dirent.h>
+#  include <errno.h>
+#  include <fcntl.h>
 #  include <signal.h>
 #  include <pthread.h>
+#  include <unistd.h>
 #  include <sys/types.h>
 #  include <sys/syscall.h>
 #endif
@@ -42,6 +47,8 @@
 #include <atomic>
 #include <chrono>
 #include <limits>
+#include <math.h>
+#include <mutex>
 #include <new>
 #include <stdlib.h>
 #include <string.h>
@@ -51,8 +58,12 @@
 #include "../common/TracySocket.hpp"
 #include "../common/TracySystem.hpp"
 #include "../common/tracy_lz4.hpp"
+#ifdef TRACY_ZSTD
+#  include "../zstd/zstd.h"
+#endif
 #include "tracy_rpmalloc.hpp"
 #include "TracyCallstack.hpp"
+#include "TracyCounter.hpp"
 #include "TracyDxt1.hpp"
 #include "TracyScoped.hpp"
 #include "TracyProfiler.hpp"
@@ -237,6 +248,31 @@ static int64_t SetupHwTimer()
 
     return Profiler::GetTime();
 }
+
+// Returns 0 if the TSC frequency is not reported by the system.
+static uint64_t GetTscFrequency()
+{
+#ifdef __linux__
+    // Not exposed by all kernels.
+    FILE* f = fopen( "/sys/devices/system/cpu/cpu0/tsc_freq_khz", "rb" );
+    if( f )
+    {
+        char buf[32];
+        const auto sz = fread( buf, 1, sizeof( buf ) - 1, f );
+        fclose( f );
+        buf[sz] = '\0';
+        const auto khz = strtoull( buf, nullptr, 10 );
+        if( khz != 0 ) return khz * 1000;
+    }
+#endif
+    uint32_t regs[4];
+    CpuId( regs, 0 );
+    if( regs[0] < 0x15 ) return 0;
+    // TSC to core crystal clock ratio in EBX/EAX, crystal clock frequency in ECX.
+    CpuId( regs, 0x15 );
+    if( regs[0] == 0 || regs[1] == 0 || regs[2] == 0 ) return 0;
+    return uint64_t( regs[2] ) * regs[1] / regs[0];
+}
 #else
 static int64_t SetupHwTimer()
 {
@@ -518,13 +554,15 @@ static uint64_t GetPid()
 #endif
 }
 
-static BroadcastMessage& GetBroadcastMessage( const char* procname, size_t pnsz, int& len, int port )
+static BroadcastMessage& GetBroadcastMessage( const char* procname, size_t pnsz, int& len, int port, uint64_t pid, uint64_t parentPid )
 {
     static BroadcastMessage msg;
 
     msg.broadcastVersion = BroadcastVersion;
     msg.protocolVersion = ProtocolVersion;
     msg.listenPort = port;
+    msg.pid = pid;
+    msg.parentPid = parentPid;
 
     memcpy( msg.programName, procname, pnsz );
     memset( msg.programName + pnsz, 0, WelcomeMessageProgramNameSize - pnsz );
@@ -535,6 +573,7 @@ static BroadcastMessage& GetBroadcastMessage( const char* procname, size_t pnsz,
 
 #if defined _WIN32 || defined __CYGWIN__
 static DWORD s_profilerThreadId = 0;
+static DWORD s_sendThreadId = 0;
 static char s_crashText[1024];
 
 LONG WINAPI CrashFilter( PEXCEPTION_POINTERS pExp )
@@ -612,7 +651,7 @@ LONG WINAPI CrashFilter( PEXCEPTION_POINTERS pExp )
 
     do
     {
-        if( te.th32OwnerProcessID == pid && te.th32ThreadID != tid && te.th32ThreadID != s_profilerThreadId )
+        if( te.th32OwnerProcessID == pid && te.th32ThreadID != tid && te.th32ThreadID != s_profilerThreadId && te.th32ThreadID != s_sendThreadId )
         {
             HANDLE th = OpenThread( THREAD_SUSPEND_RESUME, FALSE, te.th32ThreadID );
             if( th != INVALID_HANDLE_VALUE )
@@ -642,6 +681,7 @@ LONG WINAPI CrashFilter( PEXCEPTION_POINTERS pExp )
 
 #ifdef __linux__
 static long s_profilerTid = 0;
+static long s_sendTid = 0;
 static char s_crashText[1024];
 static std::atomic<bool> s_alreadyCrashed( false );
 
@@ -839,7 +879,7 @@ static void CrashHandler( int signal, siginfo_t* info, void* /*ucontext*/ )
     {
         if( ep->d_name[0] == '.' ) continue;
         int tid = atoi( ep->d_name );
-        if( tid != selfTid && tid != s_profilerTid )
+        if( tid != selfTid && tid != s_profilerTid && tid != s_sendTid )
         {
             syscall( SYS_tkill, tid, SIGPWR );
         }
@@ -865,11 +905,250 @@ enum { QueuePrealloc = 256 * 1024 };
 static Profiler* s_instance;
 static Thread* s_thread;
 static Thread* s_compressThread;
+static Thread* s_sendThread;
 
 #ifdef TRACY_HAS_SYSTEM_TRACING
 static Thread* s_sysTraceThread = nullptr;
 #endif
 
+#ifdef TRACY_HAS_CALLSTACK
+static Thread* s_callstackInitThread = nullptr;
+static std::atomic<bool> s_callstackReady( false );
+
+static void CallstackInitWorker( void* )
+{
+    SetThreadName( "Tracy Symbols" );
+    rpmalloc_thread_initialize();
+    InitCallstack();
+    s_callstackReady.store( true, std::memory_order_release );
+}
+
+static void WaitForCallstackInit()
+{
+    while( !s_callstackReady.load( std::memory_order_acquire ) ) std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+}
+#endif
+
+#ifdef TRACY_PROFILER_STATS
+static tracy_force_inline int64_t GetStatTime()
+{
+    return std::chrono::high_resolution_clock::now().time_since_epoch().count();
+}
+#endif
+
+#ifndef TRACY_COUNTER_INTERVAL
+#  define TRACY_COUNTER_INTERVAL 100
+#endif
+
+struct CounterInfo
+{
+    const char* name;
+    uint32_t id;
+    int64_t last;
+    CounterInfo* next;
+};
+
+// Accumulators of all counters for one thread. Blocks are never freed, the values stay valid
+// for summing after the thread exits, and the block is reused by another thread once the
+// exiting thread has released it.
+struct CounterBlock
+{
+    std::atomic<int64_t> value[CounterSlots];
+    std::atomic<bool> inUse;
+    CounterBlock* next;
+};
+
+// Block of the calling thread. The pointer is trivially destructible, so it stays usable while
+// the other thread local objects are destroyed. Once the block is released for reuse, counting
+// done later in the thread's teardown goes to the discard block, which is never summed.
+static CounterBlock s_counterDiscard;
+static thread_local CounterBlock* s_counterBlock = nullptr;
+
+struct CounterBlockOwner
+{
+    ~CounterBlockOwner()
+    {
+        s_counterBlock = &s_counterDiscard;
+        if( block ) block->inUse.store( false, std::memory_order_release );
+    }
+
+    CounterBlock* block;
+};
+
+static std::atomic<int> s_counterLock( 0 );
+static std::atomic<CounterInfo*> s_counters( nullptr );
+static std::atomic<CounterBlock*> s_counterBlocks( nullptr );
+static thread_local CounterBlockOwner s_counterBlockOwner;
+
+static void LockCounters()
+{
+    int expected = 0;
+    while( !s_counterLock.compare_exchange_weak( expected, 1, std::memory_order_acquire, std::memory_order_relaxed ) ) { expected = 0; }
+}
+
+static void UnlockCounters()
+{
+    s_counterLock.store( 0, std::memory_order_release );
+}
+
+TRACY_API uint32_t RegisterCounter( const char* name )
+{
+    // Call sites using the same name share one counter.
+    LockCounters();
+    auto head = s_counters.load( std::memory_order_relaxed );
+    auto ptr = head;
+    while( ptr && strcmp( ptr->name, name ) != 0 ) ptr = ptr->next;
+    uint32_t id;
+    if( ptr )
+    {
+        id = ptr->id;
+    }
+    else if( head && head->id == CounterSlots - 1 )
+    {
+        id = CounterSlots;
+    }
+    else
+    {
+        InitRPMallocThread();
+        auto info = (CounterInfo*)tracy_malloc( sizeof( CounterInfo ) );
+        info->name = name;
+        info->id = head ? head->id + 1 : 0;
+        info->last = 0;
+        info->next = head;
+        s_counters.store( info, std::memory_order_release );
+        id = info->id;
+    }
+    UnlockCounters();
+    return id;
+}
+
+TRACY_API std::atomic<int64_t>* GetCounterBlock()
+{
+    if( s_counterBlock ) return s_counterBlock->value;
+
+    auto block = s_counterBlocks.load( std::memory_order_acquire );
+    while( block )
+    {
+        bool expected = false;
+        if( !block->inUse.load( std::memory_order_relaxed ) && block->inUse.compare_exchange_strong( expected, true, std::memory_order_acquire ) ) break;
+        block = block->next;
+    }
+    if( !block )
+    {
+        InitRPMallocThread();
+        block = (CounterBlock*)tracy_malloc( sizeof( CounterBlock ) );
+        for( auto& v : block->value ) v.store( 0, std::memory_order_relaxed );
+        block->inUse.store( true, std::memory_order_relaxed );
+        block->next = s_counterBlocks.load( std::memory_order_relaxed );
+        while( !s_counterBlocks.compare_exchange_weak( block->next, block, std::memory_order_release, std::memory_order_relaxed ) ) {}
+    }
+    s_counterBlockOwner.block = block;
+    s_counterBlock = block;
+    return block->value;
+}
+
+struct HistogramInfo
+{
+    const char* name;
+    uint32_t id;
+    uint64_t last[HistogramBuckets];
+    HistogramInfo* next;
+};
+
+// Bucket arrays of all histograms for one thread, allocated on first use. Same lifetime rules
+// as for counter blocks apply.
+struct HistogramBlock
+{
+    std::atomic<std::atomic<uint64_t>*> buckets[HistogramSlots];
+    std::atomic<bool> inUse;
+    HistogramBlock* next;
+};
+
+static HistogramBlock s_histogramDiscard;
+static std::atomic<uint64_t> s_histogramDiscardBuckets[HistogramBuckets];
+static thread_local HistogramBlock* s_histogramBlock = nullptr;
+
+struct HistogramBlockOwner
+{
+    ~HistogramBlockOwner()
+    {
+        s_histogramBlock = &s_histogramDiscard;
+        if( block ) block->inUse.store( false, std::memory_order_release );
+    }
+
+    HistogramBlock* block;
+};
+
+static std::atomic<HistogramInfo*> s_histograms( nullptr );
+static std::atomic<HistogramBlock*> s_histogramBlocks( nullptr );
+static thread_local HistogramBlockOwner s_histogramBlockOwner;
+
+TRACY_API uint32_t RegisterHistogram( const char* name )
+{
+    LockCounters();
+    auto head = s_histograms.load( std::memory_order_relaxed );
+    auto ptr = head;
+    while( ptr && strcmp( ptr->name, name ) != 0 ) ptr = ptr->next;
+    uint32_t id;
+    if( ptr )
+    {
+        id = ptr->id;
+    }
+    else if( head && head->id == HistogramSlots - 1 )
+    {
+        id = HistogramSlots;
+    }
+    else
+    {
+        InitRPMallocThread();
+        auto info = (HistogramInfo*)tracy_malloc( sizeof( HistogramInfo ) );
+        info->name = name;
+        info->id = head ? head->id + 1 : 0;
+        memset( info->last, 0, sizeof( info->last ) );
+        info->next = head;
+        s_histograms.store( info, std::memory_order_release );
+        id = info->id;
+    }
+    UnlockCounters();
+    return id;
+}
+
+TRACY_API std::atomic<std::atomic<uint64_t>*>* GetHistogramBlock()
+{
+    if( s_histogramBlock ) return s_histogramBlock->buckets;
+
+    auto block = s_histogramBlocks.load( std::memory_order_acquire );
+    while( block )
+    {
+        bool expected = false;
+        if( !block->inUse.load( std::memory_order_relaxed ) && block->inUse.compare_exchange_strong( expected, true, std::memory_order_acquire ) ) break;
+        block = block->next;
+    }
+    if( !block )
+    {
+        InitRPMallocThread();
+        block = (HistogramBlock*)tracy_malloc( sizeof( HistogramBlock ) );
+        for( auto& v : block->buckets ) v.store( nullptr, std::memory_order_relaxed );
+        block->inUse.store( true, std::memory_order_relaxed );
+        block->next = s_histogramBlocks.load( std::memory_order_relaxed );
+        while( !s_histogramBlocks.compare_exchange_weak( block->next, block, std::memory_order_release, std::memory_order_relaxed ) ) {}
+    }
+    s_histogramBlockOwner.block = block;
+    s_histogramBlock = block;
+    return block->buckets;
+}
+
+TRACY_API std::atomic<uint64_t>* AllocHistogramBuckets( uint32_t id )
+{
+    assert( s_histogramBlock );
+    if( s_histogramBlock == &s_histogramDiscard ) return s_histogramDiscardBuckets;
+    InitRPMallocThread();
+    auto buckets = (std::atomic<uint64_t>*)tracy_malloc( sizeof( std::atomic<uint64_t> ) * HistogramBuckets );
+    for( int i=0; i<HistogramBuckets; i++ ) buckets[i].store( 0, std::memory_order_relaxed );
+    s_histogramBlock->buckets[id].store( buckets, std::memory_order_release );
+    return buckets;
+}
+
 #ifdef TRACY_DELAYED_INIT
 struct ThreadNameData;
 TRACY_API moodycamel::ConcurrentQueue<QueueItem>& GetQueue();
@@ -1021,32 +1300,94 @@ TRACY_API LuaZoneState& GetLuaZoneState() { return s_luaZoneState; }
 #endif
 
 Profiler::Profiler()
-    : m_timeBegin( 0 )
+    : m_timerMul( 1. )
+    , m_resolution( 0 )
+    , m_delay( 0 )
+    , m_calibrated( false )
+    , m_timeBegin( 0 )
     , m_mainThread( detail::GetThreadHandleImpl() )
     , m_epoch( std::chrono::duration_cast<std::chrono::seconds>( std::chrono::system_clock::now().time_since_epoch() ).count() )
     , m_shutdown( false )
     , m_shutdownManual( false )
     , m_shutdownFinished( false )
     , m_sock( nullptr )
+    , m_listen( nullptr )
     , m_broadcast( nullptr )
+    , m_parentPid( 0 )
     , m_noExit( false )
     , m_userPort( 0 )
     , m_zoneId( 1 )
     , m_samplingPeriod( 0 )
     , m_stream( LZ4_createStream() )
-    , m_buffer( (char*)tracy_malloc( TargetFrameSize*3 ) )
+    , m_buffer( (char*)tracy_malloc( SendBufferSize ) )
     , m_bufferOffset( 0 )
     , m_bufferStart( 0 )
-    , m_lz4Buf( (char*)tracy_malloc( LZ4Size + sizeof( lz4sz_t ) ) )
-    , m_serialQueue( 1024*1024 )
-    , m_serialDequeue( 1024*1024 )
+    , m_sendPos( 0 )
+    , m_lz4Buf( (char*)tracy_malloc( NetFrameMaxSize + sizeof( lz4sz_t ) ) )
+    , m_netCodec( NetworkCodecLz4 )
+#ifdef TRACY_ZSTD
+    , m_zstdStream( ZSTD_createCCtx() )
+    , m_zstdLevel( ZstdLevelInit )
+    , m_zstdLevelNext( ZstdLevelInit )
+#endif
+    , m_sendHead( 0 )
+    , m_sendTail( 0 )
+    , m_sendFailed( false )
+    , m_sendExit( false )
+#ifdef TRACY_PROFILER_STATS
+    , m_sendCompressTime( 0 )
+    , m_sendSocketTime( 0 )
+    , m_sendBytes( 0 )
+#endif
+    , m_serialQueue( SerialQueueCapacity )
+    , m_serialDequeue( SerialQueueCapacity )
     , m_fiQueue( 16 )
     , m_fiDequeue( 16 )
     , m_frameCount( 0 )
+    , m_retentionSetName( 0 )
+    , m_retentionSetThreshold( 0 )
+    , m_retentionSetKeepEvery( 0 )
+    , m_retentionActive( false )
+    , m_retentionName( 0 )
+    , m_retentionThreshold( 0 )
+    , m_retentionKeepEvery( 0 )
+    , m_retentionLastFrame( 0 )
+    , m_retentionFrameNum( 0 )
+    , m_retentionBuffer( nullptr )
+    , m_retentionBuffers( 16 )
+    , m_retentionFlags( 1024 )
+#ifdef TRACY_HAS_CRASH_DUMP
+    , m_crashDumpFd( -1 )
+    , m_crashDumpPath( nullptr )
+    , m_crashDumpActive( false )
+    , m_crashDumpQueries( nullptr )
+    , m_crashDumpQueryCount( 0 )
+#endif
 #ifdef TRACY_ON_DEMAND
     , m_isConnected( false )
+    , m_isCaptureSuspended( false )
     , m_connectionId( 0 )
+    , m_hasConnection( false )
+    , m_captureOpen( true )
     , m_deferredQueue( 64*1024 )
+#endif
+    , m_counterLast( 0 )
+    , m_queueMemoryLast( 0 )
+    , m_queueMemoryIntervals( 0 )
+    , m_queuePeak( 0 )
+    , m_serialPeak( 0 )
+    , m_serialMemory( 0 )
+#ifdef TRACY_PROFILER_STATS
+    , m_statLast( 0 )
+    , m_statDequeueTime( 0 )
+    , m_statSerialTime( 0 )
+    , m_statCommitTime( 0 )
+    , m_statSymbolTime( 0 )
+    , m_statCompressLast( 0 )
+    , m_statSocketLast( 0 )
+    , m_statSentLast( 0 )
+    , m_statQueuePeak( 0 )
+    , m_statDropped( 0 )
 #endif
     , m_paramCallback( nullptr )
 {
@@ -1062,8 +1403,6 @@ Profiler::Profiler()
 #  endif
 #endif
 
-    CalibrateTimer();
-    CalibrateDelay();
     ReportTopology();
 
 #ifndef TRACY_NO_EXIT
@@ -1080,12 +1419,27 @@ Profiler::Profiler()
         m_userPort = atoi( userPort );
     }
 
+#ifdef TRACY_HAS_CRASH_DUMP
+    // Not much can be done safely in a crashed process, so the query table is allocated up
+    // front. The file is only created when there is a dump to write.
+    const char* crashDump = getenv( "TRACY_CRASH_DUMP" );
+    if( crashDump && crashDump[0] != '\0' )
+    {
+        m_crashDumpPath = crashDump;
+        m_crashDumpQueries = (ServerQueryPacket*)tracy_malloc( sizeof( ServerQueryPacket ) * CrashDumpQueryCapacity );
+        memset( m_crashDumpQueries, 0, sizeof( ServerQueryPacket ) * CrashDumpQueryCapacity );
+    }
+#endif
+
     s_thread = (Thread*)tracy_malloc( sizeof( Thread ) );
     new(s_thread) Thread( LaunchWorker, this );
 
     s_compressThread = (Thread*)tracy_malloc( sizeof( Thread ) );
     new(s_compressThread) Thread( LaunchCompressWorker, this );
 
+    s_sendThread = (Thread*)tracy_malloc( sizeof( Thread ) );
+    new(s_sendThread) Thread( LaunchSendWorker, this );
+
 #ifdef TRACY_HAS_SYSTEM_TRACING
     if( SysTraceStart( m_samplingPeriod ) )
     {
@@ -1097,6 +1451,7 @@ Profiler::Profiler()
 
 #if defined _WIN32 || defined __CYGWIN__
     s_profilerThreadId = GetThreadId( s_thread->Handle() );
+    s_sendThreadId = GetThreadId( s_sendThread->Handle() );
     AddVectoredExceptionHandler( 1, CrashFilter );
 #endif
 
@@ -1115,8 +1470,15 @@ Profiler::Profiler()
     sigaction( SIGBUS, &crashHandler, nullptr );
 #endif
 
+#ifdef TRACY_HAS_FORK_HANDLER
+    pthread_atfork( ForkPrepare, ForkParent, ForkChild );
+#endif
+
 #ifdef TRACY_HAS_CALLSTACK
-    InitCallstack();
+    // Loading debug information may take a long time, don't hold up the application startup.
+    InitCallstackCritical();
+    s_callstackInitThread = (Thread*)tracy_malloc( sizeof( Thread ) );
+    new(s_callstackInitThread) Thread( CallstackInitWorker, nullptr );
 #endif
 
     m_timeBegin.store( GetTime(), std::memory_order_relaxed );
@@ -1135,14 +1497,43 @@ Profiler::~Profiler()
     }
 #endif
 
-    s_compressThread->~Thread();
-    tracy_free( s_compressThread );
-    s_thread->~Thread();
-    tracy_free( s_thread );
+    if( s_thread )
+    {
+        s_compressThread->~Thread();
+        tracy_free( s_compressThread );
+        s_thread->~Thread();
+        tracy_free( s_thread );
+        // The profiler thread has finished sending, the send ring is empty.
+        m_sendExit.store( true, std::memory_order_relaxed );
+        s_sendThread->~Thread();
+        tracy_free( s_sendThread );
+    }
+
+#ifdef TRACY_HAS_CALLSTACK
+    if( s_callstackInitThread )
+    {
+        s_callstackInitThread->~Thread();
+        tracy_free( s_callstackInitThread );
+    }
+#endif
+
+    ClearRetention();
+    for( auto& v : m_retentionBuffers )
+    {
+        v->~RetentionBuffer();
+        tracy_free( v );
+    }
+
+#ifdef TRACY_HAS_CRASH_DUMP
+    if( m_crashDumpQueries ) tracy_free( m_crashDumpQueries );
+#endif
 
     tracy_free( m_lz4Buf );
     tracy_free( m_buffer );
     LZ4_freeStream( (LZ4_stream_t*)m_stream );
+#ifdef TRACY_ZSTD
+    ZSTD_freeCCtx( (ZSTD_CCtx*)m_zstdStream );
+#endif
 
     if( m_sock )
     {
@@ -1150,6 +1541,12 @@ Profiler::~Profiler()
         tracy_free( m_sock );
     }
 
+    if( m_listen )
+    {
+        m_listen->~ListenSocket();
+        tracy_free( m_listen );
+    }
+
     if( m_broadcast )
     {
         m_broadcast->~UdpBroadcast();
@@ -1160,6 +1557,203 @@ Profiler::~Profiler()
     s_instance = nullptr;
 }
 
+#ifdef TRACY_HAS_FORK_HANDLER
+// Locks are held across fork(), so that the child process doesn't inherit them in a locked state.
+static bool s_forkLocked = false;
+
+void Profiler::ForkPrepare()
+{
+    if( !s_instance || ShouldExit() ) return;
+    s_forkLocked = true;
+    auto& profiler = *s_instance;
+#ifdef TRACY_ON_DEMAND
+    profiler.m_captureLock.lock();
+    profiler.m_deferredLock.lock();
+#endif
+    profiler.m_fiLock.lock();
+    profiler.m_serialLock.lock();
+    LockCounters();
+}
+
+void Profiler::ForkParent()
+{
+    if( !s_forkLocked ) return;
+    s_forkLocked = false;
+    auto& profiler = *s_instance;
+    UnlockCounters();
+    profiler.m_serialLock.unlock();
+    profiler.m_fiLock.unlock();
+#ifdef TRACY_ON_DEMAND
+    profiler.m_deferredLock.unlock();
+    profiler.m_captureLock.unlock();
+#endif
+}
+
+void Profiler::ForkChild()
+{
+    if( !s_forkLocked ) return;
+    s_forkLocked = false;
+    // Only the thread which has called fork() is running in the child process, and it is the
+    // owner of the locks taken in ForkPrepare(). They are released before the reset, which
+    // takes some of them again.
+    auto& profiler = *s_instance;
+    UnlockCounters();
+    profiler.m_serialLock.unlock();
+    profiler.m_fiLock.unlock();
+#ifdef TRACY_ON_DEMAND
+    profiler.m_deferredLock.unlock();
+    profiler.m_captureLock.unlock();
+#endif
+    profiler.ResetAfterFork();
+}
+
+// Frees what the child process has inherited from the parent's profiler threads, which don't
+// exist in the child and can't be joined.
+void Profiler::ReleaseParentState()
+{
+    tracy_free( s_thread );
+    tracy_free( s_compressThread );
+    tracy_free( s_sendThread );
+    s_thread = nullptr;
+    s_compressThread = nullptr;
+    s_sendThread = nullptr;
+#ifdef TRACY_HAS_SYSTEM_TRACING
+    if( s_sysTraceThread )
+    {
+        tracy_free( s_sysTraceThread );
+        s_sysTraceThread = nullptr;
+    }
+    m_samplingPeriod = 0;
+#endif
+#ifdef TRACY_HAS_CALLSTACK
+    if( s_callstackInitThread )
+    {
+        tracy_free( s_callstackInitThread );
+        s_callstackInitThread = nullptr;
+    }
+#endif
+
+    // Inherited descriptors refer to the parent's sockets. The child doesn't write crash dumps.
+    if( m_sock )
+    {
+        m_sock->~Socket();
+        tracy_free( m_sock );
+        m_sock = nullptr;
+    }
+    if( m_listen )
+    {
+        m_listen->~ListenSocket();
+        tracy_free( m_listen );
+        m_listen = nullptr;
+    }
+    if( m_broadcast )
+    {
+        m_broadcast->~UdpBroadcast();
+        tracy_free( m_broadcast );
+        m_broadcast = nullptr;
+    }
+#ifdef TRACY_HAS_CRASH_DUMP
+    m_crashDumpPath = nullptr;
+#endif
+}
+
+// Runs in the fork handler of the child process. The child gets its own profiler threads and
+// listening port, and is profiled as a separate program.
+void Profiler::ResetAfterFork()
+{
+    ReleaseParentState();
+
+    // Queued events belong to the parent's trace.
+    moodycamel::ConsumerToken token( GetQueue() );
+    ClearQueues( token );
+    for( auto& v : m_fiQueue ) tracy_free( v.image );
+    m_fiQueue.clear();
+    for( auto& v : m_fiDequeue ) tracy_free( v.image );
+    m_fiDequeue.clear();
+    m_bufferOffset = 0;
+    m_bufferStart = 0;
+    m_sendPos = 0;
+    m_sendHead.store( 0, std::memory_order_relaxed );
+    m_sendTail.store( 0, std::memory_order_relaxed );
+    m_sendFailed.store( false, std::memory_order_relaxed );
+
+#ifdef TRACY_ON_DEMAND
+    m_isConnected.store( false, std::memory_order_relaxed );
+    m_isCaptureSuspended.store( false, std::memory_order_relaxed );
+    m_hasConnection = false;
+#endif
+
+    // The forking thread, which runs the handler, has a new id in the child process.
+    m_mainThread = detail::GetThreadHandleImpl();
+#ifndef TRACY_DELAYED_INIT
+    s_threadHandle = ThreadHandleWrapper { m_mainThread };
+#endif
+    GetToken()->threadId = m_mainThread;
+    m_parentPid = uint64_t( getppid() );
+
+    s_thread = (Thread*)tracy_malloc( sizeof( Thread ) );
+    new(s_thread) Thread( LaunchWorker, this );
+
+    s_compressThread = (Thread*)tracy_malloc( sizeof( Thread ) );
+    new(s_compressThread) Thread( LaunchCompressWorker, this );
+
+    s_sendThread = (Thread*)tracy_malloc( sizeof( Thread ) );
+    new(s_sendThread) Thread( LaunchSendWorker, this );
+
+#ifdef TRACY_HAS_CALLSTACK
+    // fork() doesn't wait for the debug information to be loaded. If the parent was still
+    // loading it, the partially read state is abandoned and loading starts over.
+    if( !s_callstackReady.load( std::memory_order_acquire ) )
+    {
+        s_callstackInitThread = (Thread*)tracy_malloc( sizeof( Thread ) );
+        new(s_callstackInitThread) Thread( CallstackInitWorker, nullptr );
+    }
+#endif
+}
+#endif
+
+void Profiler::StartCapture()
+{
+#ifdef TRACY_ON_DEMAND
+    auto& profiler = GetProfiler();
+    profiler.m_captureLock.lock();
+    if( !profiler.m_captureOpen )
+    {
+        profiler.m_captureOpen = true;
+        if( profiler.m_hasConnection )
+        {
+            TracyLfqPrepare( QueueType::CaptureStart );
+            MemWrite( &item->captureWindow.time, GetTime() );
+            TracyLfqCommit;
+            profiler.m_isCaptureSuspended.store( false, std::memory_order_release );
+            profiler.m_isConnected.store( true, std::memory_order_release );
+        }
+    }
+    profiler.m_captureLock.unlock();
+#endif
+}
+
+void Profiler::StopCapture()
+{
+#ifdef TRACY_ON_DEMAND
+    auto& profiler = GetProfiler();
+    profiler.m_captureLock.lock();
+    if( profiler.m_captureOpen )
+    {
+        profiler.m_captureOpen = false;
+        if( profiler.m_hasConnection )
+        {
+            profiler.m_isCaptureSuspended.store( true, std::memory_order_release );
+            profiler.m_isConnected.store( false, std::memory_order_release );
+            TracyLfqPrepare( QueueType::CaptureStop );
+            MemWrite( &item->captureWindow.time, GetTime() );
+            TracyLfqCommit;
+        }
+    }
+    profiler.m_captureLock.unlock();
+#endif
+}
+
 bool Profiler::ShouldExit()
 {
     return s_instance->m_shutdown.load( std::memory_order_relaxed );
@@ -1174,12 +1768,18 @@ void Profiler::Worker()
     SetThreadName( "Tracy Profiler" );
 
 #ifdef TRACY_DATA_PORT
-    const bool dataPortSearch = false;
+    bool dataPortSearch = false;
     auto dataPort = m_userPort != 0 ? m_userPort : TRACY_DATA_PORT;
 #else
-    const bool dataPortSearch = m_userPort == 0;
+    bool dataPortSearch = m_userPort == 0;
     auto dataPort = m_userPort != 0 ? m_userPort : 8086;
 #endif
+    // The port is still used by the parent process.
+    if( m_parentPid != 0 && !dataPortSearch )
+    {
+        dataPortSearch = true;
+        dataPort++;
+    }
 #ifdef TRACY_BROADCAST_PORT
     const auto broadcastPort = TRACY_BROADCAST_PORT;
 #else
@@ -1190,6 +1790,15 @@ void Profiler::Worker()
 
     rpmalloc_thread_initialize();
 
+    // Calibration is done here, so that it doesn't delay startup of the application. The results
+    // are only needed by the server, and are sent in the welcome message.
+    if( !m_calibrated )
+    {
+        CalibrateTimer();
+        CalibrateDelay();
+        m_calibrated = true;
+    }
+
     const auto procname = GetProcessName();
     const auto pnsz = std::min<size_t>( strlen( procname ), WelcomeMessageProgramNameSize - 1 );
 
@@ -1246,9 +1855,15 @@ void Profiler::Worker()
     MemWrite( &welcome.epoch, m_epoch );
     MemWrite( &welcome.pid, pid );
     MemWrite( &welcome.samplingPeriod, m_samplingPeriod );
+#ifdef TRACY_MEMORY_SAMPLING
+    MemWrite( &welcome.memSamplingInterval, uint64_t( TRACY_MEMORY_SAMPLING ) );
+#else
+    MemWrite( &welcome.memSamplingInterval, uint64_t( 0 ) );
+#endif
     MemWrite( &welcome.onDemand, onDemand );
     MemWrite( &welcome.isApple, isApple );
     MemWrite( &welcome.cpuArch, cpuArch );
+    MemWrite( &welcome.codec, uint8_t( NetworkCodecLz4 ) );
     memcpy( welcome.cpuManufacturer, manufacturer, 12 );
     MemWrite( &welcome.cpuId, cpuId );
     memcpy( welcome.programName, procname, pnsz );
@@ -1258,17 +1873,22 @@ void Profiler::Worker()
 
     moodycamel::ConsumerToken token( GetQueue() );
 
-    ListenSocket listen;
+#ifndef TRACY_ON_DEMAND
+    m_counterLast = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+#endif
+
+    m_listen = (ListenSocket*)tracy_malloc( sizeof( ListenSocket ) );
+    new(m_listen) ListenSocket();
     bool isListening = false;
     if( !dataPortSearch )
     {
-        isListening = listen.Listen( dataPort, 4 );
+        isListening = m_listen->Listen( dataPort, 4 );
     }
     else
     {
         for( uint32_t i=0; i<20; i++ )
         {
-            if( listen.Listen( dataPort+i, 4 ) )
+            if( m_listen->Listen( dataPort+i, 4 ) )
             {
                 dataPort += i;
                 isListening = true;
@@ -1303,7 +1923,7 @@ void Profiler::Worker()
 #endif
 
     int broadcastLen = 0;
-    auto& broadcastMsg = GetBroadcastMessage( procname, pnsz, broadcastLen, dataPort );
+    auto& broadcastMsg = GetBroadcastMessage( procname, pnsz, broadcastLen, dataPort, pid, m_parentPid );
     uint64_t lastBroadcast = 0;
 
     // Connections loop.
@@ -1317,15 +1937,20 @@ void Profiler::Worker()
 #ifndef TRACY_NO_EXIT
             if( !m_noExit && ShouldExit() )
             {
+#ifdef TRACY_HAS_CRASH_DUMP
+                if( m_crashDumpPath && s_alreadyCrashed.load( std::memory_order_relaxed ) ) WriteCrashDump( token, welcome );
+#endif
                 m_shutdownFinished.store( true, std::memory_order_relaxed );
                 return;
             }
 #endif
-            m_sock = listen.Accept();
+            m_sock = m_listen->Accept();
             if( m_sock ) break;
 #ifndef TRACY_ON_DEMAND
             ProcessSysTime();
+            ProcessCounters();
 #endif
+            ProcessQueueMemory();
 
             if( m_broadcast )
             {
@@ -1371,27 +1996,63 @@ void Profiler::Worker()
                 m_sock = nullptr;
                 continue;
             }
+
+            uint8_t codecs;
+            res = m_sock->ReadRaw( &codecs, sizeof( codecs ), 2000 );
+            if( !res )
+            {
+                m_sock->~Socket();
+                tracy_free( m_sock );
+                m_sock = nullptr;
+                continue;
+            }
+#ifdef TRACY_ZSTD
+            m_netCodec = ( codecs & ( 1 << NetworkCodecZstd ) ) ? NetworkCodecZstd : NetworkCodecLz4;
+#else
+            m_netCodec = NetworkCodecLz4;
+#endif
         }
 
 #ifdef TRACY_ON_DEMAND
         const auto currentTime = GetTime();
         ClearQueues( token );
         m_connectionId.fetch_add( 1, std::memory_order_release );
-        m_isConnected.store( true, std::memory_order_release );
+        m_captureLock.lock();
+        const auto captureOpen = m_captureOpen;
+        m_hasConnection = true;
+        m_isConnected.store( captureOpen, std::memory_order_release );
+        m_isCaptureSuspended.store( !captureOpen, std::memory_order_release );
+        m_captureLock.unlock();
 #endif
 
         HandshakeStatus handshake = HandshakeWelcome;
         m_sock->Send( &handshake, sizeof( handshake ) );
 
+        // The send ring was flushed when the previous connection was closed.
         LZ4_resetStream( (LZ4_stream_t*)m_stream );
+#ifdef TRACY_ZSTD
+        ZSTD_CCtx_reset( (ZSTD_CCtx*)m_zstdStream, ZSTD_reset_session_and_parameters );
+        ZSTD_CCtx_setParameter( (ZSTD_CCtx*)m_zstdStream, ZSTD_c_compressionLevel, ZstdLevelInit );
+        m_zstdLevel.store( ZstdLevelInit, std::memory_order_relaxed );
+        m_zstdLevelNext = ZstdLevelInit;
+#endif
+        m_sendFailed.store( false, std::memory_order_relaxed );
+        MemWrite( &welcome.codec, m_netCodec );
         m_sock->Send( &welcome, sizeof( welcome ) );
+#ifdef TRACY_PROFILER_STATS
+        m_statLast = 0;
+#endif
 
         m_threadCtx = 0;
         m_refTimeSerial = 0;
         m_refTimeCtx = 0;
         m_refTimeGpu = 0;
+        m_sentSourceLocation.Clear();
 
 #ifdef TRACY_ON_DEMAND
+        // Events counted without a connection are not reported.
+        m_counterLast = 0;
+
         OnDemandPayloadMessage onDemand;
         onDemand.frames = m_frameCount.load( std::memory_order_relaxed );
         onDemand.currentTime = currentTime;
@@ -1419,6 +2080,19 @@ void Profiler::Worker()
             AppendData( &item, QueueDataSize[idx] );
         }
         m_deferredLock.unlock();
+
+        if( !captureOpen )
+        {
+            QueueItem item;
+            MemWrite( &item.hdr.type, QueueType::CaptureStop );
+            MemWrite( &item.captureWindow.time, currentTime );
+            AppendData( &item, QueueDataSize[(int)QueueType::CaptureStop] );
+        }
+#endif
+
+#ifdef TRACY_HAS_MODULE_BUILD_ID
+        m_moduleGeneration = 0;
+        SendModuleInfo();
 #endif
 
         // Main communications loop
@@ -1426,8 +2100,24 @@ void Profiler::Worker()
         for(;;)
         {
             ProcessSysTime();
+            ProcessCounters();
+            ProcessQueueMemory();
+            ProcessProfilerStats();
+#ifdef TRACY_PROFILER_STATS
+            const auto t0 = GetStatTime();
+            const auto commit0 = m_statCommitTime;
+#endif
             const auto status = Dequeue( token );
+#ifdef TRACY_PROFILER_STATS
+            const auto t1 = GetStatTime();
+            const auto commit1 = m_statCommitTime;
+#endif
             const auto serialStatus = DequeueSerial();
+#ifdef TRACY_PROFILER_STATS
+            const auto t2 = GetStatTime();
+            m_statDequeueTime += t1 - t0 - ( commit1 - commit0 );
+            m_statSerialTime += t2 - t1 - ( m_statCommitTime - commit1 );
+#endif
             if( status == DequeueStatus::ConnectionLost || serialStatus == DequeueStatus::ConnectionLost )
             {
                 break;
@@ -1468,10 +2158,14 @@ void Profiler::Worker()
         }
         if( ShouldExit() ) break;
 
+        FlushSendRing();
 #ifdef TRACY_ON_DEMAND
+        m_captureLock.lock();
+        m_hasConnection = false;
         m_isConnected.store( false, std::memory_order_release );
-        m_bufferOffset = 0;
-        m_bufferStart = 0;
+        m_isCaptureSuspended.store( false, std::memory_order_release );
+        m_captureLock.unlock();
+        m_bufferOffset = m_bufferStart;
 #endif
 
         m_sock->~Socket();
@@ -1490,7 +2184,7 @@ void Profiler::Worker()
 
             ClearQueues( token );
 
-            m_sock = listen.Accept();
+            m_sock = m_listen->Accept();
             if( m_sock )
             {
                 char shibboleth[HandshakeShibbolethSize];
@@ -1535,6 +2229,11 @@ void Profiler::Worker()
         }
         else if( status == DequeueStatus::QueueEmpty && serialStatus == DequeueStatus::QueueEmpty )
         {
+            if( !FlushRetention( true ) )
+            {
+                m_shutdownFinished.store( true, std::memory_order_relaxed );
+                return;
+            }
             if( m_bufferOffset != m_bufferStart ) CommitData();
             break;
         }
@@ -1552,7 +2251,8 @@ void Profiler::Worker()
     // Send client termination notice to the server
     QueueItem terminate;
     MemWrite( &terminate.hdr.type, QueueType::Terminate );
-    if( !SendData( (const char*)&terminate, 1 ) )
+    AppendData( &terminate, 1 );
+    if( !CommitData() )
     {
         m_shutdownFinished.store( true, std::memory_order_relaxed );
         return;
@@ -1654,6 +2354,88 @@ void Profiler::CompressWorker()
     }
 }
 
+struct InternedSourceLocation
+{
+    uint64_t hash;
+    uint64_t connection;    // only accessed by the profiler worker thread
+    // allocated source location payload follows
+};
+
+enum { InternedSourceLocationTableSize = 16*1024 };
+enum { InternedSourceLocationMaxProbe = 64 };
+static std::atomic<InternedSourceLocation*> s_internedSourceLocations[InternedSourceLocationTableSize];
+
+static tracy_force_inline uint64_t HashBytes( uint64_t hash, const char* data, size_t sz )
+{
+    for( size_t i=0; i<sz; i++ )
+    {
+        hash ^= uint8_t( data[i] );
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+uint64_t Profiler::InternSourceLocation( uint32_t line, const char* source, size_t sourceSz, const char* function, size_t functionSz, const char* name, size_t nameSz )
+{
+    const uint32_t sz = uint32_t( 4 + 4 + 4 + functionSz + 1 + sourceSz + 1 + nameSz );
+    if( sz > std::numeric_limits<uint16_t>::max() ) return 0;
+    InitRPMallocThread();
+
+    uint64_t hash = 0xCBF29CE484222325ull ^ line;
+    hash = HashBytes( hash, function, functionSz + 1 );
+    hash = HashBytes( hash, source, sourceSz + 1 );
+    hash = HashBytes( hash, name, nameSz );
+    if( hash == 0 ) hash = 1;
+
+    auto matches = [&]( const InternedSourceLocation* entry ) {
+        if( entry->hash != hash ) return false;
+        auto ptr = (const char*)( entry + 1 );
+        if( memcmp( ptr, &sz, 4 ) != 0 || memcmp( ptr + 8, &line, 4 ) != 0 ) return false;
+        ptr += 12;
+        if( memcmp( ptr, function, functionSz + 1 ) != 0 ) return false;
+        ptr += functionSz + 1;
+        if( memcmp( ptr, source, sourceSz + 1 ) != 0 ) return false;
+        ptr += sourceSz + 1;
+        return nameSz == 0 || memcmp( ptr, name, nameSz ) == 0;
+    };
+
+    InternedSourceLocation* created = nullptr;
+    auto idx = ( hash >> 16 ) & ( InternedSourceLocationTableSize - 1 );
+    for( int i=0; i<InternedSourceLocationMaxProbe; i++ )
+    {
+        auto& slot = s_internedSourceLocations[idx];
+        auto entry = slot.load( std::memory_order_acquire );
+        if( !entry )
+        {
+            if( !created )
+            {
+                created = (InternedSourceLocation*)tracy_malloc( sizeof( InternedSourceLocation ) + sz );
+                created->hash = hash;
+                created->connection = 0;
+                auto ptr = (char*)( created + 1 );
+                memcpy( ptr, &sz, 4 );
+                memset( ptr + 4, 0, 4 );
+                memcpy( ptr + 8, &line, 4 );
+                memcpy( ptr + 12, function, functionSz + 1 );
+                memcpy( ptr + 12 + functionSz + 1, source, sourceSz + 1 );
+                if( nameSz != 0 ) memcpy( ptr + 12 + functionSz + 1 + sourceSz + 1, name, nameSz );
+            }
+            if( slot.compare_exchange_strong( entry, created, std::memory_order_acq_rel, std::memory_order_acquire ) )
+            {
+                return uint64_t( created ) | 1;
+            }
+        }
+        if( matches( entry ) )
+        {
+            if( created ) tracy_free( created );
+            return uint64_t( entry ) | 1;
+        }
+        idx = ( idx + 1 ) & ( InternedSourceLocationTableSize - 1 );
+    }
+    if( created ) tracy_free( created );
+    return 0;
+}
+
 static void FreeAssociatedMemory( const QueueItem& item )
 {
     if( item.hdr.idx >= (int)QueueType::Terminate ) return;
@@ -1679,7 +2461,7 @@ static void FreeAssociatedMemory( const QueueItem& item )
     case QueueType::ZoneBeginAllocSrcLoc:
     case QueueType::ZoneBeginAllocSrcLocCallstack:
         ptr = MemRead<uint64_t>( &item.zoneBegin.srcloc );
-        tracy_free( (void*)ptr );
+        Profiler::FreeSourceLocation( ptr );
         break;
     case QueueType::CallstackMemory:
         ptr = MemRead<uint64_t>( &item.callstackMemory.ptr );
@@ -1703,6 +2485,10 @@ static void FreeAssociatedMemory( const QueueItem& item )
         ptr = MemRead<uint64_t>( &item.frameImage.image );
         tracy_free( (void*)ptr );
         break;
+    case QueueType::Histogram:
+        ptr = MemRead<uint64_t>( &item.histogram.data );
+        tracy_free( (void*)ptr );
+        break;
 #ifndef TRACY_ON_DEMAND
     case QueueType::LockName:
         ptr = MemRead<uint64_t>( &item.lockName.name );
@@ -1727,6 +2513,7 @@ void Profiler::ClearQueues( moodycamel::ConsumerToken& token )
         if( sz == 0 ) break;
     }
 
+    ClearRetention();
     ClearSerial();
 }
 
@@ -1752,12 +2539,328 @@ void Profiler::ClearSerial()
     m_serialDequeue.clear();
 }
 
+Profiler::RetentionBuffer* Profiler::GetRetentionBuffer( uint64_t thread )
+{
+    for( auto& v : m_retentionBuffers )
+    {
+        if( v->thread == thread ) return v;
+    }
+    auto buf = (RetentionBuffer*)tracy_malloc( sizeof( RetentionBuffer ) );
+    new(buf) RetentionBuffer( thread );
+    *m_retentionBuffers.push_next() = buf;
+    return buf;
+}
+
+tracy_force_inline bool Profiler::RetainItem( const QueueItem* item )
+{
+    auto buf = m_retentionBuffer;
+    switch( (QueueType)MemRead<uint8_t>( &item->hdr.idx ) )
+    {
+    case QueueType::Callstack:
+        // Call stacks are retained only if they are attached to a retained zone.
+        if( !buf->held ) return false;
+        break;
+    case QueueType::ZoneText:
+    case QueueType::ZoneName:
+    case QueueType::ZoneBeginAllocSrcLoc:
+    case QueueType::ZoneBeginAllocSrcLocCallstack:
+    case QueueType::ZoneBegin:
+    case QueueType::ZoneBeginCallstack:
+    case QueueType::ZoneEnd:
+    case QueueType::ZoneValidation:
+    case QueueType::ZoneValue:
+    case QueueType::ZoneFlowOut:
+    case QueueType::ZoneFlowIn:
+        buf->held = true;
+        break;
+    default:
+        buf->held = false;
+        return false;
+    }
+    memcpy( buf->items.push_next(), item, sizeof( QueueItem ) );
+    return true;
+}
+
+bool Profiler::UpdateRetention()
+{
+    auto threshold = m_retentionSetThreshold.load( std::memory_order_acquire );
+#ifdef TRACY_HAS_CRASH_DUMP
+    // Retention buffers may need to grow, so nothing is held while a crash dump is written.
+    if( m_crashDumpActive ) threshold = 0;
+#endif
+    if( threshold == 0 )
+    {
+        if( !m_retentionActive ) return true;
+        m_retentionActive = false;
+        return FlushRetention( true );
+    }
+
+    const auto name = m_retentionSetName.load( std::memory_order_relaxed );
+    if( name != m_retentionName || !m_retentionActive )
+    {
+        m_retentionName = name;
+        m_retentionLastFrame = 0;
+        m_retentionFrameNum = 0;
+    }
+    m_retentionThreshold = int64_t( threshold / m_timerMul );
+    m_retentionKeepEvery = m_retentionSetKeepEvery.load( std::memory_order_relaxed );
+    m_retentionActive = true;
+    return true;
+}
+
+bool Profiler::RetentionFrame( int64_t time )
+{
+    // The first frame is always kept, as there's no reference point to measure it.
+    const bool keep = m_retentionLastFrame == 0 ||
+        time - m_retentionLastFrame >= m_retentionThreshold ||
+        ( m_retentionKeepEvery != 0 && m_retentionFrameNum % m_retentionKeepEvery == 0 );
+    m_retentionLastFrame = time;
+    m_retentionFrameNum++;
+    return keep;
+}
+
+// Flushes the retained items while items of the current thread are being dequeued, after which
+// the thread context is restored.
+bool Profiler::FlushRetentionInQueue( bool keep, int64_t& refThread )
+{
+    const auto thread = m_threadCtx;
+    m_refTimeThread = refThread;
+    bool ok = FlushRetention( keep );
+    if( ok && m_threadCtx != thread )
+    {
+        QueueItem ctx;
+        MemWrite( &ctx.hdr.type, QueueType::ThreadContext );
+        MemWrite( &ctx.threadCtx.thread, thread );
+        ok = AppendData( &ctx, QueueDataSize[(int)QueueType::ThreadContext] );
+        m_threadCtx = thread;
+        m_refTimeThread = 0;
+    }
+    refThread = m_refTimeThread;
+    return ok;
+}
+
+static tracy_force_inline bool IsRetainedZoneBegin( uint8_t idx )
+{
+    switch( (QueueType)idx )
+    {
+    case QueueType::ZoneBegin:
+    case QueueType::ZoneBeginCallstack:
+    case QueueType::ZoneBeginAllocSrcLoc:
+    case QueueType::ZoneBeginAllocSrcLocCallstack:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool Profiler::FlushRetention( bool keep )
+{
+    for( auto& buf : m_retentionBuffers )
+    {
+        auto sz = buf->items.size();
+        if( sz == 0 ) continue;
+        auto items = buf->items.data();
+
+        // Zone begin with call stack must be sent together with the call stack item which follows it.
+        const auto lastIdx = MemRead<uint8_t>( &items[sz-1].hdr.idx );
+        bool split = lastIdx == (uint8_t)QueueType::ZoneBeginCallstack || lastIdx == (uint8_t)QueueType::ZoneBeginAllocSrcLocCallstack;
+#ifdef TRACY_HAS_CRASH_DUMP
+        // Retention is stopped for the crash dump, the call stack item will be sent right after.
+        if( m_crashDumpActive ) split = false;
+#endif
+        if( split ) sz--;
+
+        if( sz != 0 )
+        {
+            if( buf->thread != m_threadCtx )
+            {
+                QueueItem ctx;
+                MemWrite( &ctx.hdr.type, QueueType::ThreadContext );
+                MemWrite( &ctx.threadCtx.thread, buf->thread );
+                if( !AppendData( &ctx, QueueDataSize[(int)QueueType::ThreadContext] ) ) return false;
+                m_threadCtx = buf->thread;
+                m_refTimeThread = 0;
+            }
+
+            if( keep )
+            {
+                for( size_t i=0; i<sz; i++ )
+                {
+                    if( !SendRetainedItem( items+i ) ) return false;
+                }
+            }
+            else
+            {
+                // Only the zones which have both started and ended within the discarded frame
+                // can be dropped. Zones crossing the frame boundary are sent to keep the zone
+                // stacks on the server consistent. Find zones which are still open, going
+                // backwards from the frame end.
+                m_retentionFlags.clear();
+                for( size_t i=0; i<sz; i++ ) *m_retentionFlags.push_next() = 0;
+                auto flags = m_retentionFlags.data();
+                uint32_t pendingEnd = 0;
+                for( size_t i=sz; i>0; i-- )
+                {
+                    const auto idx = MemRead<uint8_t>( &items[i-1].hdr.idx );
+                    if( idx == (uint8_t)QueueType::ZoneEnd )
+                    {
+                        pendingEnd++;
+                    }
+                    else if( IsRetainedZoneBegin( idx ) )
+                    {
+                        if( pendingEnd == 0 )
+                        {
+                            flags[i-1] = 1;
+                        }
+                        else
+                        {
+                            pendingEnd--;
+                        }
+                    }
+                }
+
+                uint32_t dropDepth = 0;
+                for( size_t i=0; i<sz; i++ )
+                {
+                    auto item = items+i;
+                    const auto idx = MemRead<uint8_t>( &item->hdr.idx );
+                    bool send;
+                    if( IsRetainedZoneBegin( idx ) )
+                    {
+                        send = flags[i] != 0;
+                        if( !send ) dropDepth++;
+                    }
+                    else if( idx == (uint8_t)QueueType::ZoneEnd )
+                    {
+                        send = dropDepth == 0;
+                        if( !send ) dropDepth--;
+                    }
+                    else
+                    {
+                        send = dropDepth == 0;
+                    }
+                    if( send )
+                    {
+                        if( !SendRetainedItem( item ) ) return false;
+                    }
+                    else
+                    {
+                        FreeAssociatedMemory( *item );
+#ifdef TRACY_PROFILER_STATS
+                        m_statDropped++;
+#endif
+                    }
+                }
+            }
+        }
+
+        if( !split )
+        {
+            buf->items.clear();
+        }
+        else if( sz != 0 )
+        {
+            memcpy( items, items+sz, sizeof( QueueItem ) );
+            buf->items.clear();
+            buf->items.push_next();
+        }
+    }
+    return true;
+}
+
+// Handles the thread items which may be held by frame retention. Shared by Dequeue() and
+// SendRetainedItem(), so that retained items are sent exactly as they would be without retention.
+// Returns the type of the item to send.
+tracy_force_inline uint8_t Profiler::PrepareZoneItem( QueueItem* item, uint8_t idx, int64_t& refThread )
+{
+    uint64_t ptr;
+    switch( (QueueType)idx )
+    {
+    case QueueType::ZoneText:
+    case QueueType::ZoneName:
+        ptr = MemRead<uint64_t>( &item->zoneText.text );
+        SendString( ptr, (const char*)ptr, QueueType::CustomStringData );
+        FreePayload( ptr );
+        break;
+    case QueueType::ZoneBeginAllocSrcLoc:
+    case QueueType::ZoneBeginAllocSrcLocCallstack:
+    {
+        int64_t t = MemRead<int64_t>( &item->zoneBegin.time );
+        int64_t dt = t - refThread;
+        refThread = t;
+        MemWrite( &item->zoneBegin.time, dt );
+        ptr = MemRead<uint64_t>( &item->zoneBegin.srcloc );
+        if( ( ptr & 1 ) == 0 )
+        {
+            SendSourceLocationPayload( ptr, (const char*)ptr, QueueType::SourceLocationPayload );
+            FreePayload( ptr );
+            idx++;
+            MemWrite( &item->hdr.idx, idx );
+        }
+        else
+        {
+            SendInternedSourceLocation( ptr );
+        }
+        break;
+    }
+    case QueueType::Callstack:
+        ptr = MemRead<uint64_t>( &item->callstack.ptr );
+        SendCallstackPayload( ptr );
+        FreePayload( ptr );
+        idx++;
+        MemWrite( &item->hdr.idx, idx );
+        break;
+    case QueueType::ZoneBegin:
+    case QueueType::ZoneBeginCallstack:
+    {
+        int64_t t = MemRead<int64_t>( &item->zoneBegin.time );
+        int64_t dt = t - refThread;
+        refThread = t;
+        MemWrite( &item->zoneBegin.time, dt );
+        CheckStaticSourceLocation( MemRead<uint64_t>( &item->zoneBegin.srcloc ) );
+        break;
+    }
+    case QueueType::ZoneEnd:
+    {
+        int64_t t = MemRead<int64_t>( &item->zoneEnd.time );
+        int64_t dt = t - refThread;
+        refThread = t;
+        MemWrite( &item->zoneEnd.time, dt );
+        break;
+    }
+    default:
+        break;
+    }
+    return idx;
+}
+
+bool Profiler::SendRetainedItem( QueueItem* item )
+{
+    const auto idx = PrepareZoneItem( item, MemRead<uint8_t>( &item->hdr.idx ), m_refTimeThread );
+    return AppendData( item, QueueDataSize[idx] );
+}
+
+void Profiler::ClearRetention()
+{
+    for( auto& buf : m_retentionBuffers )
+    {
+        for( auto& v : buf->items ) FreeAssociatedMemory( v );
+        buf->items.clear();
+        buf->held = false;
+    }
+    m_retentionLastFrame = 0;
+    m_retentionFrameNum = 0;
+}
+
 Profiler::DequeueStatus Profiler::Dequeue( moodycamel::ConsumerToken& token )
 {
+    if( !UpdateRetention() ) return DequeueStatus::ConnectionLost;
+
     bool connectionLost = false;
     const auto sz = GetQueue().try_dequeue_bulk_single( token,
         [this, &connectionLost] ( const uint64_t& threadId )
         {
+            if( m_retentionActive ) m_retentionBuffer = GetRetentionBuffer( threadId );
             if( threadId != m_threadCtx )
             {
                 QueueItem item;
@@ -1766,6 +2869,9 @@ Profiler::DequeueStatus Profiler::Dequeue( moodycamel::ConsumerToken& token )
                 if( !AppendData( &item, QueueDataSize[(int)QueueType::ThreadContext] ) ) connectionLost = true;
                 m_threadCtx = threadId;
                 m_refTimeThread = 0;
+#ifdef TRACY_HAS_CRASH_DUMP
+                if( m_crashDumpActive ) CollectCrashDumpQuery( ServerQueryThreadString, threadId );
+#endif
             }
         },
         [this, &connectionLost] ( QueueItem* item, size_t sz )
@@ -1779,15 +2885,50 @@ Profiler::DequeueStatus Profiler::Dequeue( moodycamel::ConsumerToken& token )
             {
                 uint64_t ptr;
                 auto idx = MemRead<uint8_t>( &item->hdr.idx );
+#ifdef TRACY_HAS_CRASH_DUMP
+                if( m_crashDumpActive ) CollectCrashDumpQueries( item );
+#endif
+                if( m_retentionActive )
+                {
+                    // Frames which are too long to be held, or a frame set which is not marked at
+                    // all, must not make the retention buffers grow without bound. Such frames
+                    // are sent.
+                    if( m_retentionBuffer->items.size() >= RetentionBufferLimit && !FlushRetentionInQueue( true, refThread ) )
+                    {
+                        connectionLost = true;
+                        m_refTimeCtx = refCtx;
+                        m_refTimeGpu = refGpu;
+                        return;
+                    }
+                    if( RetainItem( item ) )
+                    {
+                        item++;
+                        continue;
+                    }
+                    if( idx == (uint8_t)QueueType::FrameMarkMsg && MemRead<uint64_t>( &item->frameMark.name ) == m_retentionName )
+                    {
+                        if( !FlushRetentionInQueue( RetentionFrame( MemRead<int64_t>( &item->frameMark.time ) ), refThread ) )
+                        {
+                            connectionLost = true;
+                            m_refTimeCtx = refCtx;
+                            m_refTimeGpu = refGpu;
+                            return;
+                        }
+                    }
+                }
                 if( idx < (int)QueueType::Terminate )
                 {
                     switch( (QueueType)idx )
                     {
                     case QueueType::ZoneText:
                     case QueueType::ZoneName:
-                        ptr = MemRead<uint64_t>( &item->zoneText.text );
-                        SendString( ptr, (const char*)ptr, QueueType::CustomStringData );
-                        tracy_free( (void*)ptr );
+                    case QueueType::ZoneBeginAllocSrcLoc:
+                    case QueueType::ZoneBeginAllocSrcLocCallstack:
+                    case QueueType::Callstack:
+                    case QueueType::ZoneBegin:
+                    case QueueType::ZoneBeginCallstack:
+                    case QueueType::ZoneEnd:
+                        idx = PrepareZoneItem( item, idx, refThread );
                         break;
                     case QueueType::Message:
                     case QueueType::MessageColor:
@@ -1795,47 +2936,26 @@ Profiler::DequeueStatus Profiler::Dequeue( moodycamel::ConsumerToken& token )
                     case QueueType::MessageColorCallstack:
                         ptr = MemRead<uint64_t>( &item->message.text );
                         SendString( ptr, (const char*)ptr, QueueType::CustomStringData );
-                        tracy_free( (void*)ptr );
+                        FreePayload( ptr );
                         break;
                     case QueueType::MessageAppInfo:
                         ptr = MemRead<uint64_t>( &item->message.text );
                         SendString( ptr, (const char*)ptr, QueueType::CustomStringData );
 #ifndef TRACY_ON_DEMAND
-                        tracy_free( (void*)ptr );
+                        FreePayload( ptr );
 #endif
                         break;
-                    case QueueType::ZoneBeginAllocSrcLoc:
-                    case QueueType::ZoneBeginAllocSrcLocCallstack:
-                    {
-                        int64_t t = MemRead<int64_t>( &item->zoneBegin.time );
-                        int64_t dt = t - refThread;
-                        refThread = t;
-                        MemWrite( &item->zoneBegin.time, dt );
-                        ptr = MemRead<uint64_t>( &item->zoneBegin.srcloc );
-                        SendSourceLocationPayload( ptr );
-                        tracy_free( (void*)ptr );
-                        idx++;
-                        MemWrite( &item->hdr.idx, idx );
-                        break;
-                    }
-                    case QueueType::Callstack:
-                        ptr = MemRead<uint64_t>( &item->callstack.ptr );
-                        SendCallstackPayload( ptr );
-                        tracy_free( (void*)ptr );
-                        idx++;
-                        MemWrite( &item->hdr.idx, idx );
-                        break;
                     case QueueType::CallstackAlloc:
                         ptr = MemRead<uint64_t>( &item->callstackAlloc.nativePtr );
                         if( ptr != 0 )
                         {
                             CutCallstack( (void*)ptr, "lua_pcall" );
                             SendCallstackPayload( ptr );
-                            tracy_free( (void*)ptr );
+                            FreePayload( ptr );
                         }
                         ptr = MemRead<uint64_t>( &item->callstackAlloc.ptr );
                         SendCallstackAlloc( ptr );
-                        tracy_free( (void*)ptr );
+                        FreePayload( ptr );
                         idx++;
                         MemWrite( &item->hdr.idx, idx );
                         break;
@@ -1843,7 +2963,7 @@ Profiler::DequeueStatus Profiler::Dequeue( moodycamel::ConsumerToken& token )
                     {
                         ptr = MemRead<uint64_t>( &item->callstackSample.ptr );
                         SendCallstackPayload64( ptr );
-                        tracy_free( (void*)ptr );
+                        FreePayload( ptr );
                         int64_t t = MemRead<int64_t>( &item->callstackSample.time );
                         int64_t dt = t - refCtx;
                         refCtx = t;
@@ -1859,33 +2979,30 @@ Profiler::DequeueStatus Profiler::Dequeue( moodycamel::ConsumerToken& token )
                         const auto h = MemRead<uint16_t>( &item->frameImage.h );
                         const auto csz = size_t( w * h / 2 );
                         SendLongString( ptr, (const char*)ptr, csz, QueueType::FrameImageData );
-                        tracy_free( (void*)ptr );
+                        FreePayload( ptr );
                         idx++;
                         MemWrite( &item->hdr.idx, idx );
                         break;
                     }
-                    case QueueType::ZoneBegin:
-                    case QueueType::ZoneBeginCallstack:
-                    {
-                        int64_t t = MemRead<int64_t>( &item->zoneBegin.time );
-                        int64_t dt = t - refThread;
-                        refThread = t;
-                        MemWrite( &item->zoneBegin.time, dt );
-                        break;
-                    }
-                    case QueueType::ZoneEnd:
+                    case QueueType::Histogram:
                     {
-                        int64_t t = MemRead<int64_t>( &item->zoneEnd.time );
+                        ptr = MemRead<uint64_t>( &item->histogram.data );
+                        const auto cnt = *(const uint64_t*)ptr;
+                        SendLongString( ptr, (const char*)( ptr + sizeof( uint64_t ) ), cnt * sizeof( uint64_t ), QueueType::HistogramData );
+                        FreePayload( ptr );
+                        int64_t t = MemRead<int64_t>( &item->histogram.time );
                         int64_t dt = t - refThread;
                         refThread = t;
-                        MemWrite( &item->zoneEnd.time, dt );
+                        MemWrite( &item->histogram.time, dt );
+                        idx++;
+                        MemWrite( &item->hdr.idx, idx );
                         break;
                     }
                     case QueueType::LockName:
                         ptr = MemRead<uint64_t>( &item->lockName.name );
                         SendString( ptr, (const char*)ptr, QueueType::CustomStringData );
 #ifndef TRACY_ON_DEMAND
-                        tracy_free( (void*)ptr );
+                        FreePayload( ptr );
 #endif
                         break;
                     case QueueType::GpuZoneBegin:
@@ -1895,6 +3012,7 @@ Profiler::DequeueStatus Profiler::Dequeue( moodycamel::ConsumerToken& token )
                         int64_t dt = t - refThread;
                         refThread = t;
                         MemWrite( &item->gpuZoneBegin.cpuTime, dt );
+                        CheckStaticSourceLocation( MemRead<uint64_t>( &item->gpuZoneBegin.srcloc ) );
                         break;
                     }
                     case QueueType::GpuZoneEnd:
@@ -2040,16 +3158,21 @@ Profiler::DequeueStatus Profiler::DequeueSerial()
     }
 
     const auto sz = m_serialDequeue.size();
+    if( sz > m_serialPeak ) m_serialPeak = sz;
     if( sz > 0 )
     {
         int64_t refSerial = m_refTimeSerial;
         int64_t refGpu = m_refTimeGpu;
+        int64_t refThread = m_refTimeThread;
         auto item = m_serialDequeue.data();
         auto end = item + sz;
         while( item != end )
         {
             uint64_t ptr;
             auto idx = MemRead<uint8_t>( &item->hdr.idx );
+#ifdef TRACY_HAS_CRASH_DUMP
+            if( m_crashDumpActive ) CollectCrashDumpQueries( item );
+#endif
             if( idx < (int)QueueType::Terminate )
             {
                 switch( (QueueType)idx )
@@ -2057,7 +3180,7 @@ Profiler::DequeueStatus Profiler::DequeueSerial()
                 case QueueType::CallstackMemory:
                     ptr = MemRead<uint64_t>( &item->callstackMemory.ptr );
                     SendCallstackPayload( ptr );
-                    tracy_free( (void*)ptr );
+                    FreePayload( ptr );
                     idx++;
                     MemWrite( &item->hdr.idx, idx );
                     break;
@@ -2088,6 +3211,30 @@ Profiler::DequeueStatus Profiler::DequeueSerial()
                     MemWrite( &item->lockRelease.time, dt );
                     break;
                 }
+                case QueueType::WaitBegin:
+                {
+                    int64_t t = MemRead<int64_t>( &item->waitBegin.time );
+                    int64_t dt = t - refSerial;
+                    refSerial = t;
+                    MemWrite( &item->waitBegin.time, dt );
+                    break;
+                }
+                case QueueType::WaitEnd:
+                {
+                    int64_t t = MemRead<int64_t>( &item->waitEnd.time );
+                    int64_t dt = t - refSerial;
+                    refSerial = t;
+                    MemWrite( &item->waitEnd.time, dt );
+                    break;
+                }
+                case QueueType::WaitNotify:
+                {
+                    int64_t t = MemRead<int64_t>( &item->waitNotify.time );
+                    int64_t dt = t - refSerial;
+                    refSerial = t;
+                    MemWrite( &item->waitNotify.time, dt );
+                    break;
+                }
                 case QueueType::MemAlloc:
                 case QueueType::MemAllocCallstack:
                 {
@@ -2113,6 +3260,7 @@ Profiler::DequeueStatus Profiler::DequeueSerial()
                     int64_t dt = t - refSerial;
                     refSerial = t;
                     MemWrite( &item->gpuZoneBegin.cpuTime, dt );
+                    CheckStaticSourceLocation( MemRead<uint64_t>( &item->gpuZoneBegin.srcloc ) );
                     break;
                 }
                 case QueueType::GpuZoneEndSerial:
@@ -2131,39 +3279,388 @@ Profiler::DequeueStatus Profiler::DequeueSerial()
                     MemWrite( &item->gpuTime.gpuTime, dt );
                     break;
                 }
+                case QueueType::ZoneBegin:
+                case QueueType::ZoneEnd:
+                    idx = PrepareZoneItem( item, idx, refThread );
+                    break;
+                case QueueType::Message:
+                case QueueType::MessageColor:
+                    ptr = MemRead<uint64_t>( &item->message.text );
+                    SendString( ptr, (const char*)ptr, QueueType::CustomStringData );
+                    FreePayload( ptr );
+                    break;
+                case QueueType::PlotData:
+                {
+                    int64_t t = MemRead<int64_t>( &item->plotData.time );
+                    int64_t dt = t - refThread;
+                    refThread = t;
+                    MemWrite( &item->plotData.time, dt );
+                    break;
+                }
                 default:
                     assert( false );
                     break;
                 }
             }
-            if( !AppendData( item, QueueDataSize[idx] ) ) return DequeueStatus::ConnectionLost;
+            else if( idx == (int)QueueType::ThreadContext )
+            {
+                // Bulk events of other threads are preceded by a switch of the thread context.
+                m_threadCtx = MemRead<uint64_t>( &item->threadCtx.thread );
+                refThread = 0;
+#ifdef TRACY_HAS_CRASH_DUMP
+                if( m_crashDumpActive ) CollectCrashDumpQuery( ServerQueryThreadString, m_threadCtx );
+#endif
+            }
+            if( !AppendData( item, QueueDataSize[idx] ) )
+            {
+                m_refTimeThread = refThread;
+                return DequeueStatus::ConnectionLost;
+            }
             item++;
         }
-        m_refTimeSerial = refSerial;
-        m_refTimeGpu = refGpu;
-        m_serialDequeue.clear();
+        m_refTimeSerial = refSerial;
+        m_refTimeGpu = refGpu;
+        m_refTimeThread = refThread;
+        m_serialDequeue.clear();
+    }
+    else
+    {
+        return DequeueStatus::QueueEmpty;
+    }
+    return DequeueStatus::DataDequeued;
+}
+
+bool Profiler::CommitData()
+{
+    const auto len = uint32_t( m_bufferOffset - m_bufferStart );
+#ifdef TRACY_HAS_CRASH_DUMP
+    if( m_crashDumpActive )
+    {
+        m_bufferOffset = m_bufferStart;
+        return WriteCrashDumpRecord( m_buffer + m_bufferStart, len );
+    }
+#endif
+
+#ifdef TRACY_PROFILER_STATS
+    const auto commitStart = GetStatTime();
+#endif
+    const auto head = m_sendHead.load( std::memory_order_relaxed );
+    auto& frame = m_sendFrames[head % SendRingSize];
+    frame.pos = m_sendPos;
+    frame.offset = m_bufferStart;
+    frame.size = len;
+    m_sendHead.store( head + 1, std::memory_order_release );
+
+    m_sendPos += len;
+    if( m_bufferOffset > SendBufferSize - TargetFrameSize )
+    {
+        m_sendPos += SendBufferSize - m_bufferOffset;
+        m_bufferOffset = 0;
+    }
+    m_bufferStart = m_bufferOffset;
+
+    // Wait until the next frame can be built without overwriting data still needed by the send thread.
+    auto tail = m_sendTail.load( std::memory_order_acquire );
+    const auto mustWait = [this, head, &tail] {
+        if( tail == head + 1 ) return false;
+        return head + 1 - tail >= SendRingSize || m_sendPos + TargetFrameSize * 3 > m_sendFrames[tail % SendRingSize].pos + SendBufferSize;
+    };
+    while( mustWait() )
+    {
+        std::this_thread::yield();
+        tail = m_sendTail.load( std::memory_order_acquire );
+    }
+#ifdef TRACY_PROFILER_STATS
+    m_statCommitTime += GetStatTime() - commitStart;
+#endif
+
+    return !m_sendFailed.load( std::memory_order_relaxed );
+}
+
+// Waits until all committed frames are sent. Must be called before the socket is closed.
+bool Profiler::FlushSendRing()
+{
+    const auto head = m_sendHead.load( std::memory_order_relaxed );
+    while( m_sendTail.load( std::memory_order_acquire ) != head ) std::this_thread::yield();
+    return !m_sendFailed.load( std::memory_order_relaxed );
+}
+
+void Profiler::SendWorker()
+{
+#ifdef __linux__
+    s_sendTid = syscall( SYS_gettid );
+#endif
+
+    SetThreadName( "Tracy Send" );
+
+    auto tail = m_sendTail.load( std::memory_order_relaxed );
+    int idle = 0;
+#ifdef TRACY_ZSTD
+    int64_t zstdCompressTime = 0;
+    int64_t zstdSocketTime = 0;
+    int zstdFrames = 0;
+    int zstdBacklog = 0;
+#endif
+    for(;;)
+    {
+        if( tail == m_sendHead.load( std::memory_order_acquire ) )
+        {
+            if( m_sendExit.load( std::memory_order_relaxed ) ) return;
+            // Frames are committed in bursts. Yield briefly to catch the next one, then back off,
+            // so that an idle connection doesn't keep a core busy.
+            if( idle < SendIdleYields )
+            {
+                idle++;
+                std::this_thread::yield();
+            }
+            else
+            {
+                std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+            }
+            continue;
+        }
+        idle = 0;
+
+        // Frames of a lost connection are dropped, the stream is reset with the next connection.
+        if( !m_sendFailed.load( std::memory_order_relaxed ) )
+        {
+            const auto& frame = m_sendFrames[tail % SendRingSize];
+#if defined TRACY_PROFILER_STATS || defined TRACY_ZSTD
+            const auto t0 = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+#endif
+            lz4sz_t lz4sz;
+#ifdef TRACY_ZSTD
+            if( m_netCodec == NetworkCodecZstd )
+            {
+                lz4sz = CompressZstd( m_buffer + frame.offset, frame.size, m_zstdLevelNext );
+            }
+            else
+#endif
+            {
+                lz4sz = LZ4_compress_fast_continue( (LZ4_stream_t*)m_stream, m_buffer + frame.offset, m_lz4Buf + sizeof( lz4sz_t ), (int)frame.size, LZ4Size, 1 );
+            }
+            memcpy( m_lz4Buf, &lz4sz, sizeof( lz4sz ) );
+#if defined TRACY_PROFILER_STATS || defined TRACY_ZSTD
+            const auto t1 = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+#endif
+            if( lz4sz == 0 || m_sock->Send( m_lz4Buf, lz4sz + sizeof( lz4sz_t ) ) == -1 )
+            {
+                m_sendFailed.store( true, std::memory_order_relaxed );
+            }
+#ifdef TRACY_PROFILER_STATS
+            else
+            {
+                m_sendBytes.fetch_add( lz4sz + sizeof( lz4sz_t ), std::memory_order_relaxed );
+            }
+#endif
+#if defined TRACY_PROFILER_STATS || defined TRACY_ZSTD
+            const auto t2 = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+#endif
+#ifdef TRACY_PROFILER_STATS
+            m_sendCompressTime.fetch_add( t1 - t0, std::memory_order_relaxed );
+            m_sendSocketTime.fetch_add( t2 - t1, std::memory_order_relaxed );
+#endif
+
+#ifdef TRACY_ZSTD
+            if( m_netCodec == NetworkCodecZstd )
+            {
+                zstdCompressTime += t1 - t0;
+                zstdSocketTime += t2 - t1;
+                if( m_sendHead.load( std::memory_order_relaxed ) - tail > 1 ) zstdBacklog++;
+                if( ++zstdFrames == ZstdLevelWindow )
+                {
+                    // While frames are queuing up, trade compression time for bytes on the link,
+                    // or the other way around. With an idle queue, don't compress harder than
+                    // the link needs.
+                    const auto level = m_zstdLevel.load( std::memory_order_relaxed );
+                    if( zstdBacklog * 2 >= zstdFrames && zstdSocketTime > zstdCompressTime )
+                    {
+                        m_zstdLevelNext = std::min<int>( level + 1, ZstdLevelMax );
+                    }
+                    else if( zstdCompressTime > zstdSocketTime )
+                    {
+                        m_zstdLevelNext = std::max<int>( level - 1, ZstdLevelMin );
+                    }
+                    zstdCompressTime = 0;
+                    zstdSocketTime = 0;
+                    zstdFrames = 0;
+                    zstdBacklog = 0;
+                }
+            }
+#endif
+        }
+        m_sendTail.store( ++tail, std::memory_order_release );
     }
-    else
+}
+
+#ifdef TRACY_ZSTD
+// Returns 0 on failure.
+lz4sz_t Profiler::CompressZstd( const char* src, uint32_t size, int level )
+{
+    auto ctx = (ZSTD_CCtx*)m_zstdStream;
+    ZSTD_outBuffer out = { m_lz4Buf + sizeof( lz4sz_t ), NetFrameMaxSize, 0 };
+    if( level != m_zstdLevel.load( std::memory_order_relaxed ) )
     {
-        return DequeueStatus::QueueEmpty;
+        // The level can't be changed within a zstd frame. Ending the frame also drops the
+        // window, so levels are changed at most once in ZstdLevelWindow network frames.
+        ZSTD_inBuffer end = { nullptr, 0, 0 };
+        if( ZSTD_compressStream2( ctx, &out, &end, ZSTD_e_end ) != 0 ) return 0;
+        ZSTD_CCtx_setParameter( ctx, ZSTD_c_compressionLevel, level );
+        m_zstdLevel.store( level, std::memory_order_relaxed );
     }
-    return DequeueStatus::DataDequeued;
+    // Flushing makes the network frame decodable on its own, given the preceding ones.
+    ZSTD_inBuffer in = { src, size, 0 };
+    if( ZSTD_compressStream2( ctx, &out, &in, ZSTD_e_flush ) != 0 ) return 0;
+    return lz4sz_t( out.pos );
 }
+#endif
 
-bool Profiler::CommitData()
+#ifdef TRACY_HAS_CRASH_DUMP
+static bool WriteCrashDumpRaw( int fd, const void* data, size_t len )
 {
-    bool ret = SendData( m_buffer + m_bufferStart, m_bufferOffset - m_bufferStart );
-    if( m_bufferOffset > TargetFrameSize * 2 ) m_bufferOffset = 0;
-    m_bufferStart = m_bufferOffset;
-    return ret;
+    auto ptr = (const char*)data;
+    while( len > 0 )
+    {
+        const auto ret = write( fd, ptr, len );
+        if( ret < 0 )
+        {
+            if( errno == EINTR ) continue;
+            return false;
+        }
+        ptr += ret;
+        len -= size_t( ret );
+    }
+    return true;
+}
+
+bool Profiler::WriteCrashDumpRecord( const char* data, size_t len )
+{
+    MemWrite( &m_crashDumpRecord.size, uint32_t( len ) );
+    if( !WriteCrashDumpRaw( m_crashDumpFd, &m_crashDumpRecord, sizeof( m_crashDumpRecord ) ) ) return false;
+    return WriteCrashDumpRaw( m_crashDumpFd, data, len );
+}
+
+// Records everything the server would ask about the item, so that the answers can be stored
+// in the dump. Must be called before the item is prepared for sending.
+void Profiler::CollectCrashDumpQueries( const QueueItem* item )
+{
+    uint64_t ptr;
+    switch( (QueueType)MemRead<uint8_t>( &item->hdr.idx ) )
+    {
+    case QueueType::CrashReport:
+        CollectCrashDumpQuery( ServerQueryString, MemRead<uint64_t>( &item->crashReport.text ) );
+        return;
+    case QueueType::MessageLiteral:
+    case QueueType::MessageLiteralColor:
+    case QueueType::MessageLiteralCallstack:
+    case QueueType::MessageLiteralColorCallstack:
+        CollectCrashDumpQuery( ServerQueryString, MemRead<uint64_t>( &item->message.text ) );
+        return;
+    case QueueType::FrameMarkMsg:
+    case QueueType::FrameMarkMsgStart:
+    case QueueType::FrameMarkMsgEnd:
+        ptr = MemRead<uint64_t>( &item->frameMark.name );
+        if( ptr != 0 ) CollectCrashDumpQuery( ServerQueryFrameName, ptr );
+        return;
+    case QueueType::PlotData:
+        CollectCrashDumpQuery( ServerQueryPlotName, MemRead<uint64_t>( &item->plotData.name ) );
+        return;
+    case QueueType::Histogram:
+        CollectCrashDumpQuery( ServerQueryString, MemRead<uint64_t>( &item->histogram.name ) );
+        return;
+    case QueueType::LockAnnounce:
+    case QueueType::WaitAnnounce:
+    {
+        ptr = (QueueType)MemRead<uint8_t>( &item->hdr.idx ) == QueueType::LockAnnounce ? MemRead<uint64_t>( &item->lockAnnounce.lckloc ) : MemRead<uint64_t>( &item->waitAnnounce.srcloc );
+        auto srcloc = (const SourceLocationData*)ptr;
+        CollectCrashDumpQuery( ServerQuerySourceLocation, ptr );
+        if( srcloc->name ) CollectCrashDumpQuery( ServerQueryString, uint64_t( srcloc->name ) );
+        CollectCrashDumpQuery( ServerQueryString, uint64_t( srcloc->function ) );
+        CollectCrashDumpQuery( ServerQueryString, uint64_t( srcloc->file ) );
+        return;
+    }
+    default:
+        return;
+    }
+}
+
+// Call stack frames are not decoded in the crashed process, the dump reader shows their addresses.
+void Profiler::CollectCrashDumpQuery( ServerQuery type, uint64_t ptr )
+{
+    if( ptr == 0 || m_crashDumpQueryCount >= CrashDumpQueryCapacity / 4 * 3 ) return;
+    auto idx = uint32_t( ( ( ptr ^ type ) * 0x9E3779B97F4A7C15ull ) >> 32 ) & ( CrashDumpQueryCapacity - 1 );
+    for(;;)
+    {
+        auto& slot = m_crashDumpQueries[idx];
+        const auto slotPtr = MemRead<uint64_t>( &slot.ptr );
+        if( slotPtr == 0 ) break;
+        if( slotPtr == ptr && MemRead<uint8_t>( &slot.type ) == type ) return;
+        idx = ( idx + 1 ) & ( CrashDumpQueryCapacity - 1 );
+    }
+    auto& slot = m_crashDumpQueries[idx];
+    MemWrite( &slot.type, uint8_t( type ) );
+    MemWrite( &slot.ptr, ptr );
+    m_crashDumpQueryCount++;
 }
 
-bool Profiler::SendData( const char* data, size_t len )
+// Called on the profiler thread, when a crashed program is about to exit without ever being
+// connected to a server. All queued events are written to the crash dump file, instead of
+// being sent over the network, together with the answers to the server queries they will
+// trigger. Only the answers which are plain memory reads are written, into the query table
+// allocated at startup, and no debug information is loaded. The dump can be converted to a
+// trace with the update utility.
+void Profiler::WriteCrashDump( moodycamel::ConsumerToken& token, const WelcomeMessage& welcome )
 {
-    const lz4sz_t lz4sz = LZ4_compress_fast_continue( (LZ4_stream_t*)m_stream, data, m_lz4Buf + sizeof( lz4sz_t ), (int)len, LZ4Size, 1 );
-    memcpy( m_lz4Buf, &lz4sz, sizeof( lz4sz ) );
-    return m_sock->Send( m_lz4Buf, lz4sz + sizeof( lz4sz_t ) ) != -1;
+    m_crashDumpFd = open( m_crashDumpPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+    if( m_crashDumpFd < 0 ) return;
+
+    const uint32_t protocolVersion = ProtocolVersion;
+    bool ok = WriteCrashDumpRaw( m_crashDumpFd, CrashDumpMagic, CrashDumpMagicSize ) &&
+        WriteCrashDumpRaw( m_crashDumpFd, &protocolVersion, sizeof( protocolVersion ) ) &&
+        WriteCrashDumpRaw( m_crashDumpFd, &welcome, sizeof( welcome ) );
+
+    m_crashDumpActive = true;
+    memset( &m_crashDumpRecord, 0, sizeof( m_crashDumpRecord ) );
+    MemWrite( &m_crashDumpRecord.type, CrashDumpData );
+    m_sentSourceLocation.Clear();
+
+    if( ok )
+    {
+        for(;;)
+        {
+            const auto status = Dequeue( token );
+            const auto serialStatus = DequeueSerial();
+            if( status == DequeueStatus::ConnectionLost || serialStatus == DequeueStatus::ConnectionLost )
+            {
+                ok = false;
+                break;
+            }
+            else if( status == DequeueStatus::QueueEmpty && serialStatus == DequeueStatus::QueueEmpty )
+            {
+                ok = FlushRetention( true );
+                if( ok && m_bufferOffset != m_bufferStart ) ok = CommitData();
+                break;
+            }
+        }
+    }
+
+    // Queries are unique, as the table is a hash set.
+    for( uint32_t i=0; i<CrashDumpQueryCapacity && ok; i++ )
+    {
+        const auto& query = m_crashDumpQueries[i];
+        const auto ptr = MemRead<uint64_t>( &query.ptr );
+        if( ptr == 0 ) continue;
+        MemWrite( &m_crashDumpRecord.type, CrashDumpAnswer );
+        memcpy( &m_crashDumpRecord.query, &query, sizeof( query ) );
+        ProcessServerQuery( MemRead<uint8_t>( &query.type ), ptr, 0 );
+        if( m_bufferOffset != m_bufferStart ) ok = CommitData();
+    }
+
+    m_crashDumpActive = false;
+    close( m_crashDumpFd );
+    m_crashDumpFd = -1;
 }
+#endif
 
 void Profiler::SendString( uint64_t str, const char* ptr, QueueType type )
 {
@@ -2193,7 +3690,8 @@ void Profiler::SendString( uint64_t str, const char* ptr, QueueType type )
 void Profiler::SendLongString( uint64_t str, const char* ptr, size_t len, QueueType type )
 {
     assert( type == QueueType::FrameImageData ||
-            type == QueueType::SymbolCode );
+            type == QueueType::SymbolCode ||
+            type == QueueType::HistogramData );
 
     QueueItem item;
     MemWrite( &item.hdr.type, type );
@@ -2225,24 +3723,71 @@ void Profiler::SendSourceLocation( uint64_t ptr )
     AppendData( &item, QueueDataSize[(int)QueueType::SourceLocation] );
 }
 
-void Profiler::SendSourceLocationPayload( uint64_t _ptr )
+void Profiler::SendStaticSourceLocation( uint64_t ptr )
 {
-    auto ptr = (const char*)_ptr;
+    auto srcloc = (const SourceLocationData*)ptr;
+    QueueSourceLocation data;
+    MemWrite( &data.name, (uint64_t)srcloc->name );
+    MemWrite( &data.file, (uint64_t)srcloc->file );
+    MemWrite( &data.function, (uint64_t)srcloc->function );
+    MemWrite( &data.line, srcloc->line );
+    MemWrite( &data.r, uint8_t( ( srcloc->color       ) & 0xFF ) );
+    MemWrite( &data.g, uint8_t( ( srcloc->color >> 8  ) & 0xFF ) );
+    MemWrite( &data.b, uint8_t( ( srcloc->color >> 16 ) & 0xFF ) );
+
+    const auto fsz = strlen( srcloc->function ) + 1;
+    const auto ssz = strlen( srcloc->file ) + 1;
+    const auto nsz = srcloc->name ? strlen( srcloc->name ) : 0;
+    const auto len = sizeof( data ) + fsz + ssz + nsz;
+    // Source location which doesn't fit will be retrieved by the server query.
+    if( len > std::numeric_limits<uint16_t>::max() ) return;
+    const auto l16 = uint16_t( len );
 
     QueueItem item;
-    MemWrite( &item.hdr.type, QueueType::SourceLocationPayload );
-    MemWrite( &item.stringTransfer.ptr, _ptr );
+    MemWrite( &item.hdr.type, QueueType::StaticSourceLocationPayload );
+    MemWrite( &item.stringTransfer.ptr, ptr );
 
-    const auto len = *((uint32_t*)ptr);
+    NeedDataSize( QueueDataSize[(int)QueueType::StaticSourceLocationPayload] + sizeof( l16 ) + l16 );
+
+    AppendDataUnsafe( &item, QueueDataSize[(int)QueueType::StaticSourceLocationPayload] );
+    AppendDataUnsafe( &l16, sizeof( l16 ) );
+    AppendDataUnsafe( &data, sizeof( data ) );
+    AppendDataUnsafe( srcloc->function, fsz );
+    AppendDataUnsafe( srcloc->file, ssz );
+    if( nsz != 0 ) AppendDataUnsafe( srcloc->name, nsz );
+}
+
+void Profiler::SendSourceLocationPayload( uint64_t ptr, const char* data, QueueType type )
+{
+    assert( type == QueueType::SourceLocationPayload || type == QueueType::InternedSourceLocationPayload );
+
+    QueueItem item;
+    MemWrite( &item.hdr.type, type );
+    MemWrite( &item.stringTransfer.ptr, ptr );
+
+    const auto len = *((uint32_t*)data);
     assert( len <= std::numeric_limits<uint16_t>::max() );
     assert( len > 4 );
     const auto l16 = uint16_t( len - 4 );
 
-    NeedDataSize( QueueDataSize[(int)QueueType::SourceLocationPayload] + sizeof( l16 ) + l16 );
+    NeedDataSize( QueueDataSize[(int)type] + sizeof( l16 ) + l16 );
 
-    AppendDataUnsafe( &item, QueueDataSize[(int)QueueType::SourceLocationPayload] );
+    AppendDataUnsafe( &item, QueueDataSize[(int)type] );
     AppendDataUnsafe( &l16, sizeof( l16 ) );
-    AppendDataUnsafe( ptr + 4, l16 );
+    AppendDataUnsafe( data + 4, l16 );
+}
+
+void Profiler::SendInternedSourceLocation( uint64_t ptr )
+{
+    auto entry = (InternedSourceLocation*)( ptr & ~uint64_t( 1 ) );
+#ifdef TRACY_ON_DEMAND
+    const auto connection = m_connectionId.load( std::memory_order_relaxed ) + 1;
+#else
+    const uint64_t connection = 1;
+#endif
+    if( entry->connection == connection ) return;
+    entry->connection = connection;
+    SendSourceLocationPayload( ptr, (const char*)( entry + 1 ), QueueType::InternedSourceLocationPayload );
 }
 
 void Profiler::SendCallstackPayload( uint64_t _ptr )
@@ -2314,10 +3859,37 @@ void Profiler::SendCallstackAlloc( uint64_t _ptr )
     AppendDataUnsafe( ptr + 4, l16 );
 }
 
+#ifdef TRACY_HAS_MODULE_BUILD_ID
+void Profiler::SendModuleInfo()
+{
+    if( !ModuleListChanged( m_moduleGeneration ) ) return;
+
+    FastVector<ModuleData> modules( 64 );
+    GetModuleList( modules );
+    for( auto& module : modules )
+    {
+        QueueItem item;
+        MemWrite( &item.hdr.type, QueueType::ModuleInfo );
+        MemWrite( &item.moduleInfo.base, module.base );
+        MemWrite( &item.moduleInfo.size, module.size );
+        MemWrite( &item.moduleInfo.buildId, module.buildId );
+
+        AppendData( &item, QueueDataSize[(int)QueueType::ModuleInfo] );
+    }
+}
+#endif
+
 void Profiler::SendCallstackFrame( uint64_t ptr )
 {
 #ifdef TRACY_HAS_CALLSTACK
+    WaitForCallstackInit();
+#ifdef TRACY_PROFILER_STATS
+    const auto t0 = GetStatTime();
+#endif
     const auto frameData = DecodeCallstackPtr( ptr );
+#ifdef TRACY_PROFILER_STATS
+    m_statSymbolTime += GetStatTime() - t0;
+#endif
 
     {
         SendString( uint64_t( frameData.imageName ), frameData.imageName, QueueType::CustomStringData );
@@ -2374,6 +3946,11 @@ bool Profiler::HandleServerQuery()
     memcpy( &ptr, &payload.ptr, sizeof( payload.ptr ) );
     memcpy( &extra, &payload.extra, sizeof( payload.extra ) );
 
+    return ProcessServerQuery( type, ptr, extra );
+}
+
+bool Profiler::ProcessServerQuery( uint8_t type, uint64_t ptr, uint32_t extra )
+{
     switch( type )
     {
     case ServerQueryString:
@@ -2398,6 +3975,9 @@ bool Profiler::HandleServerQuery()
     case ServerQueryTerminate:
         return false;
     case ServerQueryCallstackFrame:
+#ifdef TRACY_HAS_MODULE_BUILD_ID
+        SendModuleInfo();
+#endif
         SendCallstackFrame( ptr );
         break;
     case ServerQueryFrameName:
@@ -2415,6 +3995,9 @@ bool Profiler::HandleServerQuery()
         HandleParameter( ptr );
         break;
     case ServerQuerySymbol:
+#ifdef TRACY_HAS_MODULE_BUILD_ID
+        SendModuleInfo();
+#endif
         HandleSymbolQuery( ptr );
         break;
     case ServerQuerySymbolCode:
@@ -2487,7 +4070,8 @@ void Profiler::HandleDisconnect()
 
     QueueItem terminate;
     MemWrite( &terminate.hdr.type, QueueType::Terminate );
-    if( !SendData( (const char*)&terminate, 1 ) ) return;
+    AppendData( &terminate, 1 );
+    if( !CommitData() ) return;
     for(;;)
     {
         ClearQueues( token );
@@ -2519,11 +4103,24 @@ void Profiler::CalibrateTimer()
 #  if !defined TARGET_OS_IOS && __ARM_ARCH >= 6
     m_timerMul = 1.;
 #  else
+#    if ( defined __i386 || defined _M_IX86 || defined __x86_64__ || defined _M_X64 ) && !defined TRACY_TIMER_QPC
+    const auto tscFreq = GetTscFrequency();
+    if( tscFreq != 0 )
+    {
+        m_timerMul = 1000000000. / double( tscFreq );
+        return;
+    }
+#    endif
+
     std::atomic_signal_fence( std::memory_order_acq_rel );
     const auto t0 = std::chrono::high_resolution_clock::now();
     const auto r0 = GetTime();
     std::atomic_signal_fence( std::memory_order_acq_rel );
-    std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+    // A short-lived program must not wait for calibration on exit, the precision is lower then.
+    for( int i=0; i<20 && !m_shutdown.load( std::memory_order_relaxed ); i++ )
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    }
     std::atomic_signal_fence( std::memory_order_acq_rel );
     const auto t1 = std::chrono::high_resolution_clock::now();
     const auto r1 = GetTime();
@@ -2546,6 +4143,7 @@ void Profiler::CalibrateDelay()
     auto mindiff = std::numeric_limits<int64_t>::max();
     for( int i=0; i<Iterations * 10; i++ )
     {
+        if( ( i & 0xFFFF ) == 0 && i != 0 && m_shutdown.load( std::memory_order_relaxed ) ) break;
         const auto t0i = GetTime();
         const auto t1i = GetTime();
         const auto dti = t1i - t0i;
@@ -2553,42 +4151,36 @@ void Profiler::CalibrateDelay()
     }
     m_resolution = mindiff;
 
-#ifdef TRACY_DELAYED_INIT
-    m_delay = m_resolution;
-#else
+    // The application is already running, events are written to a private queue, so that they
+    // don't mix with the events of its threads.
     enum { Events = Iterations * 2 };   // start + end
-    static_assert( Events < QueuePrealloc, "Delay calibration loop will allocate memory in queue" );
+    moodycamel::ConcurrentQueue<QueueItem> queue( Events );
+    moodycamel::ProducerToken producerToken( queue );
+    auto producer = queue.get_explicit_producer( producerToken );
+    auto& tail = producer->get_tail_index();
 
     static const tracy::SourceLocationData __tracy_source_location { nullptr, __FUNCTION__,  __FILE__, (uint32_t)__LINE__, 0 };
     const auto t0 = GetTime();
     for( int i=0; i<Iterations; i++ )
     {
+        moodycamel::ConcurrentQueueDefaultTraits::index_t magic;
         {
-            TracyLfqPrepare( QueueType::ZoneBegin );
+            auto item = producer->enqueue_begin( magic );
+            MemWrite( &item->hdr.type, QueueType::ZoneBegin );
             MemWrite( &item->zoneBegin.time, Profiler::GetTime() );
             MemWrite( &item->zoneBegin.srcloc, (uint64_t)&__tracy_source_location );
-            TracyLfqCommit;
+            tail.store( magic + 1, std::memory_order_release );
         }
         {
-            TracyLfqPrepare( QueueType::ZoneEnd );
+            auto item = producer->enqueue_begin( magic );
+            MemWrite( &item->hdr.type, QueueType::ZoneEnd );
             MemWrite( &item->zoneEnd.time, GetTime() );
-            TracyLfqCommit;
+            tail.store( magic + 1, std::memory_order_release );
         }
     }
     const auto t1 = GetTime();
     const auto dt = t1 - t0;
     m_delay = dt / Events;
-
-    moodycamel::ConsumerToken token( GetQueue() );
-    int left = Events;
-    while( left != 0 )
-    {
-        const auto sz = GetQueue().try_dequeue_bulk_single( token, [](const uint64_t&){}, [](QueueItem* item, size_t sz){} );
-        assert( sz > 0 );
-        left -= (int)sz;
-    }
-    assert( GetQueue().size_approx() == 0 );
-#endif
 }
 
 void Profiler::ReportTopology()
@@ -2738,9 +4330,44 @@ void Profiler::SendCallstack( int depth, const char* skipBefore )
 #endif
 }
 
+#ifdef TRACY_MEMORY_SAMPLING
+static_assert( TRACY_MEMORY_SAMPLING > 0, "Memory sampling interval must be positive" );
+
+// Allocations are sampled as a Poisson process over allocated bytes, with the mean distance
+// between samples equal to the sampling interval. An allocation of size s is thus recorded
+// with probability 1 - exp( -s / interval ), which is what the server uses to scale it back.
+static tracy_force_inline int64_t NextMemSampleDistance( uint64_t& rng )
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    const auto u = ( ( rng >> 11 ) + 1 ) * ( 1.0 / 9007199254740992.0 );   // (0, 1]
+    return int64_t( -log( u ) * TRACY_MEMORY_SAMPLING ) + 1;
+}
+
+bool Profiler::SampleMemAlloc( const void* ptr, size_t size )
+{
+    thread_local uint64_t rng = 0;
+    thread_local int64_t left = 0;
+
+    if( ptr == nullptr ) return false;
+    if( rng == 0 )
+    {
+        rng = ( GetThreadHandle() * 0x9E3779B97F4A7C15ull ) ^ uint64_t( GetTime() );
+        if( rng == 0 ) rng = 1;
+        left = NextMemSampleDistance( rng );
+    }
+    left -= int64_t( size );
+    if( left > 0 ) return false;
+    left = NextMemSampleDistance( rng );
+    return true;
+}
+#endif
+
 void Profiler::CutCallstack( void* callstack, const char* skipBefore )
 {
 #ifdef TRACY_HAS_CALLSTACK
+    WaitForCallstackInit();
     auto data = (uintptr_t*)callstack;
     const auto sz = *data++;
     uintptr_t i;
@@ -2784,6 +4411,202 @@ void Profiler::ProcessSysTime()
 }
 #endif
 
+void Profiler::ProcessCounters()
+{
+    if( m_shutdown.load( std::memory_order_relaxed ) ) return;
+    const auto t = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    const auto elapsed = t - m_counterLast;
+    if( elapsed < int64_t( TRACY_COUNTER_INTERVAL ) * 1000000 ) return;
+    const auto first = m_counterLast == 0;
+    m_counterLast = t;
+    auto counters = s_counters.load( std::memory_order_acquire );
+    auto histograms = s_histograms.load( std::memory_order_acquire );
+    if( !counters && !histograms ) return;
+
+    const auto time = GetTime();
+    const auto blocks = s_counterBlocks.load( std::memory_order_acquire );
+    for( auto ptr = counters; ptr; ptr = ptr->next )
+    {
+        int64_t sum = 0;
+        for( auto block = blocks; block; block = block->next ) sum += block->value[ptr->id].load( std::memory_order_relaxed );
+        const auto delta = sum - ptr->last;
+        ptr->last = sum;
+        if( first ) continue;
+
+        TracyLfqPrepare( QueueType::PlotData );
+        MemWrite( &item->plotData.name, (uint64_t)ptr->name );
+        MemWrite( &item->plotData.time, time );
+        MemWrite( &item->plotData.type, PlotDataType::Double );
+        MemWrite( &item->plotData.data.d, double( delta ) * 1000000000. / elapsed );
+        TracyLfqCommit;
+    }
+
+    const auto hblocks = s_histogramBlocks.load( std::memory_order_acquire );
+    for( auto ptr = histograms; ptr; ptr = ptr->next )
+    {
+        uint64_t sum[HistogramBuckets] = {};
+        for( auto block = hblocks; block; block = block->next )
+        {
+            auto buckets = block->buckets[ptr->id].load( std::memory_order_acquire );
+            if( !buckets ) continue;
+            for( int i=0; i<HistogramBuckets; i++ ) sum[i] += buckets[i].load( std::memory_order_relaxed );
+        }
+        uint32_t cnt = 0;
+        for( int i=0; i<HistogramBuckets; i++ )
+        {
+            const auto delta = sum[i] - ptr->last[i];
+            ptr->last[i] = sum[i];
+            sum[i] = delta;
+            if( delta != 0 ) cnt++;
+        }
+        if( first || cnt == 0 ) continue;
+
+        // Only the non-empty buckets are sent, prefixed with their number.
+        auto data = (uint64_t*)tracy_malloc( sizeof( uint64_t ) * ( cnt + 1 ) );
+        auto dst = data;
+        *dst++ = cnt;
+        for( int i=0; i<HistogramBuckets; i++ )
+        {
+            if( sum[i] != 0 ) *dst++ = HistogramPackEntry( i, sum[i] );
+        }
+
+        TracyLfqPrepare( QueueType::Histogram );
+        MemWrite( &item->histogram.name, (uint64_t)ptr->name );
+        MemWrite( &item->histogram.time, time );
+        MemWrite( &item->histogram.period, uint32_t( std::min<int64_t>( elapsed, std::numeric_limits<uint32_t>::max() ) ) );
+        MemWrite( &item->histogram.data, (uint64_t)data );
+        TracyLfqCommit;
+    }
+}
+
+void Profiler::ProcessQueueMemory()
+{
+    auto& queue = GetQueue();
+    const auto backlog = queue.size_approx();
+    if( backlog > m_queuePeak ) m_queuePeak = backlog;
+
+    const auto t = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    if( t - m_queueMemoryLast < int64_t( QueueMemoryInterval ) * 1000000 ) return;
+    m_queueMemoryLast = t;
+
+    const auto trim = ++m_queueMemoryIntervals >= QueueTrimIntervals;
+    if( trim )
+    {
+        // Each producer needs a spare block to switch to, while the consumer empties the previous one.
+        if( queue.dynamic_block_count() > queue.producer_count() && queue.block_memory() > m_queuePeak * sizeof( QueueItem ) * 4 )
+        {
+            queue.release_spare_blocks();
+        }
+        m_queueMemoryIntervals = 0;
+        m_queuePeak = 0;
+    }
+
+    const auto serialCapacity = std::max<size_t>( SerialQueueCapacity, m_serialPeak * 2 );
+    if( trim )
+    {
+        m_serialDequeue.shrink( serialCapacity );
+        m_serialPeak = 0;
+    }
+    // The lock is contended by application threads, trimming can wait for the next interval.
+    if( !m_serialLock.try_lock() ) return;
+    if( trim ) m_serialQueue.shrink( serialCapacity );
+    m_serialMemory = m_serialQueue.capacity() * sizeof( QueueItem );
+    m_serialLock.unlock();
+}
+
+#ifdef TRACY_PROFILER_STATS
+void Profiler::ProcessProfilerStats()
+{
+    enum { NumStats = 10 };
+    static const char* names[NumStats] = {
+        "Tracy dequeue",
+        "Tracy serial dequeue",
+        "Tracy frame commit",
+        "Tracy symbol decoding",
+        "Tracy compression",
+        "Tracy socket send",
+        "Tracy queue depth",
+        "Tracy bytes sent / s",
+        "Tracy shed events",
+        "Tracy memory usage"
+    };
+    static const PlotFormatType formats[NumStats] = {
+        PlotFormatType::Percentage,
+        PlotFormatType::Percentage,
+        PlotFormatType::Percentage,
+        PlotFormatType::Percentage,
+        PlotFormatType::Percentage,
+        PlotFormatType::Percentage,
+        PlotFormatType::Number,
+        PlotFormatType::Memory,
+        PlotFormatType::Number,
+        PlotFormatType::Memory
+    };
+
+    const auto backlog = GetQueue().size_approx();
+    if( backlog > m_statQueuePeak ) m_statQueuePeak = backlog;
+
+    const auto t = GetStatTime();
+    const auto compress = m_sendCompressTime.load( std::memory_order_relaxed );
+    const auto socket = m_sendSocketTime.load( std::memory_order_relaxed );
+    const auto sent = m_sendBytes.load( std::memory_order_relaxed );
+    if( m_statLast == 0 )
+    {
+        for( int i=0; i<NumStats; i++ ) ConfigurePlot( names[i], formats[i] );
+    }
+    else
+    {
+        const auto elapsed = t - m_statLast;
+        if( elapsed < int64_t( ProfilerStatsInterval ) * 1000000 ) return;
+
+        const auto memory = GetQueue().block_memory() + m_serialMemory + m_serialDequeue.capacity() * sizeof( QueueItem ) + SendBufferSize + NetFrameMaxSize;
+        const double stats[NumStats] = {
+            double( m_statDequeueTime ) * 100. / elapsed,
+            double( m_statSerialTime ) * 100. / elapsed,
+            double( m_statCommitTime ) * 100. / elapsed,
+            double( m_statSymbolTime ) * 100. / elapsed,
+            double( compress - m_statCompressLast ) * 100. / elapsed,
+            double( socket - m_statSocketLast ) * 100. / elapsed,
+            double( m_statQueuePeak ),
+            double( sent - m_statSentLast ) * 1000000000. / elapsed,
+            double( m_statDropped ),
+            double( memory )
+        };
+        const auto time = GetTime();
+        for( int i=0; i<NumStats; i++ )
+        {
+            TracyLfqPrepare( QueueType::PlotData );
+            MemWrite( &item->plotData.name, (uint64_t)names[i] );
+            MemWrite( &item->plotData.time, time );
+            MemWrite( &item->plotData.type, PlotDataType::Double );
+            MemWrite( &item->plotData.data.d, stats[i] );
+            TracyLfqCommit;
+        }
+#ifdef TRACY_ZSTD
+        if( m_netCodec == NetworkCodecZstd )
+        {
+            TracyLfqPrepare( QueueType::PlotData );
+            MemWrite( &item->plotData.name, (uint64_t)"Tracy zstd level" );
+            MemWrite( &item->plotData.time, time );
+            MemWrite( &item->plotData.type, PlotDataType::Int );
+            MemWrite( &item->plotData.data.i, int64_t( m_zstdLevel.load( std::memory_order_relaxed ) ) );
+            TracyLfqCommit;
+        }
+#endif
+    }
+    m_statLast = t;
+    m_statDequeueTime = 0;
+    m_statSerialTime = 0;
+    m_statCommitTime = 0;
+    m_statSymbolTime = 0;
+    m_statCompressLast = compress;
+    m_statSocketLast = socket;
+    m_statSentLast = sent;
+    m_statQueuePeak = 0;
+    m_statDropped = 0;
+}
+#endif
+
 void Profiler::HandleParameter( uint64_t payload )
 {
     assert( m_paramCallback );
@@ -2797,7 +4620,14 @@ void Profiler::HandleParameter( uint64_t payload )
 void Profiler::HandleSymbolQuery( uint64_t symbol )
 {
 #ifdef TRACY_HAS_CALLSTACK
+    WaitForCallstackInit();
+#ifdef TRACY_PROFILER_STATS
+    const auto t0 = GetStatTime();
+#endif
     const auto sym = DecodeSymbolAddress( symbol );
+#ifdef TRACY_PROFILER_STATS
+    m_statSymbolTime += GetStatTime() - t0;
+#endif
 
     SendString( uint64_t( sym.file ), sym.file, QueueType::CustomStringData );
 
@@ -2821,7 +4651,14 @@ void Profiler::HandleSymbolCodeQuery( uint64_t symbol, uint32_t size )
 void Profiler::SendCodeLocation( uint64_t ptr )
 {
 #ifdef TRACY_HAS_CALLSTACK
+    WaitForCallstackInit();
+#ifdef TRACY_PROFILER_STATS
+    const auto t0 = GetStatTime();
+#endif
     const auto sym = DecodeCodeAddress( ptr );
+#ifdef TRACY_PROFILER_STATS
+    m_statSymbolTime += GetStatTime() - t0;
+#endif
 
     SendString( uint64_t( sym.file ), sym.file, QueueType::CustomStringData );
 
@@ -2846,6 +4683,54 @@ int64_t Profiler::GetTimeQpc()
 }
 #endif
 
+static void WriteBulkEvent( QueueItem* item, const ___tracy_bulk_event* ev )
+{
+    switch( ev->type )
+    {
+    case TracyCBulkZoneBegin:
+        MemWrite( &item->hdr.type, QueueType::ZoneBegin );
+        MemWrite( &item->zoneBegin.time, ev->time );
+        MemWrite( &item->zoneBegin.srcloc, (uint64_t)ev->srcloc );
+        break;
+    case TracyCBulkZoneEnd:
+        MemWrite( &item->hdr.type, QueueType::ZoneEnd );
+        MemWrite( &item->zoneEnd.time, ev->time );
+        break;
+    case TracyCBulkMessage:
+    {
+        auto ptr = (char*)tracy_malloc( ev->size+1 );
+        memcpy( ptr, ev->text, ev->size );
+        ptr[ev->size] = '\0';
+        if( ev->color == 0 )
+        {
+            MemWrite( &item->hdr.type, QueueType::Message );
+            MemWrite( &item->message.time, ev->time );
+            MemWrite( &item->message.text, (uint64_t)ptr );
+        }
+        else
+        {
+            MemWrite( &item->hdr.type, QueueType::MessageColor );
+            MemWrite( &item->messageColor.time, ev->time );
+            MemWrite( &item->messageColor.text, (uint64_t)ptr );
+            MemWrite( &item->messageColor.r, uint8_t( ( ev->color       ) & 0xFF ) );
+            MemWrite( &item->messageColor.g, uint8_t( ( ev->color >> 8  ) & 0xFF ) );
+            MemWrite( &item->messageColor.b, uint8_t( ( ev->color >> 16 ) & 0xFF ) );
+        }
+        break;
+    }
+    case TracyCBulkPlot:
+        MemWrite( &item->hdr.type, QueueType::PlotData );
+        MemWrite( &item->plotData.name, (uint64_t)ev->text );
+        MemWrite( &item->plotData.time, ev->time );
+        MemWrite( &item->plotData.type, PlotDataType::Double );
+        MemWrite( &item->plotData.data.d, ev->value );
+        break;
+    default:
+        assert( false );
+        break;
+    }
+}
+
 }
 
 #ifdef __cplusplus
@@ -2920,7 +4805,7 @@ TRACY_API TracyCZoneCtx ___tracy_emit_zone_begin_alloc( uint64_t srcloc, int act
 #endif
     if( !ctx.active )
     {
-        tracy::tracy_free( (void*)srcloc );
+        tracy::Profiler::FreeSourceLocation( srcloc );
         return ctx;
     }
     const auto id = tracy::GetProfiler().GetNextZoneId();
@@ -2952,7 +4837,7 @@ TRACY_API TracyCZoneCtx ___tracy_emit_zone_begin_alloc_callstack( uint64_t srclo
 #endif
     if( !ctx.active )
     {
-        tracy::tracy_free( (void*)srcloc );
+        tracy::Profiler::FreeSourceLocation( srcloc );
         return ctx;
     }
     const auto id = tracy::GetProfiler().GetNextZoneId();
@@ -3050,14 +4935,57 @@ TRACY_API void ___tracy_emit_zone_value( TracyCZoneCtx ctx, uint64_t value )
     }
 }
 
+TRACY_API void ___tracy_emit_zone_flow_out( TracyCZoneCtx ctx, uint64_t id )
+{
+    if( !ctx.active ) return;
+#ifndef TRACY_NO_VERIFY
+    {
+        TracyLfqPrepareC( tracy::QueueType::ZoneValidation );
+        tracy::MemWrite( &item->zoneValidation.id, ctx.id );
+        TracyLfqCommitC;
+    }
+#endif
+    {
+        TracyLfqPrepareC( tracy::QueueType::ZoneFlowOut );
+        tracy::MemWrite( &item->zoneFlow.time, tracy::Profiler::GetTime() );
+        tracy::MemWrite( &item->zoneFlow.id, id );
+        TracyLfqCommitC;
+    }
+}
+
+TRACY_API void ___tracy_emit_zone_flow_in( TracyCZoneCtx ctx, uint64_t id )
+{
+    if( !ctx.active ) return;
+#ifndef TRACY_NO_VERIFY
+    {
+        TracyLfqPrepareC( tracy::QueueType::ZoneValidation );
+        tracy::MemWrite( &item->zoneValidation.id, ctx.id );
+        TracyLfqCommitC;
+    }
+#endif
+    {
+        TracyLfqPrepareC( tracy::QueueType::ZoneFlowIn );
+        tracy::MemWrite( &item->zoneFlow.time, tracy::Profiler::GetTime() );
+        tracy::MemWrite( &item->zoneFlow.id, id );
+        TracyLfqCommitC;
+    }
+}
+
 TRACY_API void ___tracy_emit_memory_alloc( const void* ptr, size_t size ) { tracy::Profiler::MemAlloc( ptr, size ); }
 TRACY_API void ___tracy_emit_memory_alloc_callstack( const void* ptr, size_t size, int depth ) { tracy::Profiler::MemAllocCallstack( ptr, size, depth ); }
 TRACY_API void ___tracy_emit_memory_free( const void* ptr ) { tracy::Profiler::MemFree( ptr ); }
 TRACY_API void ___tracy_emit_memory_free_callstack( const void* ptr, int depth ) { tracy::Profiler::MemFreeCallstack( ptr, depth ); }
+TRACY_API void ___tracy_emit_memory_alloc_named( const void* ptr, size_t size, const char* name ) { tracy::Profiler::MemAlloc( ptr, size, name ); }
+TRACY_API void ___tracy_emit_memory_alloc_callstack_named( const void* ptr, size_t size, int depth, const char* name ) { tracy::Profiler::MemAllocCallstack( ptr, size, depth, name ); }
+TRACY_API void ___tracy_emit_memory_free_named( const void* ptr, const char* name ) { tracy::Profiler::MemFree( ptr, name ); }
+TRACY_API void ___tracy_emit_memory_free_callstack_named( const void* ptr, int depth, const char* name ) { tracy::Profiler::MemFreeCallstack( ptr, depth, name ); }
 TRACY_API void ___tracy_emit_frame_mark( const char* name ) { tracy::Profiler::SendFrameMark( name ); }
 TRACY_API void ___tracy_emit_frame_mark_start( const char* name ) { tracy::Profiler::SendFrameMark( name, tracy::QueueType::FrameMarkMsgStart ); }
 TRACY_API void ___tracy_emit_frame_mark_end( const char* name ) { tracy::Profiler::SendFrameMark( name, tracy::QueueType::FrameMarkMsgEnd ); }
 TRACY_API void ___tracy_emit_frame_image( const void* image, uint16_t w, uint16_t h, uint8_t offset, int flip ) { tracy::Profiler::SendFrameImage( image, w, h, offset, flip ); }
+TRACY_API void ___tracy_start_capture() { tracy::Profiler::StartCapture(); }
+TRACY_API void ___tracy_stop_capture() { tracy::Profiler::StopCapture(); }
+TRACY_API void ___tracy_set_frame_retention( const char* name, uint64_t threshold, uint32_t keepEvery ) { tracy::Profiler::SetFrameRetention( name, threshold, keepEvery ); }
 TRACY_API void ___tracy_emit_plot( const char* name, double val ) { tracy::Profiler::PlotData( name, val ); }
 TRACY_API void ___tracy_emit_message( const char* txt, size_t size, int callstack ) { tracy::Profiler::Message( txt, size, callstack ); }
 TRACY_API void ___tracy_emit_messageL( const char* txt, int callstack ) { tracy::Profiler::Message( txt, callstack ); }
@@ -3066,6 +4994,59 @@ TRACY_API void ___tracy_emit_messageLC( const char* txt, uint32_t color, int cal
 TRACY_API void ___tracy_emit_message_appinfo( const char* txt, size_t size ) { tracy::Profiler::MessageAppInfo( txt, size ); }
 TRACY_API uint64_t ___tracy_alloc_srcloc( uint32_t line, const char* source, const char* function ) { return tracy::Profiler::AllocSourceLocation( line, source, function ); }
 TRACY_API uint64_t ___tracy_alloc_srcloc_name( uint32_t line, const char* source, const char* function, const char* name, size_t nameSz ) { return tracy::Profiler::AllocSourceLocation( line, source, function, name, nameSz ); }
+TRACY_API int64_t ___tracy_get_time( void ) { return tracy::Profiler::GetTime(); }
+
+TRACY_API int ___tracy_emit_bulk( const struct ___tracy_bulk_event* events, size_t count, uint64_t thread )
+{
+    // Batches which would leave the zone stack of the thread unbalanced are rejected.
+    int64_t depth = 0;
+    const auto end = events + count;
+    for( auto ev = events; ev != end; ev++ )
+    {
+        if( ev->type == TracyCBulkZoneBegin )
+        {
+            depth++;
+        }
+        else if( ev->type == TracyCBulkZoneEnd )
+        {
+            if( --depth < 0 ) return 0;
+        }
+    }
+    if( depth != 0 ) return 0;
+
+#ifdef TRACY_ON_DEMAND
+    if( !tracy::GetProfiler().IsConnected() ) return 1;
+#endif
+    // Message payloads are copied with tracy_malloc.
+    tracy::InitRPMallocThread();
+    if( thread == 0 )
+    {
+        // All events are written to the queue first and are made visible to the profiler thread at once.
+        auto token = tracy::GetToken();
+        auto& tail = token->get_tail_index();
+        auto idx = tail.load( std::memory_order_relaxed );
+        for( auto ev = events; ev != end; ev++ )
+        {
+            if( ev->type > TracyCBulkPlot ) continue;
+            tracy::WriteBulkEvent( token->enqueue_begin_at( idx++ ), ev );
+        }
+        tail.store( idx, std::memory_order_release );
+    }
+    else
+    {
+        // Events of other threads go through the serial queue, after a switch of the thread context.
+        auto item = tracy::Profiler::QueueSerial();
+        tracy::MemWrite( &item->hdr.type, tracy::QueueType::ThreadContext );
+        tracy::MemWrite( &item->threadCtx.thread, thread );
+        for( auto ev = events; ev != end; ev++ )
+        {
+            if( ev->type > TracyCBulkPlot ) continue;
+            tracy::WriteBulkEvent( tracy::Profiler::QueueSerialNext(), ev );
+        }
+        tracy::Profiler::QueueSerialFinish();
+    }
+    return 1;
+}
 
 #ifdef __cplusplus
 }
@@ -10,6 +10,8 @@
 #include "TracyCallstack.hpp"
 #include "TracySysTime.hpp"
 #include "TracyFastVector.hpp"
+#include "TracyMemSampleSet.hpp"
+#include "TracyPointerSet.hpp"
 #include "../common/TracyQueue.hpp"
 #include "../common/TracyAlign.hpp"
 #include "../common/TracyAlloc.hpp"
@@ -32,6 +34,14 @@
   #include <chrono>
 #endif
 
+#if defined __linux__ && !defined TRACY_ON_DEMAND
+#  define TRACY_HAS_CRASH_DUMP
+#endif
+
+#if !defined _WIN32 && !defined __CYGWIN__
+#  define TRACY_HAS_FORK_HANDLER
+#endif
+
 #ifndef TracyConcat
 #  define TracyConcat(x,y) TracyConcatIndirect(x,y)
 #endif
@@ -44,6 +54,7 @@ namespace tracy
 
 class GpuCtx;
 class Profiler;
+class ListenSocket;
 class Socket;
 class UdpBroadcast;
 
@@ -162,6 +173,14 @@ public:
         return p.m_serialQueue.prepare_next();
     }
 
+    // Commits the current serial queue item and returns the next one, without releasing the lock.
+    static tracy_force_inline QueueItem* QueueSerialNext()
+    {
+        auto& p = GetProfiler();
+        p.m_serialQueue.commit_next();
+        return p.m_serialQueue.prepare_next();
+    }
+
     static tracy_force_inline void QueueSerialFinish()
     {
         auto& p = GetProfiler();
@@ -194,6 +213,21 @@ public:
         QueueSerialFinish();
     }
 
+    // Frames of the given set which are shorter than threshold (in nanoseconds) will have
+    // their zones discarded on the client side, except for each keepEvery-th frame. Frame
+    // marks are always sent. Set threshold to 0 to disable retention. Only one frame set can be
+    // retained at a time, each call replaces the previously selected set.
+    static tracy_force_inline void SetFrameRetention( const char* name, uint64_t threshold, uint32_t keepEvery )
+    {
+        auto& profiler = GetProfiler();
+        profiler.m_retentionSetName.store( uint64_t( name ), std::memory_order_relaxed );
+        profiler.m_retentionSetKeepEvery.store( keepEvery, std::memory_order_relaxed );
+        profiler.m_retentionSetThreshold.store( threshold, std::memory_order_release );
+    }
+
+    static void StartCapture();
+    static void StopCapture();
+
     static tracy_force_inline void SendFrameImage( const void* image, uint16_t w, uint16_t h, uint8_t offset, bool flip )
     {
         auto& profiler = GetProfiler();
@@ -201,6 +235,7 @@ public:
         if( !profiler.IsConnected() ) return;
 #endif
         const auto sz = size_t( w ) * size_t( h ) * 4;
+        InitRPMallocThread();
         auto ptr = (char*)tracy_malloc( sz );
         memcpy( ptr, image, sz );
 
@@ -348,69 +383,107 @@ public:
         TracyLfqCommit;
     }
 
-    static tracy_force_inline void MemAlloc( const void* ptr, size_t size )
+    static tracy_force_inline void MemAlloc( const void* ptr, size_t size, const char* name = nullptr )
     {
 #ifdef TRACY_ON_DEMAND
         if( !GetProfiler().IsConnected() ) return;
+#endif
+#ifdef TRACY_MEMORY_SAMPLING
+        if( !SampleMemAlloc( ptr, size ) ) return;
+        // Sample set may grow with tracy_malloc.
+        InitRPMallocThread();
 #endif
         const auto thread = GetThreadHandle();
 
         GetProfiler().m_serialLock.lock();
+#ifdef TRACY_MEMORY_SAMPLING
+        GetProfiler().m_memSampleSet.Insert( ptr, name );
+#endif
+        if( name ) SendMemName( name );
         SendMemAlloc( QueueType::MemAlloc, thread, ptr, size );
         GetProfiler().m_serialLock.unlock();
     }
 
-    static tracy_force_inline void MemFree( const void* ptr )
+    static tracy_force_inline void MemFree( const void* ptr, const char* name = nullptr )
     {
 #ifdef TRACY_ON_DEMAND
         if( !GetProfiler().IsConnected() ) return;
+#endif
+#ifdef TRACY_MEMORY_SAMPLING
+        if( !GetProfiler().m_memSampleSet.MayContain( ptr, name ) ) return;
 #endif
         const auto thread = GetThreadHandle();
 
         GetProfiler().m_serialLock.lock();
+#ifdef TRACY_MEMORY_SAMPLING
+        if( !GetProfiler().m_memSampleSet.Erase( ptr, name ) )
+        {
+            GetProfiler().m_serialLock.unlock();
+            return;
+        }
+#endif
+        if( name ) SendMemName( name );
         SendMemFree( QueueType::MemFree, thread, ptr );
         GetProfiler().m_serialLock.unlock();
     }
 
-    static tracy_force_inline void MemAllocCallstack( const void* ptr, size_t size, int depth )
+    static tracy_force_inline void MemAllocCallstack( const void* ptr, size_t size, int depth, const char* name = nullptr )
     {
 #ifdef TRACY_HAS_CALLSTACK
         auto& profiler = GetProfiler();
 #  ifdef TRACY_ON_DEMAND
         if( !profiler.IsConnected() ) return;
 #  endif
-        const auto thread = GetThreadHandle();
-
+#  ifdef TRACY_MEMORY_SAMPLING
+        if( !SampleMemAlloc( ptr, size ) ) return;
+#  endif
+        // Both the call stack and the sample set entry are allocated with tracy_malloc.
         InitRPMallocThread();
+        const auto thread = GetThreadHandle();
         auto callstack = Callstack( depth );
 
         profiler.m_serialLock.lock();
+#  ifdef TRACY_MEMORY_SAMPLING
+        profiler.m_memSampleSet.Insert( ptr, name );
+#  endif
+        if( name ) SendMemName( name );
         SendMemAlloc( QueueType::MemAllocCallstack, thread, ptr, size );
         SendCallstackMemory( callstack );
         profiler.m_serialLock.unlock();
 #else
-        MemAlloc( ptr, size );
+        MemAlloc( ptr, size, name );
 #endif
     }
 
-    static tracy_force_inline void MemFreeCallstack( const void* ptr, int depth )
+    static tracy_force_inline void MemFreeCallstack( const void* ptr, int depth, const char* name = nullptr )
     {
 #ifdef TRACY_HAS_CALLSTACK
         auto& profiler = GetProfiler();
 #  ifdef TRACY_ON_DEMAND
         if( !profiler.IsConnected() ) return;
 #  endif
-        const auto thread = GetThreadHandle();
-
+#  ifdef TRACY_MEMORY_SAMPLING
+        if( !profiler.m_memSampleSet.MayContain( ptr, name ) ) return;
+#  endif
         InitRPMallocThread();
+        const auto thread = GetThreadHandle();
         auto callstack = Callstack( depth );
 
         profiler.m_serialLock.lock();
+#  ifdef TRACY_MEMORY_SAMPLING
+        if( !profiler.m_memSampleSet.Erase( ptr, name ) )
+        {
+            profiler.m_serialLock.unlock();
+            tracy_free( callstack );
+            return;
+        }
+#  endif
+        if( name ) SendMemName( name );
         SendMemFree( QueueType::MemFreeCallstack, thread, ptr );
         SendCallstackMemory( callstack );
         profiler.m_serialLock.unlock();
 #else
-        MemFree( ptr );
+        MemFree( ptr, name );
 #endif
     }
 
@@ -456,6 +529,12 @@ public:
         return m_connectionId.load( std::memory_order_acquire );
     }
 
+    // Server is connected, but data collection is paused outside of capture window.
+    tracy_force_inline bool IsCaptureSuspended() const
+    {
+        return m_isCaptureSuspended.load( std::memory_order_acquire );
+    }
+
     tracy_force_inline void DeferItem( const QueueItem& item )
     {
         m_deferredLock.lock();
@@ -485,6 +564,8 @@ public:
     {
         const auto fsz = strlen( function );
         const auto ssz = strlen( source );
+        const auto interned = InternSourceLocation( line, source, ssz, function, fsz, nullptr, 0 );
+        if( interned != 0 ) return interned;
         const uint32_t sz = uint32_t( 4 + 4 + 4 + fsz + 1 + ssz + 1 );
         auto ptr = (char*)tracy_malloc( sz );
         memcpy( ptr, &sz, 4 );
@@ -499,6 +580,8 @@ public:
     {
         const auto fsz = strlen( function );
         const auto ssz = strlen( source );
+        const auto interned = InternSourceLocation( line, source, ssz, function, fsz, name, nameSz );
+        if( interned != 0 ) return interned;
         const uint32_t sz = uint32_t( 4 + 4 + 4 + fsz + 1 + ssz + 1 + nameSz );
         auto ptr = (char*)tracy_malloc( sz );
         memcpy( ptr, &sz, 4 );
@@ -510,6 +593,16 @@ public:
         return uint64_t( ptr );
     }
 
+    // Unique source locations are interned and sent to the server only once per connection.
+    // Interned source locations are tagged with the lowest bit set and are never freed.
+    // Returns 0 if the location could not be interned and must be allocated as a payload.
+    static uint64_t InternSourceLocation( uint32_t line, const char* source, size_t sourceSz, const char* function, size_t functionSz, const char* name, size_t nameSz );
+
+    static tracy_force_inline void FreeSourceLocation( uint64_t ptr )
+    {
+        if( ( ptr & 1 ) == 0 ) tracy_free( (void*)ptr );
+    }
+
 private:
     enum class DequeueStatus { DataDequeued, ConnectionLost, QueueEmpty };
 
@@ -519,12 +612,59 @@ private:
     static void LaunchCompressWorker( void* ptr ) { ((Profiler*)ptr)->CompressWorker(); }
     void CompressWorker();
 
+    static void LaunchSendWorker( void* ptr ) { ((Profiler*)ptr)->SendWorker(); }
+    void SendWorker();
+
+#ifdef TRACY_HAS_FORK_HANDLER
+    static void ForkPrepare();
+    static void ForkParent();
+    static void ForkChild();
+    void ReleaseParentState();
+    void ResetAfterFork();
+#endif
+
     void ClearQueues( tracy::moodycamel::ConsumerToken& token );
     void ClearSerial();
     DequeueStatus Dequeue( tracy::moodycamel::ConsumerToken& token );
     DequeueStatus DequeueContextSwitches( tracy::moodycamel::ConsumerToken& token, int64_t& timeStop );
     DequeueStatus DequeueSerial();
     bool CommitData();
+    bool FlushSendRing();
+#ifdef TRACY_ZSTD
+    lz4sz_t CompressZstd( const char* src, uint32_t size, int level );
+#endif
+
+    // Maximum number of items held per thread, after which the retained frame is sent.
+    enum { RetentionBufferLimit = 64 * 1024 };
+
+    struct RetentionBuffer
+    {
+        RetentionBuffer( uint64_t _thread ) : thread( _thread ), held( false ), items( 1024 ) {}
+
+        uint64_t thread;
+        bool held;
+        FastVector<QueueItem> items;
+    };
+
+    RetentionBuffer* GetRetentionBuffer( uint64_t thread );
+    tracy_force_inline bool RetainItem( const QueueItem* item );
+    bool UpdateRetention();
+    bool RetentionFrame( int64_t time );
+    bool FlushRetention( bool keep );
+    bool FlushRetentionInQueue( bool keep, int64_t& refThread );
+    tracy_force_inline uint8_t PrepareZoneItem( QueueItem* item, uint8_t idx, int64_t& refThread );
+    bool SendRetainedItem( QueueItem* item );
+    void ClearRetention();
+
+    tracy_force_inline void FreePayload( uint64_t ptr )
+    {
+#ifdef TRACY_HAS_CRASH_DUMP
+        // The crashed thread may be stopped inside the allocator. Payloads are leaked while the
+        // dump is written.
+        if( m_crashDumpActive ) return;
+#endif
+        tracy_free( (void*)ptr );
+    }
 
     tracy_force_inline bool AppendData( const void* data, size_t len )
     {
@@ -550,17 +690,43 @@ private:
         m_bufferOffset += int( len );
     }
 
-    bool SendData( const char* data, size_t len );
     void SendLongString( uint64_t ptr, const char* str, size_t len, QueueType type );
     void SendSourceLocation( uint64_t ptr );
-    void SendSourceLocationPayload( uint64_t ptr );
+    void SendStaticSourceLocation( uint64_t ptr );
+    void SendSourceLocationPayload( uint64_t ptr, const char* data, QueueType type );
+    void SendInternedSourceLocation( uint64_t ptr );
     void SendCallstackPayload( uint64_t ptr );
     void SendCallstackPayload64( uint64_t ptr );
     void SendCallstackAlloc( uint64_t ptr );
     void SendCallstackFrame( uint64_t ptr );
+#ifdef TRACY_HAS_MODULE_BUILD_ID
+    void SendModuleInfo();
+#endif
     void SendCodeLocation( uint64_t ptr );
 
+#ifdef TRACY_HAS_CRASH_DUMP
+    void WriteCrashDump( tracy::moodycamel::ConsumerToken& token, const WelcomeMessage& welcome );
+    bool WriteCrashDumpRecord( const char* data, size_t len );
+    void CollectCrashDumpQueries( const QueueItem* item );
+    void CollectCrashDumpQuery( ServerQuery type, uint64_t ptr );
+
+    // Queries which don't fit in the table are answered with placeholders.
+    enum { CrashDumpQueryCapacity = 32 * 1024 };
+#endif
+
+    tracy_force_inline void CheckStaticSourceLocation( uint64_t ptr )
+    {
+#ifdef TRACY_HAS_CRASH_DUMP
+        // Allocator can't be used while writing the crash dump. Locations which
+        // don't fit are pushed again, and the duplicates are ignored by the server.
+        if( m_sentSourceLocation.Insert( ptr, !m_crashDumpActive ) ) SendStaticSourceLocation( ptr );
+#else
+        if( m_sentSourceLocation.Insert( ptr ) ) SendStaticSourceLocation( ptr );
+#endif
+    }
+
     bool HandleServerQuery();
+    bool ProcessServerQuery( uint8_t type, uint64_t ptr, uint32_t extra );
     void HandleDisconnect();
     void HandleParameter( uint64_t payload );
     void HandleSymbolQuery( uint64_t symbol );
@@ -570,6 +736,10 @@ private:
     void CalibrateDelay();
     void ReportTopology();
 
+#ifdef TRACY_MEMORY_SAMPLING
+    static bool SampleMemAlloc( const void* ptr, size_t size );
+#endif
+
     static tracy_force_inline void SendCallstackMemory( void* ptr )
     {
 #ifdef TRACY_HAS_CALLSTACK
@@ -580,6 +750,15 @@ private:
 #endif
     }
 
+    static tracy_force_inline void SendMemName( const char* name )
+    {
+        assert( name );
+        auto item = GetProfiler().m_serialQueue.prepare_next();
+        MemWrite( &item->hdr.type, QueueType::MemNamePayload );
+        MemWrite( &item->memName.name, (uint64_t)name );
+        GetProfiler().m_serialQueue.commit_next();
+    }
+
     static tracy_force_inline void SendMemAlloc( QueueType type, const uint64_t thread, const void* ptr, size_t size )
     {
         assert( type == QueueType::MemAlloc || type == QueueType::MemAllocCallstack );
@@ -619,9 +798,11 @@ private:
     static int64_t GetTimeQpc();
 #endif
 
+    // Measured by the profiler thread before the first connection is accepted.
     double m_timerMul;
     uint64_t m_resolution;
     uint64_t m_delay;
+    bool m_calibrated;
     std::atomic<int64_t> m_timeBegin;
     uint64_t m_mainThread;
     uint64_t m_epoch;
@@ -629,7 +810,9 @@ private:
     std::atomic<bool> m_shutdownManual;
     std::atomic<bool> m_shutdownFinished;
     Socket* m_sock;
+    ListenSocket* m_listen;
     UdpBroadcast* m_broadcast;
+    uint64_t m_parentPid;
     bool m_noExit;
     uint32_t m_userPort;
     std::atomic<uint32_t> m_zoneId;
@@ -641,24 +824,101 @@ private:
     int64_t m_refTimeCtx;
     int64_t m_refTimeGpu;
 
+    // Static source locations already pushed to the server in this connection.
+    PointerSet m_sentSourceLocation;
+#ifdef TRACY_HAS_MODULE_BUILD_ID
+    uint64_t m_moduleGeneration;
+#endif
+
+    // Frames are compressed and sent by the send thread, so that draining of the queues doesn't
+    // wait for compression and socket writes. Frames are laid out in the buffer as before, but
+    // the data of queued frames, and the dictionary of the frame being compressed (at most two
+    // frames back, counting the space skipped at the buffer end), must not be overwritten.
+    enum { SendBufferSize = TargetFrameSize * 5 };
+    enum { SendRingSize = 64 };
+    enum { SendIdleYields = 8 };
+
+    struct SendFrame
+    {
+        uint64_t pos;       // position in the stream, including the skipped space
+        int offset;
+        uint32_t size;
+    };
+
     void* m_stream;     // LZ4_stream_t*
     char* m_buffer;
     int m_bufferOffset;
     int m_bufferStart;
+    uint64_t m_sendPos;
 
     char* m_lz4Buf;
-
+    uint8_t m_netCodec;
+#ifdef TRACY_ZSTD
+    // The zstd level is adapted by the send thread. It is raised while the socket is the
+    // bottleneck of the send queue, and lowered while compression is.
+    enum { ZstdLevelMin = -5 };
+    enum { ZstdLevelMax = 9 };
+    enum { ZstdLevelInit = 1 };
+    enum { ZstdLevelWindow = 16 };     // frames
+
+    void* m_zstdStream;     // ZSTD_CCtx*
+    std::atomic<int> m_zstdLevel;
+    int m_zstdLevelNext;
+#endif
+
+    SendFrame m_sendFrames[SendRingSize];
+    std::atomic<uint32_t> m_sendHead;
+    std::atomic<uint32_t> m_sendTail;
+    std::atomic<bool> m_sendFailed;
+    std::atomic<bool> m_sendExit;
+#ifdef TRACY_PROFILER_STATS
+    std::atomic<int64_t> m_sendCompressTime;
+    std::atomic<int64_t> m_sendSocketTime;
+    std::atomic<uint64_t> m_sendBytes;
+#endif
+
+    enum { SerialQueueCapacity = 1024*1024 };
     FastVector<QueueItem> m_serialQueue, m_serialDequeue;
     TracyMutex m_serialLock;
+#ifdef TRACY_MEMORY_SAMPLING
+    MemSampleSet m_memSampleSet;
+#endif
 
     FastVector<FrameImageQueueItem> m_fiQueue, m_fiDequeue;
     TracyMutex m_fiLock;
 
     std::atomic<uint64_t> m_frameCount;
+
+    std::atomic<uint64_t> m_retentionSetName;
+    std::atomic<uint64_t> m_retentionSetThreshold;
+    std::atomic<uint32_t> m_retentionSetKeepEvery;
+    bool m_retentionActive;
+    uint64_t m_retentionName;
+    int64_t m_retentionThreshold;
+    uint32_t m_retentionKeepEvery;
+    int64_t m_retentionLastFrame;
+    uint64_t m_retentionFrameNum;
+    RetentionBuffer* m_retentionBuffer;
+    FastVector<RetentionBuffer*> m_retentionBuffers;
+    FastVector<uint8_t> m_retentionFlags;
+
+#ifdef TRACY_HAS_CRASH_DUMP
+    int m_crashDumpFd;
+    const char* m_crashDumpPath;
+    bool m_crashDumpActive;
+    CrashDumpRecord m_crashDumpRecord;
+    ServerQueryPacket* m_crashDumpQueries;
+    uint32_t m_crashDumpQueryCount;
+#endif
 #ifdef TRACY_ON_DEMAND
     std::atomic<bool> m_isConnected;
+    std::atomic<bool> m_isCaptureSuspended;
     std::atomic<uint64_t> m_connectionId;
 
+    TracyMutex m_captureLock;
+    bool m_hasConnection;
+    bool m_captureOpen;
+
     TracyMutex m_deferredLock;
     FastVector<QueueItem> m_deferredQueue;
 #endif
@@ -672,6 +932,39 @@ private:
     void ProcessSysTime() {}
 #endif
 
+    void ProcessCounters();
+    int64_t m_counterLast;
+
+    // Queue memory grown during a burst is released, once the peak usage stays low for
+    // QueueTrimIntervals sampling intervals.
+    enum { QueueMemoryInterval = 1000 };    // ms
+    enum { QueueTrimIntervals = 10 };
+    void ProcessQueueMemory();
+    int64_t m_queueMemoryLast;
+    int m_queueMemoryIntervals;
+    size_t m_queuePeak;
+    size_t m_serialPeak;
+    size_t m_serialMemory;
+
+#ifdef TRACY_PROFILER_STATS
+    // Cost of the profiler, reported to the server as plots. Time spent in frame commits, which
+    // includes waiting for the send thread, is not counted as dequeue time.
+    enum { ProfilerStatsInterval = 100 };   // ms
+    void ProcessProfilerStats();
+    int64_t m_statLast;
+    int64_t m_statDequeueTime;
+    int64_t m_statSerialTime;
+    int64_t m_statCommitTime;
+    int64_t m_statSymbolTime;
+    int64_t m_statCompressLast;
+    int64_t m_statSocketLast;
+    uint64_t m_statSentLast;
+    size_t m_statQueuePeak;
+    uint64_t m_statDropped;
+#else
+    void ProcessProfilerStats() {}
+#endif
+
     ParameterCallback m_paramCallback;
 };
 
@@ -101,6 +101,31 @@ public:
         TracyLfqCommit;
     }
 
+    // Links this zone to a zone which will mark the same flow id as incoming.
+    tracy_force_inline void FlowOut( uint64_t id )
+    {
+        if( !m_active ) return;
+#ifdef TRACY_ON_DEMAND
+        if( GetProfiler().ConnectionId() != m_connectionId ) return;
+#endif
+        TracyLfqPrepare( QueueType::ZoneFlowOut );
+        MemWrite( &item->zoneFlow.time, Profiler::GetTime() );
+        MemWrite( &item->zoneFlow.id, id );
+        TracyLfqCommit;
+    }
+
+    tracy_force_inline void FlowIn( uint64_t id )
+    {
+        if( !m_active ) return;
+#ifdef TRACY_ON_DEMAND
+        if( GetProfiler().ConnectionId() != m_connectionId ) return;
+#endif
+        TracyLfqPrepare( QueueType::ZoneFlowIn );
+        MemWrite( &item->zoneFlow.time, Profiler::GetTime() );
+        MemWrite( &item->zoneFlow.id, id );
+        TracyLfqCommit;
+    }
+
 private:
     const bool m_active;
 
@@ -0,0 +1,261 @@
+#ifndef __TRACYWAIT_HPP__
+#define __TRACYWAIT_HPP__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <stddef.h>
+#include <utility>
+
+#include "../common/TracySystem.hpp"
+#include "TracyProfiler.hpp"
+
+namespace tracy
+{
+
+// Waits and notifications on a synchronization object. The notifying thread is not passed to
+// the waiter, the server matches each finished wait with the last notification issued during it.
+// Notifications are therefore sent before the waiting threads are actually woken up.
+class WaitableCtx
+{
+public:
+    tracy_force_inline WaitableCtx( const SourceLocationData* srcloc, WaitType type )
+        : m_id( GetLockCounter().fetch_add( 1, std::memory_order_relaxed ) )
+    {
+        assert( m_id != std::numeric_limits<uint32_t>::max() );
+
+        TracyLfqPrepare( QueueType::WaitAnnounce );
+        MemWrite( &item->waitAnnounce.id, m_id );
+        MemWrite( &item->waitAnnounce.time, Profiler::GetTime() );
+        MemWrite( &item->waitAnnounce.srcloc, (uint64_t)srcloc );
+        MemWrite( &item->waitAnnounce.type, type );
+#ifdef TRACY_ON_DEMAND
+        GetProfiler().DeferItem( *item );
+#endif
+        TracyLfqCommit;
+    }
+
+    WaitableCtx( const WaitableCtx& ) = delete;
+    WaitableCtx& operator=( const WaitableCtx& ) = delete;
+
+    tracy_force_inline ~WaitableCtx()
+    {
+        TracyLfqPrepare( QueueType::WaitTerminate );
+        MemWrite( &item->waitTerminate.id, m_id );
+        MemWrite( &item->waitTerminate.time, Profiler::GetTime() );
+#ifdef TRACY_ON_DEMAND
+        GetProfiler().DeferItem( *item );
+#endif
+        TracyLfqCommit;
+    }
+
+    // Returns true if the wait is reported, in which case AfterWait() must be called with it.
+    tracy_force_inline bool BeforeWait()
+    {
+#ifdef TRACY_ON_DEMAND
+        if( !GetProfiler().IsConnected() ) return false;
+#endif
+        auto item = Profiler::QueueSerial();
+        MemWrite( &item->hdr.type, QueueType::WaitBegin );
+        MemWrite( &item->waitBegin.thread, GetThreadHandle() );
+        MemWrite( &item->waitBegin.id, m_id );
+        MemWrite( &item->waitBegin.time, Profiler::GetTime() );
+        Profiler::QueueSerialFinish();
+        return true;
+    }
+
+    tracy_force_inline void AfterWait( bool reported, bool timeout )
+    {
+        if( !reported ) return;
+        auto item = Profiler::QueueSerial();
+        MemWrite( &item->hdr.type, QueueType::WaitEnd );
+        MemWrite( &item->waitEnd.thread, GetThreadHandle() );
+        MemWrite( &item->waitEnd.id, m_id );
+        MemWrite( &item->waitEnd.time, Profiler::GetTime() );
+        MemWrite( &item->waitEnd.timeout, uint8_t( timeout ? 1 : 0 ) );
+        Profiler::QueueSerialFinish();
+    }
+
+    // A count of 0 wakes all waiting threads.
+    tracy_force_inline void Notify( uint32_t count )
+    {
+#ifdef TRACY_ON_DEMAND
+        if( !GetProfiler().IsConnected() ) return;
+#endif
+        auto item = Profiler::QueueSerial();
+        MemWrite( &item->hdr.type, QueueType::WaitNotify );
+        MemWrite( &item->waitNotify.thread, GetThreadHandle() );
+        MemWrite( &item->waitNotify.id, m_id );
+        MemWrite( &item->waitNotify.time, Profiler::GetTime() );
+        MemWrite( &item->waitNotify.count, count );
+        Profiler::QueueSerialFinish();
+    }
+
+private:
+    uint32_t m_id;
+};
+
+// Reports a hand-rolled wait, e.g. on a futex, for the lifetime of the object.
+class ScopedWait
+{
+public:
+    tracy_force_inline ScopedWait( WaitableCtx& ctx )
+        : m_ctx( ctx )
+        , m_reported( ctx.BeforeWait() )
+    {
+    }
+
+    ScopedWait( const ScopedWait& ) = delete;
+    ScopedWait& operator=( const ScopedWait& ) = delete;
+
+    tracy_force_inline ~ScopedWait()
+    {
+        m_ctx.AfterWait( m_reported, false );
+    }
+
+private:
+    WaitableCtx& m_ctx;
+    bool m_reported;
+};
+
+// Works with std::condition_variable and std::condition_variable_any.
+template<class T>
+class ConditionVariable
+{
+public:
+    tracy_force_inline ConditionVariable( const SourceLocationData* srcloc )
+        : m_ctx( srcloc, WaitType::ConditionVariable )
+    {
+    }
+
+    ConditionVariable( const ConditionVariable& ) = delete;
+    ConditionVariable& operator=( const ConditionVariable& ) = delete;
+
+    tracy_force_inline void notify_one()
+    {
+        m_ctx.Notify( 1 );
+        m_cv.notify_one();
+    }
+
+    tracy_force_inline void notify_all()
+    {
+        m_ctx.Notify( 0 );
+        m_cv.notify_all();
+    }
+
+    template<class Lock>
+    tracy_force_inline void wait( Lock& lock )
+    {
+        const auto reported = m_ctx.BeforeWait();
+        m_cv.wait( lock );
+        m_ctx.AfterWait( reported, false );
+    }
+
+    template<class Lock, class Predicate>
+    void wait( Lock& lock, Predicate pred )
+    {
+        while( !pred() ) wait( lock );
+    }
+
+    template<class Lock, class Rep, class Period>
+    std::cv_status wait_for( Lock& lock, const std::chrono::duration<Rep, Period>& rel )
+    {
+        const auto reported = m_ctx.BeforeWait();
+        const auto status = m_cv.wait_for( lock, rel );
+        m_ctx.AfterWait( reported, status == std::cv_status::timeout );
+        return status;
+    }
+
+    template<class Lock, class Rep, class Period, class Predicate>
+    bool wait_for( Lock& lock, const std::chrono::duration<Rep, Period>& rel, Predicate pred )
+    {
+        return wait_until( lock, std::chrono::steady_clock::now() + rel, std::move( pred ) );
+    }
+
+    template<class Lock, class Clock, class Duration>
+    std::cv_status wait_until( Lock& lock, const std::chrono::time_point<Clock, Duration>& abs )
+    {
+        const auto reported = m_ctx.BeforeWait();
+        const auto status = m_cv.wait_until( lock, abs );
+        m_ctx.AfterWait( reported, status == std::cv_status::timeout );
+        return status;
+    }
+
+    template<class Lock, class Clock, class Duration, class Predicate>
+    bool wait_until( Lock& lock, const std::chrono::time_point<Clock, Duration>& abs, Predicate pred )
+    {
+        while( !pred() )
+        {
+            if( wait_until( lock, abs ) == std::cv_status::timeout ) return pred();
+        }
+        return true;
+    }
+
+private:
+    T m_cv;
+    WaitableCtx m_ctx;
+};
+
+// Works with std::counting_semaphore, or any type with the same interface. Acquisitions that
+// succeed on the first try_acquire() are not reported.
+template<class T>
+class Semaphore
+{
+public:
+    tracy_force_inline Semaphore( const SourceLocationData* srcloc, ptrdiff_t desired )
+        : m_semaphore( desired )
+        , m_ctx( srcloc, WaitType::Semaphore )
+    {
+    }
+
+    Semaphore( const Semaphore& ) = delete;
+    Semaphore& operator=( const Semaphore& ) = delete;
+
+    tracy_force_inline void release( ptrdiff_t update = 1 )
+    {
+        m_ctx.Notify( uint32_t( update ) );
+        m_semaphore.release( update );
+    }
+
+    tracy_force_inline void acquire()
+    {
+        if( m_semaphore.try_acquire() ) return;
+        const auto reported = m_ctx.BeforeWait();
+        m_semaphore.acquire();
+        m_ctx.AfterWait( reported, false );
+    }
+
+    tracy_force_inline bool try_acquire()
+    {
+        return m_semaphore.try_acquire();
+    }
+
+    template<class Rep, class Period>
+    bool try_acquire_for( const std::chrono::duration<Rep, Period>& rel )
+    {
+        if( m_semaphore.try_acquire() ) return true;
+        const auto reported = m_ctx.BeforeWait();
+        const auto acquired = m_semaphore.try_acquire_for( rel );
+        m_ctx.AfterWait( reported, !acquired );
+        return acquired;
+    }
+
+    template<class Clock, class Duration>
+    bool try_acquire_until( const std::chrono::time_point<Clock, Duration>& abs )
+    {
+        if( m_semaphore.try_acquire() ) return true;
+        const auto reported = m_ctx.BeforeWait();
+        const auto acquired = m_semaphore.try_acquire_until( abs );
+        m_ctx.AfterWait( reported, !acquired );
+        return acquired;
+    }
+
+private:
+    T m_semaphore;
+    WaitableCtx m_ctx;
+};
+
+}
+
+#endif
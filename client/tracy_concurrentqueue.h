@@ -507,6 +507,7 @@ public:
 		: producerListTail(nullptr),
 		producerCount(0),
 		initialBlockPoolIndex(0),
+		dynamicBlockCount(0),
 		nextExplicitConsumerId(0),
 		globalExplicitConsumerOffset(0)
 	{
@@ -520,6 +521,7 @@ public:
 		: producerListTail(nullptr),
 		producerCount(0),
 		initialBlockPoolIndex(0),
+		dynamicBlockCount(0),
 		nextExplicitConsumerId(0),
 		globalExplicitConsumerOffset(0)
 	{
@@ -625,6 +627,33 @@ public:
 		}
 		return size;
 	}
+
+	// Memory used by the blocks of the queue, in bytes. Thread-safe.
+	size_t block_memory() const
+	{
+		return (initialBlockPoolSize + dynamicBlockCount.load(std::memory_order_relaxed)) * sizeof(Block);
+	}
+
+	// Number of blocks allocated in addition to the initial block pool. Thread-safe.
+	size_t dynamic_block_count() const
+	{
+		return dynamicBlockCount.load(std::memory_order_relaxed);
+	}
+
+	std::uint32_t producer_count() const
+	{
+		return producerCount.load(std::memory_order_relaxed);
+	}
+
+	// Releases the fully dequeued blocks which producers keep for reuse. Memory of dynamically
+	// allocated blocks is freed, blocks of the initial pool go back to the free list. Must only
+	// be called by the consumer.
+	void release_spare_blocks()
+	{
+		for (auto ptr = producerListTail.load(std::memory_order_acquire); ptr != nullptr; ptr = ptr->next_prod()) {
+			static_cast<ExplicitProducer*>(ptr)->release_spare_blocks();
+		}
+	}
 	
 	
 	// Returns true if the underlying atomic variables used by
@@ -992,6 +1021,7 @@ private:
 	{
 		explicit ExplicitProducer(ConcurrentQueue* _parent) :
 			ProducerBase(_parent),
+			blockListLock(false),
 			blockIndex(nullptr),
 			pr_blockIndexSlotsUsed(0),
 			pr_blockIndexSize(EXPLICIT_INITIAL_INDEX_SIZE >> 1),
@@ -1074,6 +1104,9 @@ private:
 		
         inline void enqueue_begin_alloc(index_t currentTailIndex)
         {
+            // The consumer may be releasing spare blocks, which takes only a moment
+            while (blockListLock.exchange(true, std::memory_order_acquire)) {}
+
             // We reached the end of a block, start a new one
             if (this->tailBlock != nullptr && this->tailBlock->next->ConcurrentQueue::Block::is_empty()) {
                 // We can re-use the block ahead of us, it's empty!					
@@ -1115,11 +1148,48 @@ private:
             entry.block = this->tailBlock;
             blockIndex.load(std::memory_order_relaxed)->front.store(pr_blockIndexFront, std::memory_order_release);
             pr_blockIndexFront = (pr_blockIndexFront + 1) & (pr_blockIndexSize - 1);
+
+            blockListLock.store(false, std::memory_order_release);
+        }
+
+        // Unlinks the fully dequeued blocks ahead of the tail block. These are the oldest blocks,
+        // and their block index entries are no longer used by the consumer. Skipped if the
+        // producer is allocating a block right now.
+        void release_spare_blocks()
+        {
+            if (blockListLock.exchange(true, std::memory_order_acquire)) return;
+            Block* spare = nullptr;
+            if (this->tailBlock != nullptr) {
+                auto block = this->tailBlock->next;
+                while (block != this->tailBlock && block->ConcurrentQueue::Block::is_empty()) {
+                    auto next = block->next;
+                    this->tailBlock->next = next;
+                    --pr_blockIndexSlotsUsed;
+                    block->next = spare;
+                    spare = block;
+                    block = next;
+                }
+            }
+            blockListLock.store(false, std::memory_order_release);
+
+            while (spare != nullptr) {
+                auto next = spare->next;
+                this->parent->release_block(spare);
+                spare = next;
+            }
         }
 
         tracy_force_inline T* enqueue_begin(index_t& currentTailIndex)
         {
             currentTailIndex = this->tailIndex.load(std::memory_order_relaxed);
+            return enqueue_begin_at(currentTailIndex);
+        }
+
+        // Returns the slot at the given index, which must directly follow the previously returned
+        // one. Several slots can be filled this way and then published with a single tail index
+        // store.
+        tracy_force_inline T* enqueue_begin_at(index_t currentTailIndex)
+        {
             if (details::cqUnlikely((currentTailIndex & static_cast<index_t>(BLOCK_SIZE - 1)) == 0)) {
                 this->enqueue_begin_alloc(currentTailIndex);
             }
@@ -1250,6 +1320,7 @@ private:
 		}
 		
 	private:
+		std::atomic<bool> blockListLock;
 		std::atomic<BlockIndexHeader*> blockIndex;
 		
 		// To be used by producer only -- consumer must use the ones in referenced by blockIndex
@@ -1331,7 +1402,22 @@ private:
 			return block;
 		}
 		
-		return create<Block>();
+		block = create<Block>();
+		if (block != nullptr) {
+			dynamicBlockCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		return block;
+	}
+
+	void release_block(Block* block)
+	{
+		if (block->dynamicallyAllocated) {
+			destroy(block);
+			dynamicBlockCount.fetch_sub(1, std::memory_order_relaxed);
+		}
+		else {
+			add_block_to_free_list(block);
+		}
 	}
 	
 	
@@ -1445,6 +1531,7 @@ private:
 	std::atomic<size_t> initialBlockPoolIndex;
 	Block* initialBlockPool;
 	size_t initialBlockPoolSize;
+	std::atomic<size_t> dynamicBlockCount;
 	
 	FreeList<Block> freeList;
 	
@@ -0,0 +1,62 @@
+#ifndef __TRACYHISTOGRAM_HPP__
+#define __TRACYHISTOGRAM_HPP__
+
+#include <stdint.h>
+
+#include "TracyForceInline.hpp"
+
+#if defined _MSC_VER && defined _WIN64
+#  include <intrin.h>
+#endif
+
+namespace tracy
+{
+
+// Log-linear value buckets. Values below HistogramLinearRange have a bucket each, every
+// following power of two is split into HistogramSubBuckets equally sized buckets, which
+// keeps the relative bucket width below 12.5%. Negative values are counted as zero.
+enum { HistogramLinearRange = 16 };
+enum { HistogramSubBuckets = 8 };
+enum { HistogramBuckets = HistogramLinearRange + ( 63 - 4 ) * HistogramSubBuckets };
+
+static tracy_force_inline uint32_t HistogramBucket( int64_t val )
+{
+    if( val < HistogramLinearRange ) return val < 0 ? 0 : uint32_t( val );
+#if defined _MSC_VER && defined _WIN64
+    unsigned long msb;
+    _BitScanReverse64( &msb, uint64_t( val ) );
+    const auto e = uint32_t( msb );
+#elif defined _MSC_VER
+    uint32_t e = 4;
+    while( ( val >> ( e + 1 ) ) != 0 ) e++;
+#else
+    const auto e = uint32_t( 63 - __builtin_clzll( uint64_t( val ) ) );
+#endif
+    return HistogramLinearRange + ( e - 4 ) * HistogramSubBuckets + uint32_t( ( val >> ( e - 3 ) ) & ( HistogramSubBuckets - 1 ) );
+}
+
+// Smallest value counted in the bucket.
+static inline int64_t HistogramBucketMin( uint32_t bucket )
+{
+    if( bucket < HistogramLinearRange ) return bucket;
+    const auto e = ( bucket - HistogramLinearRange ) / HistogramSubBuckets + 4;
+    const auto sub = ( bucket - HistogramLinearRange ) % HistogramSubBuckets;
+    return int64_t( HistogramSubBuckets + sub ) << ( e - 3 );
+}
+
+// Largest value counted in the bucket.
+static inline int64_t HistogramBucketMax( uint32_t bucket )
+{
+    if( bucket == HistogramBuckets - 1 ) return INT64_MAX;
+    return HistogramBucketMin( bucket + 1 ) - 1;
+}
+
+// Histogram data is transferred as a list of non-empty buckets. Each entry holds the bucket
+// index in the upper 16 bits and the count of values in the lower 48 bits.
+static tracy_force_inline uint64_t HistogramPackEntry( uint32_t bucket, uint64_t count ) { return ( uint64_t( bucket ) << 48 ) | ( count & 0xFFFFFFFFFFFF ); }
+static tracy_force_inline uint32_t HistogramEntryBucket( uint64_t entry ) { return uint32_t( entry >> 48 ); }
+static tracy_force_inline uint64_t HistogramEntryCount( uint64_t entry ) { return entry & 0xFFFFFFFFFFFF; }
+
+}
+
+#endif
@@ -8,20 +8,27 @@ namespace tracy
 {
 
 constexpr unsigned Lz4CompressBound( unsigned isize ) { return isize + ( isize / 255 ) + 16; }
+constexpr unsigned ZstdCompressBound( unsigned isize ) { return isize + ( isize >> 8 ) + ( isize < 128 * 1024 ? ( 128 * 1024 - isize ) >> 11 : 0 ); }
 
-enum : uint32_t { ProtocolVersion = 33 };
-enum : uint32_t { BroadcastVersion = 1 };
+enum : uint32_t { ProtocolVersion = 47 };
+enum : uint32_t { BroadcastVersion = 2 };
 
 using lz4sz_t = uint32_t;
 
 enum { TargetFrameSize = 256 * 1024 };
 enum { LZ4Size = Lz4CompressBound( TargetFrameSize ) };
 static_assert( LZ4Size <= std::numeric_limits<lz4sz_t>::max(), "LZ4Size greater than lz4sz_t" );
+// A zstd network frame may also contain the end of the previous zstd frame.
+enum { ZstdSize = ZstdCompressBound( TargetFrameSize ) + 16 };
+enum { NetFrameMaxSize = int( LZ4Size ) > int( ZstdSize ) ? int( LZ4Size ) : int( ZstdSize ) };
 static_assert( TargetFrameSize * 2 >= 64 * 1024, "Not enough space for LZ4 stream buffer" );
 
 enum { HandshakeShibbolethSize = 8 };
 static const char HandshakeShibboleth[HandshakeShibbolethSize] = { 'T', 'r', 'a', 'c', 'y', 'P', 'r', 'f' };
 
+enum { CrashDumpMagicSize = 8 };
+static const char CrashDumpMagic[CrashDumpMagicSize] = { 'T', 'r', 'a', 'c', 'y', 'C', 'r', 'D' };
+
 enum HandshakeStatus : uint8_t
 {
     HandshakePending,
@@ -31,6 +38,14 @@ enum HandshakeStatus : uint8_t
     HandshakeDropped
 };
 
+// Network frame compression. The server sends a mask of the codecs it can decode after the
+// protocol version, the client reports the one it has chosen in the welcome message.
+enum NetworkCodec : uint8_t
+{
+    NetworkCodecLz4,
+    NetworkCodecZstd
+};
+
 enum { WelcomeMessageProgramNameSize = 64 };
 enum { WelcomeMessageHostInfoSize = 1024 };
 
@@ -64,6 +79,25 @@ struct ServerQueryPacket
 enum { ServerQueryPacketSize = sizeof( ServerQueryPacket ) };
 
 
+// Crash dump file starts with the magic, the protocol version and the welcome message, followed
+// by records. Data records contain the uncompressed stream, as it would be sent to the server.
+// Answer records contain the response the client would send to the given server query.
+enum CrashDumpRecordType : uint8_t
+{
+    CrashDumpData,
+    CrashDumpAnswer
+};
+
+struct CrashDumpRecord
+{
+    CrashDumpRecordType type;
+    ServerQueryPacket query;
+    uint32_t size;
+};
+
+enum { CrashDumpRecordSize = sizeof( CrashDumpRecord ) };
+
+
 enum CpuArchitecture : uint8_t
 {
     CpuArchUnknown,
@@ -84,9 +118,11 @@ struct WelcomeMessage
     uint64_t epoch;
     uint64_t pid;
     int64_t samplingPeriod;
+    uint64_t memSamplingInterval;
     uint8_t onDemand;
     uint8_t isApple;
     uint8_t cpuArch;
+    uint8_t codec;
     char cpuManufacturer[12];
     uint32_t cpuId;
     char programName[WelcomeMessageProgramNameSize];
@@ -111,6 +147,8 @@ struct BroadcastMessage
     uint32_t protocolVersion;
     uint32_t listenPort;
     uint32_t activeTime;        // in seconds
+    uint64_t pid;
+    uint64_t parentPid;         // 0 if the program was not forked from a profiled process
     char programName[WelcomeMessageProgramNameSize];
 };
 
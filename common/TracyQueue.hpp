@@ -29,6 +29,8 @@ enum class QueueType : uint8_t
     CallstackSampleLean,
     FrameImage,
     FrameImageLean,
+    Histogram,
+    HistogramLean,
     ZoneBegin,
     ZoneBeginCallstack,
     ZoneEnd,
@@ -39,6 +41,9 @@ enum class QueueType : uint8_t
     LockSharedObtain,
     LockSharedRelease,
     LockName,
+    WaitBegin,
+    WaitEnd,
+    WaitNotify,
     MemAlloc,
     MemFree,
     MemAllocCallstack,
@@ -60,6 +65,8 @@ enum class QueueType : uint8_t
     CrashReport,
     ZoneValidation,
     ZoneValue,
+    ZoneFlowOut,
+    ZoneFlowIn,
     FrameMarkMsg,
     FrameMarkMsgStart,
     FrameMarkMsgEnd,
@@ -67,6 +74,8 @@ enum class QueueType : uint8_t
     LockAnnounce,
     LockTerminate,
     LockMark,
+    WaitAnnounce,
+    WaitTerminate,
     MessageLiteral,
     MessageLiteralColor,
     MessageLiteralCallstack,
@@ -82,11 +91,18 @@ enum class QueueType : uint8_t
     ParamSetup,
     ParamPingback,
     CpuTopology,
+    CaptureStart,
+    CaptureStop,
+    MemNamePayload,
+    LockUncontended,
+    ModuleInfo,
     StringData,
     ThreadName,
     CustomStringData,
     PlotName,
     SourceLocationPayload,
+    InternedSourceLocationPayload,
+    StaticSourceLocationPayload,
     CallstackPayload,
     CallstackAllocPayload,
     FrameName,
@@ -94,6 +110,7 @@ enum class QueueType : uint8_t
     ExternalName,
     ExternalThreadName,
     SymbolCode,
+    HistogramData,
     NUM_TYPES
 };
 
@@ -129,6 +146,12 @@ struct QueueZoneValue
     uint64_t value;
 };
 
+struct QueueZoneFlow
+{
+    int64_t time;
+    uint64_t id;
+};
+
 struct QueueStringTransfer
 {
     uint64_t ptr;
@@ -225,6 +248,64 @@ struct QueueLockName
     uint64_t name;      // ptr
 };
 
+struct QueueLockUncontended
+{
+    uint32_t id;
+    uint32_t count;
+    LockType type;
+};
+
+enum class WaitType : uint8_t
+{
+    ConditionVariable,
+    Semaphore,
+    Futex
+};
+
+struct QueueWaitAnnounce
+{
+    uint32_t id;
+    int64_t time;
+    uint64_t srcloc;    // ptr
+    WaitType type;
+};
+
+struct QueueWaitTerminate
+{
+    uint32_t id;
+    int64_t time;
+};
+
+struct QueueWaitBegin
+{
+    uint64_t thread;
+    uint32_t id;
+    int64_t time;
+};
+
+struct QueueWaitEnd
+{
+    uint64_t thread;
+    uint32_t id;
+    int64_t time;
+    uint8_t timeout;
+};
+
+struct QueueWaitNotify
+{
+    uint64_t thread;
+    uint32_t id;
+    int64_t time;
+    uint32_t count;     // 0 wakes all waiting threads
+};
+
+struct QueueModuleInfo
+{
+    uint64_t base;
+    uint64_t size;
+    uint64_t buildId;
+};
+
 enum class PlotDataType : uint8_t
 {
     Float,
@@ -245,6 +326,18 @@ struct QueuePlotData
     } data;
 };
 
+struct QueueHistogramLean
+{
+    uint64_t name;      // ptr
+    int64_t time;
+    uint32_t period;
+};
+
+struct QueueHistogram : public QueueHistogramLean
+{
+    uint64_t data;      // ptr
+};
+
 struct QueueMessage
 {
     int64_t time;
@@ -263,7 +356,8 @@ enum class GpuContextType : uint8_t
 {
     Invalid,
     OpenGl,
-    Vulkan
+    Vulkan,
+    Device
 };
 
 struct QueueGpuNewContext
@@ -316,6 +410,11 @@ struct QueueMemFree
     uint64_t ptr;
 };
 
+struct QueueMemNamePayload
+{
+    uint64_t name;
+};
+
 struct QueueCallstackMemory
 {
     uint64_t ptr;
@@ -435,6 +534,11 @@ struct QueueCpuTopology
     uint32_t thread;
 };
 
+struct QueueCaptureWindow
+{
+    int64_t time;
+};
+
 struct QueueHeader
 {
     union
@@ -455,6 +559,7 @@ struct QueueItem
         QueueZoneEnd zoneEnd;
         QueueZoneValidation zoneValidation;
         QueueZoneValue zoneValue;
+        QueueZoneFlow zoneFlow;
         QueueStringTransfer stringTransfer;
         QueueFrameMark frameMark;
         QueueFrameImage frameImage;
@@ -468,7 +573,14 @@ struct QueueItem
         QueueLockRelease lockRelease;
         QueueLockMark lockMark;
         QueueLockName lockName;
+        QueueWaitAnnounce waitAnnounce;
+        QueueWaitTerminate waitTerminate;
+        QueueWaitBegin waitBegin;
+        QueueWaitEnd waitEnd;
+        QueueWaitNotify waitNotify;
         QueuePlotData plotData;
+        QueueHistogram histogram;
+        QueueHistogramLean histogramLean;
         QueueMessage message;
         QueueMessageColor messageColor;
         QueueGpuNewContext gpuNewContext;
@@ -477,6 +589,9 @@ struct QueueItem
         QueueGpuTime gpuTime;
         QueueMemAlloc memAlloc;
         QueueMemFree memFree;
+        QueueMemNamePayload memName;
+        QueueLockUncontended lockUncontended;
+        QueueModuleInfo moduleInfo;
         QueueCallstackMemory callstackMemory;
         QueueCallstack callstack;
         QueueCallstackAlloc callstackAlloc;
@@ -494,6 +609,7 @@ struct QueueItem
         QueuePlotConfig plotConfig;
         QueueParamSetup paramSetup;
         QueueCpuTopology cpuTopology;
+        QueueCaptureWindow captureWindow;
     };
 };
 #pragma pack()
@@ -523,6 +639,8 @@ static constexpr size_t QueueDataSize[] = {
     sizeof( QueueHeader ) + sizeof( QueueCallstackSampleLean ),
     sizeof( QueueHeader ) + sizeof( QueueFrameImage ),      // not for network transfer
     sizeof( QueueHeader ) + sizeof( QueueFrameImageLean ),
+    sizeof( QueueHeader ) + sizeof( QueueHistogram ),       // not for network transfer
+    sizeof( QueueHeader ) + sizeof( QueueHistogramLean ),
     sizeof( QueueHeader ) + sizeof( QueueZoneBegin ),
     sizeof( QueueHeader ) + sizeof( QueueZoneBegin ),       // callstack
     sizeof( QueueHeader ) + sizeof( QueueZoneEnd ),
@@ -533,6 +651,9 @@ static constexpr size_t QueueDataSize[] = {
     sizeof( QueueHeader ) + sizeof( QueueLockObtain ),      // shared
     sizeof( QueueHeader ) + sizeof( QueueLockRelease ),     // shared
     sizeof( QueueHeader ) + sizeof( QueueLockName ),
+    sizeof( QueueHeader ) + sizeof( QueueWaitBegin ),
+    sizeof( QueueHeader ) + sizeof( QueueWaitEnd ),
+    sizeof( QueueHeader ) + sizeof( QueueWaitNotify ),
     sizeof( QueueHeader ) + sizeof( QueueMemAlloc ),
     sizeof( QueueHeader ) + sizeof( QueueMemFree ),
     sizeof( QueueHeader ) + sizeof( QueueMemAlloc ),        // callstack
@@ -555,6 +676,8 @@ static constexpr size_t QueueDataSize[] = {
     sizeof( QueueHeader ) + sizeof( QueueCrashReport ),
     sizeof( QueueHeader ) + sizeof( QueueZoneValidation ),
     sizeof( QueueHeader ) + sizeof( QueueZoneValue ),
+    sizeof( QueueHeader ) + sizeof( QueueZoneFlow ),        // flow out
+    sizeof( QueueHeader ) + sizeof( QueueZoneFlow ),        // flow in
     sizeof( QueueHeader ) + sizeof( QueueFrameMark ),       // continuous frames
     sizeof( QueueHeader ) + sizeof( QueueFrameMark ),       // start
     sizeof( QueueHeader ) + sizeof( QueueFrameMark ),       // end
@@ -562,6 +685,8 @@ static constexpr size_t QueueDataSize[] = {
     sizeof( QueueHeader ) + sizeof( QueueLockAnnounce ),
     sizeof( QueueHeader ) + sizeof( QueueLockTerminate ),
     sizeof( QueueHeader ) + sizeof( QueueLockMark ),
+    sizeof( QueueHeader ) + sizeof( QueueWaitAnnounce ),
+    sizeof( QueueHeader ) + sizeof( QueueWaitTerminate ),
     sizeof( QueueHeader ) + sizeof( QueueMessage ),         // literal
     sizeof( QueueHeader ) + sizeof( QueueMessageColor ),    // literal
     sizeof( QueueHeader ) + sizeof( QueueMessage ),         // literal, callstack
@@ -577,12 +702,19 @@ static constexpr size_t QueueDataSize[] = {
     sizeof( QueueHeader ) + sizeof( QueueParamSetup ),
     sizeof( QueueHeader ),                                  // param pingback
     sizeof( QueueHeader ) + sizeof( QueueCpuTopology ),
+    sizeof( QueueHeader ) + sizeof( QueueCaptureWindow ),   // capture start
+    sizeof( QueueHeader ) + sizeof( QueueCaptureWindow ),   // capture stop
+    sizeof( QueueHeader ) + sizeof( QueueMemNamePayload ),
+    sizeof( QueueHeader ) + sizeof( QueueLockUncontended ),
+    sizeof( QueueHeader ) + sizeof( QueueModuleInfo ),
     // keep all QueueStringTransfer below
     sizeof( QueueHeader ) + sizeof( QueueStringTransfer ),  // string data
     sizeof( QueueHeader ) + sizeof( QueueStringTransfer ),  // thread name
     sizeof( QueueHeader ) + sizeof( QueueStringTransfer ),  // custom string data
     sizeof( QueueHeader ) + sizeof( QueueStringTransfer ),  // plot name
     sizeof( QueueHeader ) + sizeof( QueueStringTransfer ),  // allocated source location payload
+    sizeof( QueueHeader ) + sizeof( QueueStringTransfer ),  // interned source location payload
+    sizeof( QueueHeader ) + sizeof( QueueStringTransfer ),  // static source location payload
     sizeof( QueueHeader ) + sizeof( QueueStringTransfer ),  // callstack payload
     sizeof( QueueHeader ) + sizeof( QueueStringTransfer ),  // callstack alloc payload
     sizeof( QueueHeader ) + sizeof( QueueStringTransfer ),  // frame name
@@ -590,6 +722,7 @@ static constexpr size_t QueueDataSize[] = {
     sizeof( QueueHeader ) + sizeof( QueueStringTransfer ),  // external name
     sizeof( QueueHeader ) + sizeof( QueueStringTransfer ),  // external thread name
     sizeof( QueueHeader ) + sizeof( QueueStringTransfer ),  // symbol code
+    sizeof( QueueHeader ) + sizeof( QueueStringTransfer ),  // histogram data
 };
 
 static_assert( QueueItemSize == 32, "Queue item size not 32 bytes" );
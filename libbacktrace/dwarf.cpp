@@ -664,6 +664,13 @@ struct unit
   const char *comp_dir;
   /* Absolute file name, only set if needed.  */
   const char *abs_filename;
+  /* Offset of the abbreviations for this unit in .debug_abbrev.  */
+  uint64_t abbrev_offset;
+  /* Whether the abbreviations and the attributes of the unit DIE have
+     been read.  This is 0 for units whose address ranges were taken
+     from .debug_aranges and which were not needed yet, and -1 if
+     reading them failed.  */
+  int initialized;
   /* The abbreviations for this unit.  */
   struct abbrevs abbrevs;
 
@@ -2409,6 +2416,160 @@ find_address_ranges (struct backtrace_state *state, uintptr_t base_address,
   return 1;
 }
 
+/* Read the address ranges of compilation units from .debug_aranges.
+   Units which have an entry in the section are marked as not
+   initialized, to be read when an address inside them is first looked
+   up.  Returns 1 on success, 0 on failure.  */
+
+static int
+read_aranges (struct backtrace_state *state, uintptr_t base_address,
+	      const struct dwarf_sections *dwarf_sections, int is_bigendian,
+	      struct unit **units, size_t units_count,
+	      backtrace_error_callback error_callback, void *data,
+	      struct unit_addrs_vector *addrs)
+{
+  struct dwarf_buf aranges;
+
+  aranges.name = ".debug_aranges";
+  aranges.start = dwarf_sections->data[DEBUG_ARANGES];
+  aranges.buf = aranges.start;
+  aranges.left = dwarf_sections->size[DEBUG_ARANGES];
+  aranges.is_bigendian = is_bigendian;
+  aranges.error_callback = error_callback;
+  aranges.data = data;
+  aranges.reported_underflow = 0;
+
+  while (aranges.left > 0)
+    {
+      const unsigned char *set_start;
+      uint64_t len;
+      int is_dwarf64;
+      struct dwarf_buf set_buf;
+      int version;
+      uint64_t info_offset;
+      int addrsize;
+      int segsize;
+      size_t align;
+      struct unit *u;
+
+      set_start = aranges.buf;
+      len = read_initial_length (&aranges, &is_dwarf64);
+      set_buf = aranges;
+      set_buf.left = len;
+
+      if (!advance (&aranges, len))
+	return 0;
+
+      version = read_uint16 (&set_buf);
+      info_offset = read_offset (&set_buf, is_dwarf64);
+      addrsize = read_byte (&set_buf);
+      segsize = read_byte (&set_buf);
+      if (set_buf.reported_underflow)
+	return 0;
+
+      /* Units of sets we can't use are read up front.  */
+      if (version != 2 || segsize != 0 || (addrsize != 4 && addrsize != 8))
+	continue;
+      u = find_unit (units, units_count, info_offset);
+      if (u == NULL || u->low_offset != info_offset)
+	continue;
+
+      /* The tuples are aligned to twice the address size.  */
+      align = (set_buf.buf - set_start) % (2 * addrsize);
+      if (align != 0 && !advance (&set_buf, 2 * addrsize - align))
+	return 0;
+
+      while (set_buf.left > 0)
+	{
+	  uint64_t low;
+	  uint64_t length;
+
+	  low = read_address (&set_buf, addrsize);
+	  length = read_address (&set_buf, addrsize);
+	  if (set_buf.reported_underflow)
+	    return 0;
+	  if (low == 0 && length == 0)
+	    break;
+
+	  /* Skip ranges of code removed by the linker.  */
+	  if (low == 0 || length == 0)
+	    continue;
+
+	  if (!add_unit_addr (state, u, low + base_address,
+			      low + length + base_address, error_callback,
+			      data, addrs))
+	    return 0;
+	}
+
+      u->initialized = 0;
+    }
+
+  return 1;
+}
+
+/* Read the abbreviations of unit U and the attributes of its unit DIE,
+   adding the address ranges of the unit to ADDRS.  Returns 1 on
+   success, 0 on failure.  */
+
+static int
+read_unit (struct backtrace_state *state, uintptr_t base_address,
+	   const struct dwarf_sections *dwarf_sections, int is_bigendian,
+	   struct dwarf_data *altlink,
+	   backtrace_error_callback error_callback, void *data,
+	   struct unit *u, struct unit_addrs_vector *addrs)
+{
+  struct dwarf_buf unit_buf;
+
+  if (!read_abbrevs (state, u->abbrev_offset,
+		     dwarf_sections->data[DEBUG_ABBREV],
+		     dwarf_sections->size[DEBUG_ABBREV],
+		     is_bigendian, error_callback, data, &u->abbrevs))
+    return 0;
+
+  unit_buf.name = ".debug_info";
+  unit_buf.start = dwarf_sections->data[DEBUG_INFO];
+  unit_buf.buf = u->unit_data;
+  unit_buf.left = u->unit_data_len;
+  unit_buf.is_bigendian = is_bigendian;
+  unit_buf.error_callback = error_callback;
+  unit_buf.data = data;
+  unit_buf.reported_underflow = 0;
+
+  if (!find_address_ranges (state, base_address, &unit_buf, dwarf_sections,
+			    is_bigendian, altlink, error_callback, data,
+			    u, addrs, NULL))
+    return 0;
+
+  return !unit_buf.reported_underflow;
+}
+
+/* Make sure that unit U, which may have been skipped by
+   build_address_map, has been read.  Returns 1 on success, 0 on
+   failure.  */
+
+static int
+init_unit (struct backtrace_state *state, struct dwarf_data *ddata,
+	   struct unit *u, backtrace_error_callback error_callback,
+	   void *data)
+{
+  struct unit_addrs_vector addrs;
+  int ret;
+
+  if (u->initialized != 0)
+    return u->initialized > 0;
+
+  /* The address ranges were already read from .debug_aranges.  */
+  memset (&addrs, 0, sizeof addrs);
+  ret = read_unit (state, ddata->base_address, &ddata->dwarf_sections,
+		   ddata->is_bigendian, ddata->altlink, error_callback, data,
+		   u, &addrs);
+  if (addrs.vec.base != NULL)
+    backtrace_vector_free (state, &addrs.vec, error_callback, data);
+
+  u->initialized = ret ? 1 : -1;
+  return ret;
+}
+
 /* Build a mapping from address ranges to the compilation units where
    the line number information for that range can be found.  Returns 1
    on success, 0 on failure.  */
@@ -2433,9 +2594,9 @@ build_address_map (struct backtrace_state *state, uintptr_t base_address,
   addrs->count = 0;
   unit_vec->count = 0;
 
-  /* Read through the .debug_info section.  FIXME: Should we use the
-     .debug_aranges section?  gdb and addr2line don't use it, but I'm
-     not sure why.  */
+  /* Read through the .debug_info section.  Only the unit headers are
+     read here, the unit DIEs are read below, or on demand for units
+     which are described in .debug_aranges.  */
 
   info.name = ".debug_info";
   info.start = dwarf_sections->data[DEBUG_INFO];
@@ -2457,10 +2618,8 @@ build_address_map (struct backtrace_state *state, uintptr_t base_address,
       struct dwarf_buf unit_buf;
       int version;
       int unit_type;
-      uint64_t abbrev_offset;
       int addrsize;
       struct unit *u;
-      enum dwarf_tag unit_tag;
 
       if (info.reported_underflow)
 	goto fail;
@@ -2513,12 +2672,8 @@ build_address_map (struct backtrace_state *state, uintptr_t base_address,
 	addrsize = read_byte (&unit_buf);
 
       memset (&u->abbrevs, 0, sizeof u->abbrevs);
-      abbrev_offset = read_offset (&unit_buf, is_dwarf64);
-      if (!read_abbrevs (state, abbrev_offset,
-			 dwarf_sections->data[DEBUG_ABBREV],
-			 dwarf_sections->size[DEBUG_ABBREV],
-			 is_bigendian, error_callback, data, &u->abbrevs))
-	goto fail;
+      u->abbrev_offset = read_offset (&unit_buf, is_dwarf64);
+      u->initialized = 1;
 
       if (version < 5)
 	addrsize = read_byte (&unit_buf);
@@ -2536,6 +2691,9 @@ build_address_map (struct backtrace_state *state, uintptr_t base_address,
 	  break;
 	}
 
+      if (unit_buf.reported_underflow)
+	goto fail;
+
       u->low_offset = unit_offset;
       unit_offset += len + (is_dwarf64 ? 12 : 4);
       u->high_offset = unit_offset;
@@ -2549,23 +2707,45 @@ build_address_map (struct backtrace_state *state, uintptr_t base_address,
       u->comp_dir = NULL;
       u->abs_filename = NULL;
       u->lineoff = 0;
+      u->str_offsets_base = 0;
+      u->addr_base = 0;
+      u->rnglists_base = 0;
 
       /* The actual line number mappings will be read as needed.  */
       u->lines = NULL;
       u->lines_count = 0;
       u->function_addrs = NULL;
       u->function_addrs_count = 0;
+    }
+  if (info.reported_underflow)
+    goto fail;
 
-      if (!find_address_ranges (state, base_address, &unit_buf, dwarf_sections,
-				is_bigendian, altlink, error_callback, data,
-				u, addrs, &unit_tag))
-	goto fail;
+  pu = (struct unit **) units.base;
 
-      if (unit_buf.reported_underflow)
+  /* Lazy reading of units is not safe if threaded.  If the section
+     can't be read, fall back to reading all units.  */
+  if (!state->threaded && dwarf_sections->size[DEBUG_ARANGES] != 0)
+    {
+      if (!read_aranges (state, base_address, dwarf_sections, is_bigendian,
+			 pu, units_count, error_callback, data, addrs))
+	{
+	  for (i = 0; i < units_count; i++)
+	    pu[i]->initialized = 1;
+	  /* Drop the ranges read before the failure.  */
+	  addrs->vec.alc += addrs->vec.size;
+	  addrs->vec.size = 0;
+	  addrs->count = 0;
+	}
+    }
+
+  for (i = 0; i < units_count; i++)
+    {
+      if (pu[i]->initialized == 0)
+	continue;
+      if (!read_unit (state, base_address, dwarf_sections, is_bigendian,
+		      altlink, error_callback, data, pu[i], addrs))
 	goto fail;
     }
-  if (info.reported_underflow)
-    goto fail;
 
   unit_vec->vec = units;
   unit_vec->count = units_count;
@@ -3312,14 +3492,16 @@ read_line_info (struct backtrace_state *state, struct dwarf_data *ddata,
   return 0;
 }
 
-static const char *read_referenced_name (struct dwarf_data *, struct unit *,
+static const char *read_referenced_name (struct backtrace_state *,
+					 struct dwarf_data *, struct unit *,
 					 uint64_t, backtrace_error_callback,
 					 void *);
 
 /* Read the name of a function from a DIE referenced by ATTR with VAL.  */
 
 static const char *
-read_referenced_name_from_attr (struct dwarf_data *ddata, struct unit *u,
+read_referenced_name_from_attr (struct backtrace_state *state,
+				struct dwarf_data *ddata, struct unit *u,
 				struct attr *attr, struct attr_val *val,
 				backtrace_error_callback error_callback,
 				void *data)
@@ -3341,27 +3523,32 @@ read_referenced_name_from_attr (struct dwarf_data *ddata, struct unit *u,
       struct unit *unit
 	= find_unit (ddata->units, ddata->units_count,
 		     val->u.uint);
-      if (unit == NULL)
+      if (unit == NULL
+	  || !init_unit (state, ddata, unit, error_callback, data))
 	return NULL;
 
       uint64_t offset = val->u.uint - unit->low_offset;
-      return read_referenced_name (ddata, unit, offset, error_callback, data);
+      return read_referenced_name (state, ddata, unit, offset,
+				   error_callback, data);
     }
 
   if (val->encoding == ATTR_VAL_UINT
       || val->encoding == ATTR_VAL_REF_UNIT)
-    return read_referenced_name (ddata, u, val->u.uint, error_callback, data);
+    return read_referenced_name (state, ddata, u, val->u.uint,
+				 error_callback, data);
 
   if (val->encoding == ATTR_VAL_REF_ALT_INFO)
     {
       struct unit *alt_unit
 	= find_unit (ddata->altlink->units, ddata->altlink->units_count,
 		     val->u.uint);
-      if (alt_unit == NULL)
+      if (alt_unit == NULL
+	  || !init_unit (state, ddata->altlink, alt_unit, error_callback,
+			 data))
 	return NULL;
 
       uint64_t offset = val->u.uint - alt_unit->low_offset;
-      return read_referenced_name (ddata->altlink, alt_unit, offset,
+      return read_referenced_name (state, ddata->altlink, alt_unit, offset,
 				   error_callback, data);
     }
 
@@ -3373,7 +3560,8 @@ read_referenced_name_from_attr (struct dwarf_data *ddata, struct unit *u,
    the same compilation unit.  */
 
 static const char *
-read_referenced_name (struct dwarf_data *ddata, struct unit *u,
+read_referenced_name (struct backtrace_state *state,
+		      struct dwarf_data *ddata, struct unit *u,
 		      uint64_t offset, backtrace_error_callback error_callback,
 		      void *data)
 {
@@ -3464,8 +3652,9 @@ read_referenced_name (struct dwarf_data *ddata, struct unit *u,
 	  {
 	    const char *name;
 
-	    name = read_referenced_name_from_attr (ddata, u, &abbrev->attrs[i],
-						   &val, error_callback, data);
+	    name = read_referenced_name_from_attr (state, ddata, u,
+						   &abbrev->attrs[i], &val,
+						   error_callback, data);
 	    if (name != NULL)
 	      ret = name;
 	  }
@@ -3637,7 +3826,7 @@ read_function_entry (struct backtrace_state *state, struct dwarf_data *ddata,
 		    const char *name;
 
 		    name
-		      = read_referenced_name_from_attr (ddata, u,
+		      = read_referenced_name_from_attr (state, ddata, u,
 							&abbrev->attrs[i], &val,
 							error_callback, data);
 		    if (name != NULL)
@@ -3974,8 +4163,13 @@ dwarf_lookup_pc (struct backtrace_state *state, struct dwarf_data *ddata,
 
       function_addrs = NULL;
       function_addrs_count = 0;
-      if (read_line_info (state, ddata, error_callback, data, entry->u, &lhdr,
-			  &lines, &count))
+      if (!init_unit (state, ddata, entry->u, error_callback, data))
+	{
+	  lines = (struct line *) (uintptr_t) -1;
+	  count = 0;
+	}
+      else if (read_line_info (state, ddata, error_callback, data, entry->u,
+			       &lhdr, &lines, &count))
 	{
 	  struct function_vector *pfvec;
 
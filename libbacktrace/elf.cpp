@@ -356,7 +356,8 @@ static const char * const dwarf_section_names[DEBUG_MAX] =
   ".debug_addr",
   ".debug_str_offsets",
   ".debug_line_str",
-  ".debug_rnglists"
+  ".debug_rnglists",
+  ".debug_aranges"
 };
 
 /* Information we gather for the sections we care about.  */
@@ -3376,6 +3377,134 @@ elf_add (struct backtrace_state *state, const char *filename, int descriptor,
   return 0;
 }
 
+/* A shared library which was not read yet.  */
+
+struct elf_lazy_module
+{
+  /* Next module in the list.  */
+  struct elf_lazy_module *next;
+  /* File name of the module.  */
+  char *filename;
+  /* Base address passed to elf_add.  */
+  uintptr_t base_address;
+  /* Address range of the loaded segments.  */
+  uintptr_t low;
+  uintptr_t high;
+  /* Whether reading the module was attempted.  */
+  int loaded;
+};
+
+/* Read the debug info of the lazily loaded module containing PC, if
+   it was not read yet.  */
+
+static void
+elf_lazy_load (struct backtrace_state *state, uintptr_t pc,
+	       backtrace_error_callback error_callback, void *data)
+{
+  struct elf_lazy_module *m;
+
+  for (m = state->lazy_modules; m != NULL; m = m->next)
+    {
+      int descriptor;
+      int does_not_exist;
+      fileline elf_fileline_fn;
+      int found_sym;
+      int found_dwarf;
+
+      if (pc < m->low || pc >= m->high)
+	continue;
+      if (m->loaded)
+	return;
+      m->loaded = 1;
+
+      descriptor = backtrace_open (m->filename, error_callback, data,
+				   &does_not_exist);
+      if (descriptor < 0)
+	return;
+
+      if (elf_add (state, m->filename, descriptor, m->base_address,
+		   error_callback, data, &elf_fileline_fn, &found_sym,
+		   &found_dwarf, NULL, 0, 0, NULL, 0))
+	{
+	  if (found_dwarf)
+	    state->lazy_fileline_fn = elf_fileline_fn;
+	}
+      return;
+    }
+}
+
+/* File/line lookup which reads the containing module on demand.  */
+
+static int
+elf_lazy_fileline (struct backtrace_state *state, uintptr_t pc,
+		   backtrace_full_callback callback,
+		   backtrace_error_callback error_callback, void *data)
+{
+  elf_lazy_load (state, pc, error_callback, data);
+  return state->lazy_fileline_fn (state, pc, callback, error_callback, data);
+}
+
+/* Symbol lookup which reads the containing module on demand.  */
+
+static void
+elf_lazy_syminfo (struct backtrace_state *state, uintptr_t addr,
+		  backtrace_syminfo_callback callback,
+		  backtrace_error_callback error_callback, void *data)
+{
+  elf_lazy_load (state, addr, error_callback, data);
+  elf_syminfo (state, addr, callback, error_callback, data);
+}
+
+/* Record a shared library to be read on demand.  Returns 0 if the
+   module can't be recorded.  */
+
+static int
+elf_add_lazy (struct backtrace_state *state, struct dl_phdr_info *info,
+	      backtrace_error_callback error_callback, void *data)
+{
+  struct elf_lazy_module *m;
+  uintptr_t low;
+  uintptr_t high;
+  size_t len;
+  int i;
+
+  low = (uintptr_t) -1;
+  high = 0;
+  for (i = 0; i < info->dlpi_phnum; i++)
+    {
+      const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+      if (phdr->p_type != PT_LOAD)
+	continue;
+      if (phdr->p_vaddr < low)
+	low = phdr->p_vaddr;
+      if (phdr->p_vaddr + phdr->p_memsz > high)
+	high = phdr->p_vaddr + phdr->p_memsz;
+    }
+  if (low >= high)
+    return 0;
+
+  len = strlen (info->dlpi_name);
+  m = ((struct elf_lazy_module *)
+       backtrace_alloc (state, sizeof *m, error_callback, data));
+  if (m == NULL)
+    return 0;
+  m->filename = (char *) backtrace_alloc (state, len + 1, error_callback,
+					  data);
+  if (m->filename == NULL)
+    {
+      backtrace_free (state, m, sizeof *m, error_callback, data);
+      return 0;
+    }
+  memcpy (m->filename, info->dlpi_name, len + 1);
+  m->base_address = info->dlpi_addr;
+  m->low = info->dlpi_addr + low;
+  m->high = info->dlpi_addr + high;
+  m->loaded = 0;
+  m->next = state->lazy_modules;
+  state->lazy_modules = m;
+  return 1;
+}
+
 /* Data passed to phdr_callback.  */
 
 struct phdr_data
@@ -3426,6 +3555,12 @@ phdr_callback (struct dl_phdr_info *info, size_t size ATTRIBUTE_UNUSED,
 	  pd->exe_descriptor = -1;
 	}
 
+      /* Reading debug info of all shared libraries up front is slow,
+	 and most of them never show up in a call stack.  */
+      if (!pd->state->threaded
+	  && elf_add_lazy (pd->state, info, pd->error_callback, pd->data))
+	return 0;
+
       filename = info->dlpi_name;
       descriptor = backtrace_open (info->dlpi_name, pd->error_callback,
 				   pd->data, &does_not_exist);
@@ -3503,6 +3638,13 @@ backtrace_initialize (struct backtrace_state *state, const char *filename,
   if (*fileline_fn == NULL || *fileline_fn == elf_nodebug)
     *fileline_fn = elf_fileline_fn;
 
+  if (state->lazy_modules != NULL)
+    {
+      state->lazy_fileline_fn = *fileline_fn;
+      *fileline_fn = elf_lazy_fileline;
+      state->syminfo_fn = elf_lazy_syminfo;
+    }
+
   return 1;
 }
 
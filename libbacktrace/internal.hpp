@@ -151,6 +151,12 @@ struct backtrace_state
   int lock_alloc;
   /* The freelist when using mmap.  */
   struct backtrace_freelist_struct *freelist;
+  /* Shared libraries whose debug info is read on first lookup of an
+     address they contain.  Only used if not threaded.  */
+  struct elf_lazy_module *lazy_modules;
+  /* The function that returns file/line information for the modules
+     which were already read, if LAZY_MODULES is used.  */
+  fileline lazy_fileline_fn;
 };
 
 /* Open a file for reading.  Returns -1 on error.  If DOES_NOT_EXIST
@@ -302,6 +308,7 @@ enum dwarf_section
   DEBUG_STR_OFFSETS,
   DEBUG_LINE_STR,
   DEBUG_RNGLISTS,
+  DEBUG_ARANGES,
 
   DEBUG_MAX
 };
@@ -292,7 +292,8 @@ static const char * const dwarf_section_names[DEBUG_MAX] =
   "", /* DEBUG_ADDR */
   "__debug_str_offs",
   "", /* DEBUG_LINE_STR */
-  "__debug_rnglists"
+  "__debug_rnglists",
+  "__debug_aranges"
 };
 
 /* Forward declaration.  */
@@ -0,0 +1,244 @@
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <inttypes.h>
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "../../server/TracyFileRead.hpp"
+#include "../../server/TracyMemory.hpp"
+#include "../../server/TracyPrint.hpp"
+#include "../../server/TracyWorker.hpp"
+
+// Plays back an event stream recorded with "capture -r" into a fresh worker, without any
+// network transfer or decompression, and reports how fast the worker has processed it.
+
+static const char* QueueTypeName[] = {
+    "ZoneText",
+    "ZoneName",
+    "Message",
+    "MessageColor",
+    "MessageCallstack",
+    "MessageColorCallstack",
+    "MessageAppInfo",
+    "ZoneBeginAllocSrcLoc",
+    "ZoneBeginAllocSrcLocLean",
+    "ZoneBeginAllocSrcLocCallstack",
+    "ZoneBeginAllocSrcLocCallstackLean",
+    "CallstackMemory",
+    "CallstackMemoryLean",
+    "Callstack",
+    "CallstackLean",
+    "CallstackAlloc",
+    "CallstackAllocLean",
+    "CallstackSample",
+    "CallstackSampleLean",
+    "FrameImage",
+    "FrameImageLean",
+    "Histogram",
+    "HistogramLean",
+    "ZoneBegin",
+    "ZoneBeginCallstack",
+    "ZoneEnd",
+    "LockWait",
+    "LockObtain",
+    "LockRelease",
+    "LockSharedWait",
+    "LockSharedObtain",
+    "LockSharedRelease",
+    "LockName",
+    "WaitBegin",
+    "WaitEnd",
+    "WaitNotify",
+    "MemAlloc",
+    "MemFree",
+    "MemAllocCallstack",
+    "MemFreeCallstack",
+    "GpuZoneBegin",
+    "GpuZoneBeginCallstack",
+    "GpuZoneEnd",
+    "GpuZoneBeginSerial",
+    "GpuZoneBeginCallstackSerial",
+    "GpuZoneEndSerial",
+    "PlotData",
+    "ContextSwitch",
+    "ThreadWakeup",
+    "GpuTime",
+    "Terminate",
+    "KeepAlive",
+    "ThreadContext",
+    "Crash",
+    "CrashReport",
+    "ZoneValidation",
+    "ZoneValue",
+    "ZoneFlowOut",
+    "ZoneFlowIn",
+    "FrameMarkMsg",
+    "FrameMarkMsgStart",
+    "FrameMarkMsgEnd",
+    "SourceLocation",
+    "LockAnnounce",
+    "LockTerminate",
+    "LockMark",
+    "WaitAnnounce",
+    "WaitTerminate",
+    "MessageLiteral",
+    "MessageLiteralColor",
+    "MessageLiteralCallstack",
+    "MessageLiteralColorCallstack",
+    "GpuNewContext",
+    "CallstackFrameSize",
+    "CallstackFrame",
+    "SymbolInformation",
+    "CodeInformation",
+    "SysTimeReport",
+    "TidToPid",
+    "PlotConfig",
+    "ParamSetup",
+    "ParamPingback",
+    "CpuTopology",
+    "CaptureStart",
+    "CaptureStop",
+    "MemNamePayload",
+    "LockUncontended",
+    "ModuleInfo",
+    "StringData",
+    "ThreadName",
+    "CustomStringData",
+    "PlotName",
+    "SourceLocationPayload",
+    "InternedSourceLocationPayload",
+    "StaticSourceLocationPayload",
+    "CallstackPayload",
+    "CallstackAllocPayload",
+    "FrameName",
+    "FrameImageData",
+    "ExternalName",
+    "ExternalThreadName",
+    "SymbolCode",
+    "HistogramData",
+};
+
+static_assert( sizeof( QueueTypeName ) / sizeof( *QueueTypeName ) == (int)tracy::QueueType::NUM_TYPES, "Queue type names are out of date" );
+
+void Usage()
+{
+    printf( "Usage: replay [--no-timing] stream\n" );
+    printf( "  --no-timing: don't measure the processing time of each event type\n" );
+    exit( 1 );
+}
+
+size_t PeakRss()
+{
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+#  ifdef __APPLE__
+    return size_t( usage.ru_maxrss );
+#  else
+    return size_t( usage.ru_maxrss ) * 1024;
+#  endif
+#endif
+}
+
+int main( int argc, char** argv )
+{
+#ifdef _WIN32
+    if( !AttachConsole( ATTACH_PARENT_PROCESS ) )
+    {
+        AllocConsole();
+        SetConsoleMode( GetStdHandle( STD_OUTPUT_HANDLE ), 0x07 );
+    }
+#endif
+
+    tracy::Worker::ReplayStats stats;
+    stats.timing = true;
+
+    if( argc == 3 )
+    {
+        if( strcmp( argv[1], "--no-timing" ) != 0 ) Usage();
+        stats.timing = false;
+        argv++;
+    }
+    else if( argc != 2 )
+    {
+        Usage();
+    }
+
+    const char* input = argv[1];
+    auto f = std::unique_ptr<tracy::FileRead>( tracy::FileRead::Open( input ) );
+    if( !f )
+    {
+        fprintf( stderr, "Cannot open input file!\n" );
+        exit( 1 );
+    }
+
+    printf( "Replaying...\r" );
+    fflush( stdout );
+    try
+    {
+        tracy::Worker worker( *f, stats );
+
+        const auto& failure = worker.GetFailureType();
+        if( failure != tracy::Worker::Failure::None )
+        {
+            printf( "\033[31;1mInstrumentation failure: %s\033[0m\n", tracy::Worker::GetFailureString( failure ) );
+        }
+
+        const auto sec = std::max<int64_t>( stats.time, 1 ) / 1000000000.;
+        printf( "Events: %s\nData: %s\nZones: %s\nTime span: %s\nProcessing time: %s\n",
+            tracy::RealToString( stats.events ), tracy::MemSizeToString( stats.bytes ), tracy::RealToString( worker.GetZoneCount() ),
+            tracy::TimeToString( worker.GetLastTime() ), tracy::TimeToString( stats.time ) );
+        printf( "Throughput: %.2f M events/s, %.2f MB/s\n", stats.events / sec / 1000000., stats.bytes / sec / ( 1024. * 1024. ) );
+        printf( "Peak memory: %s tracked", tracy::MemSizeToString( stats.memPeak ) );
+        if( const auto rss = PeakRss() ) printf( ", %s process", tracy::MemSizeToString( rss ) );
+        printf( "\n" );
+
+        if( stats.timing )
+        {
+            std::vector<int> types;
+            for( int i=0; i<(int)tracy::QueueType::NUM_TYPES; i++ )
+            {
+                if( stats.typeCount[i] != 0 ) types.emplace_back( i );
+            }
+            std::sort( types.begin(), types.end(), [&stats] ( const auto& l, const auto& r ) { return stats.typeTime[l] > stats.typeTime[r]; } );
+
+            int64_t total = 0;
+            for( auto& v : types ) total += stats.typeTime[v];
+            printf( "\n%-32s %14s %14s %10s %8s\n", "Event type", "Count", "Time", "ns/event", "Share" );
+            for( auto& v : types )
+            {
+                printf( "%-32s %14s %14s %10.1f %7.2f%%\n", QueueTypeName[v], tracy::RealToString( stats.typeCount[v] ), tracy::TimeToString( stats.typeTime[v] ),
+                    double( stats.typeTime[v] ) / stats.typeCount[v], 100. * stats.typeTime[v] / std::max<int64_t>( total, 1 ) );
+            }
+        }
+    }
+    catch( const tracy::UnsupportedVersion& e )
+    {
+        fprintf( stderr, "The stream was recorded with protocol version %i, this build uses %i.\n", e.version, tracy::ProtocolVersion );
+        exit( 1 );
+    }
+    catch( const tracy::NotTracyDump& e )
+    {
+        fprintf( stderr, "The file you are trying to open is not a recorded event stream.\n" );
+        exit( 1 );
+    }
+    catch( const tracy::FileReadError& e )
+    {
+        fprintf( stderr, "The file you are trying to open cannot be mapped to memory.\n" );
+        exit( 1 );
+    }
+
+    return 0;
+}
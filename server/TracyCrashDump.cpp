@@ -0,0 +1,215 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "TracyCrashDump.hpp"
+#include "TracyFileWrite.hpp"
+
+namespace tracy
+{
+
+CrashDump* CrashDump::Open( const char* fn )
+{
+    FILE* f = fopen( fn, "rb" );
+    if( !f ) return nullptr;
+
+    char magic[CrashDumpMagicSize];
+    if( fread( magic, 1, CrashDumpMagicSize, f ) != CrashDumpMagicSize || memcmp( magic, CrashDumpMagic, CrashDumpMagicSize ) != 0 )
+    {
+        fclose( f );
+        return nullptr;
+    }
+
+    fseek( f, 0, SEEK_END );
+    const auto sz = ftell( f ) - CrashDumpMagicSize;
+    fseek( f, CrashDumpMagicSize, SEEK_SET );
+    std::vector<char> data( sz );
+    const auto rd = fread( data.data(), 1, sz, f );
+    fclose( f );
+    data.resize( rd );
+
+    return new CrashDump( std::move( data ) );
+}
+
+CrashDump::CrashDump( std::vector<char>&& data )
+    : m_data( std::move( data ) )
+    , m_protocolVersion( 0 )
+    , m_welcome( nullptr )
+{
+    auto ptr = m_data.data();
+    auto end = ptr + m_data.size();
+
+    if( end - ptr < ptrdiff_t( sizeof( uint32_t ) ) ) return;
+    memcpy( &m_protocolVersion, ptr, sizeof( uint32_t ) );
+    ptr += sizeof( uint32_t );
+    if( m_protocolVersion != ProtocolVersion || end - ptr < ptrdiff_t( sizeof( WelcomeMessage ) ) ) return;
+    // On-demand clients don't write crash dumps.
+    if( ( (const WelcomeMessage*)ptr )->onDemand != 0 ) return;
+    m_welcome = (const WelcomeMessage*)ptr;
+    ptr += sizeof( WelcomeMessage );
+
+    // The dump may be truncated, if the crashed program was killed while writing it.
+    while( end - ptr >= ptrdiff_t( sizeof( CrashDumpRecord ) ) )
+    {
+        CrashDumpRecord hdr;
+        memcpy( &hdr, ptr, sizeof( hdr ) );
+        ptr += sizeof( hdr );
+        if( hdr.size > TargetFrameSize || end - ptr < ptrdiff_t( hdr.size ) ) break;
+        const Record record { ptr, hdr.size };
+        ptr += hdr.size;
+
+        if( hdr.type == CrashDumpData )
+        {
+            m_stream.emplace_back( record );
+        }
+        else
+        {
+            m_answers[std::make_pair( uint8_t( hdr.query.type ), uint64_t( hdr.query.ptr ) )].emplace_back( record );
+        }
+    }
+}
+
+bool CrashDump::WriteStream( FileWrite& f ) const
+{
+    if( !m_welcome ) return false;
+
+    Worker::WriteStreamHeader( f, m_protocolVersion, *m_welcome, nullptr );
+    for( auto& v : m_stream )
+    {
+        f.Write( &v.size, sizeof( v.size ) );
+        f.Write( v.data, v.size );
+    }
+    const uint32_t end = 0;
+    f.Write( &end, sizeof( end ) );
+    return true;
+}
+
+void CrashDump::Answer( const ServerQueryPacket& query, std::vector<char>& data )
+{
+    switch( query.type )
+    {
+    case ServerQueryTerminate:
+    case ServerQueryDisconnect:
+    case ServerQueryParameter:
+        return;
+    default:
+        break;
+    }
+
+    auto it = m_answers.find( std::make_pair( uint8_t( query.type ), uint64_t( query.ptr ) ) );
+    if( it != m_answers.end() )
+    {
+        for( auto& v : it->second ) data.insert( data.end(), v.data, v.data + v.size );
+    }
+    else
+    {
+        AppendPlaceholder( query, data );
+    }
+}
+
+void CrashDump::AppendPlaceholder( const ServerQueryPacket& query, std::vector<char>& data )
+{
+    const uint64_t ptr = query.ptr;
+    QueueItem item;
+
+    switch( query.type )
+    {
+    case ServerQueryString:
+        AppendString( ptr, "???", QueueType::StringData, data );
+        break;
+    case ServerQueryThreadString:
+        AppendString( ptr, "???", QueueType::ThreadName, data );
+        break;
+    case ServerQueryPlotName:
+        AppendString( ptr, "???", QueueType::PlotName, data );
+        break;
+    case ServerQueryFrameName:
+        AppendString( ptr, "???", QueueType::FrameName, data );
+        break;
+    case ServerQueryExternalName:
+        AppendString( ptr, "???", QueueType::ExternalThreadName, data );
+        AppendString( ptr, "???", QueueType::ExternalName, data );
+        break;
+    case ServerQuerySourceLocation:
+        // Function and file names will be asked for, and will also get placeholders.
+        item.hdr.type = QueueType::SourceLocation;
+        item.srcloc.name = 0;
+        item.srcloc.function = ptr;
+        item.srcloc.file = ptr;
+        item.srcloc.line = 0;
+        item.srcloc.r = item.srcloc.g = item.srcloc.b = 0;
+        AppendItem( item, data );
+        break;
+    case ServerQueryCallstackFrame:
+    {
+        // Frames are not decoded in the crashed program, their addresses are shown instead.
+        char addr[32];
+        sprintf( addr, "0x%" PRIx64, ptr );
+        // Custom strings are keyed by pointers, which must not collide while they are pending.
+        AppendString( ptr, "???", QueueType::CustomStringData, data );
+        item.hdr.type = QueueType::CallstackFrameSize;
+        item.callstackFrameSize.ptr = ptr;
+        item.callstackFrameSize.size = 1;
+        item.callstackFrameSize.imageName = ptr;
+        AppendItem( item, data );
+        AppendString( ptr, addr, QueueType::CustomStringData, data );
+        AppendString( ptr + 1, "???", QueueType::CustomStringData, data );
+        item.hdr.type = QueueType::CallstackFrame;
+        item.callstackFrame.name = ptr;
+        item.callstackFrame.file = ptr + 1;
+        item.callstackFrame.line = 0;
+        item.callstackFrame.symAddr = 0;
+        memset( item.callstackFrame.symLen, 0, 3 );
+        AppendItem( item, data );
+        break;
+    }
+    case ServerQuerySymbol:
+        AppendString( ptr, "???", QueueType::CustomStringData, data );
+        item.hdr.type = QueueType::SymbolInformation;
+        item.symbolInformation.file = ptr;
+        item.symbolInformation.line = 0;
+        item.symbolInformation.symAddr = ptr;
+        AppendItem( item, data );
+        break;
+    case ServerQuerySymbolCode:
+    {
+        item.hdr.type = QueueType::SymbolCode;
+        item.stringTransfer.ptr = ptr;
+        AppendItem( item, data );
+        const uint32_t l32 = 0;
+        data.insert( data.end(), (const char*)&l32, (const char*)&l32 + sizeof( l32 ) );
+        break;
+    }
+    case ServerQueryCodeLocation:
+        AppendString( ptr, "???", QueueType::CustomStringData, data );
+        item.hdr.type = QueueType::CodeInformation;
+        item.codeInformation.ptr = ptr;
+        item.codeInformation.file = ptr;
+        item.codeInformation.line = 0;
+        AppendItem( item, data );
+        break;
+    default:
+        assert( false );
+        break;
+    }
+}
+
+void CrashDump::AppendString( uint64_t ptr, const char* str, QueueType type, std::vector<char>& data )
+{
+    QueueItem item;
+    item.hdr.type = type;
+    item.stringTransfer.ptr = ptr;
+    AppendItem( item, data );
+
+    const auto l16 = uint16_t( strlen( str ) );
+    data.insert( data.end(), (const char*)&l16, (const char*)&l16 + sizeof( l16 ) );
+    data.insert( data.end(), str, str + l16 );
+}
+
+void CrashDump::AppendItem( const QueueItem& item, std::vector<char>& data )
+{
+    data.insert( data.end(), (const char*)&item, (const char*)&item + QueueDataSize[item.hdr.idx] );
+}
+
+}
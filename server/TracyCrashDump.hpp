@@ -0,0 +1,58 @@
+#ifndef __TRACYCRASHDUMP_HPP__
+#define __TRACYCRASHDUMP_HPP__
+
+#include <map>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "../common/TracyProtocol.hpp"
+#include "../common/TracyQueue.hpp"
+#include "TracyWorker.hpp"
+
+namespace tracy
+{
+
+// Crash dump written by a client which has crashed without ever being connected to a server.
+// The dump is converted to a recorded event stream, which is replayed by a worker. Queries for
+// which the dump has no answer get placeholder responses.
+class CrashDump : public Worker::ReplayAnswers
+{
+public:
+    // Returns nullptr if the file is not a crash dump.
+    static CrashDump* Open( const char* fn );
+
+    CrashDump( const CrashDump& ) = delete;
+    CrashDump( CrashDump&& ) = delete;
+    CrashDump& operator=( const CrashDump& ) = delete;
+    CrashDump& operator=( CrashDump&& ) = delete;
+
+    uint32_t GetProtocolVersion() const { return m_protocolVersion; }
+
+    // The stream must be replayed with this object answering the queries.
+    bool WriteStream( FileWrite& f ) const;
+    void Answer( const ServerQueryPacket& query, std::vector<char>& data ) override;
+
+private:
+    struct Record
+    {
+        const char* data;
+        uint32_t size;
+    };
+
+    CrashDump( std::vector<char>&& data );
+
+    void AppendPlaceholder( const ServerQueryPacket& query, std::vector<char>& data );
+    void AppendString( uint64_t ptr, const char* str, QueueType type, std::vector<char>& data );
+    void AppendItem( const QueueItem& item, std::vector<char>& data );
+
+    std::vector<char> m_data;
+    uint32_t m_protocolVersion;
+    const WelcomeMessage* m_welcome;
+    std::vector<Record> m_stream;
+    std::map<std::pair<uint8_t, uint64_t>, std::vector<Record>> m_answers;
+};
+
+}
+
+#endif
@@ -214,11 +214,26 @@ struct ZoneExtra
     Int24 callstack;
     StringIdx text;
     StringIdx name;
+    uint32_t flowOut;   // index of flow + 1, or 0 if not set
+    uint32_t flowIn;
 };
 
 enum { ZoneExtraSize = sizeof( ZoneExtra ) };
 
 
+struct FlowData
+{
+    int64_t timeOut;    // -1 if not known
+    int64_t timeIn;
+    uint16_t threadOut;
+    uint16_t threadIn;
+    int16_t srclocOut;
+    int16_t srclocIn;
+};
+
+enum { FlowDataSize = sizeof( FlowData ) };
+
+
 struct SampleData
 {
     Int48 time;
@@ -517,6 +532,26 @@ struct FrameEvent
 enum { FrameEventSize = sizeof( FrameEvent ) };
 
 
+struct CaptureGap
+{
+    int64_t start;
+    int64_t end;
+};
+
+enum { CaptureGapSize = sizeof( CaptureGap ) };
+
+
+struct HistogramInterval
+{
+    int64_t start;
+    int64_t end;
+    uint32_t offset;
+    uint32_t count;
+};
+
+enum { HistogramIntervalSize = sizeof( HistogramInterval ) };
+
+
 struct FrameImage
 {
     short_ptr<const char> ptr;
@@ -595,6 +630,7 @@ struct LockMap
     LockType type;
     int64_t timeAnnounce;
     int64_t timeTerminate;
+    uint64_t uncontended = 0;
     bool valid;
     bool isContended;
 
@@ -610,6 +646,46 @@ struct LockHighlight
     bool blocked;
 };
 
+enum class WaitType : uint8_t;
+
+struct WaitEvent
+{
+    int64_t start;
+    int64_t end;        // -1 while the thread is waiting
+    int64_t notify;     // time of the notification that ended the wait, -1 if none was found
+    uint64_t waker;     // thread which issued the notification
+    uint8_t timeout;
+};
+
+struct WaitNotify
+{
+    int64_t time;
+    uint32_t count;     // 0 wakes all waiting threads
+};
+
+struct WaitThreadData
+{
+    Vector<WaitEvent> waits;
+    Vector<WaitNotify> notifies;
+};
+
+struct WaitMap
+{
+    int16_t srcloc;
+    WaitType type;
+    int64_t timeAnnounce;
+    int64_t timeTerminate;
+    bool valid;
+    unordered_flat_map<uint64_t, WaitThreadData> threadData;
+};
+
+struct WaitHighlight
+{
+    int64_t id;
+    int64_t notify;
+    uint64_t waker;
+};
+
 enum class PlotType : uint8_t
 {
     User,
@@ -636,6 +712,14 @@ struct PlotData
     PlotValueFormatting format;
 };
 
+// Bucket counts are stored as packed entries, see TracyHistogram.hpp.
+struct HistogramData
+{
+    uint64_t name;
+    Vector<HistogramInterval> intervals;
+    Vector<uint64_t> entries;
+};
+
 struct MemData
 {
     Vector<MemEvent> data;
@@ -645,6 +729,7 @@ struct MemData
     uint64_t low = std::numeric_limits<uint64_t>::max();
     uint64_t usage = 0;
     PlotData* plot = nullptr;
+    uint64_t name = 0;
 };
 
 struct FrameData
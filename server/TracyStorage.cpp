@@ -115,6 +115,38 @@ const char* GetSavePath( const char* file )
     return buf;
 }
 
+const char* GetSavePath( const char* dir, const char* file )
+{
+    assert( dir && *dir );
+    assert( file && *file );
+
+    enum { Pool = 8 };
+    enum { MaxPath = 512 };
+    static char bufpool[Pool][MaxPath];
+    static int bufsel = 0;
+    char* buf = bufpool[bufsel];
+    bufsel = ( bufsel + 1 ) % Pool;
+
+    size_t sz;
+    GetConfigDirectory( buf, sz );
+
+    const auto dsz = strlen( dir );
+    const auto fsz = strlen( file );
+    if( sz + 7 + dsz + 1 + fsz >= MaxPath ) return nullptr;
+
+    memcpy( buf+sz, "/tracy/", 7 );
+    sz += 7;
+    memcpy( buf+sz, dir, dsz );
+    sz += dsz;
+    buf[sz++] = '/';
+    buf[sz] = '\0';
+
+    if( !CreateDirStruct( buf ) ) return nullptr;
+
+    memcpy( buf+sz, file, fsz+1 );
+    return buf;
+}
+
 const char* GetSavePath( const char* program, uint64_t time, const char* file, bool create )
 {
     assert( program && *program );
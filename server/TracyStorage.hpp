@@ -7,6 +7,9 @@ namespace tracy
 {
 
 const char* GetSavePath( const char* file );
+// Places the file in a subdirectory of the save directory. Returns nullptr if
+// the directory can't be created.
+const char* GetSavePath( const char* dir, const char* file );
 const char* GetSavePath( const char* program, uint64_t time, const char* file, bool create );
 
 }
@@ -0,0 +1,259 @@
+#ifdef __MINGW32__
+#  define __STDC_FORMAT_MACROS
+#endif
+#include <algorithm>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#  include <process.h>
+#  include <windows.h>
+#else
+#  include <unistd.h>
+#endif
+
+#include "TracyStorage.hpp"
+#include "TracySymbolCache.hpp"
+
+namespace tracy
+{
+
+enum { CacheVersion = 1 };
+static const char CacheHeader[4] = { 't', 's', 'y', 'm' };
+
+static const char* GetCachePath( uint64_t buildId )
+{
+    char fn[64];
+    sprintf( fn, "%016" PRIx64, buildId );
+    return GetSavePath( "symbols", fn );
+}
+
+static bool MoveCacheFile( const char* src, const char* dst )
+{
+#ifdef _WIN32
+    return MoveFileExA( src, dst, MOVEFILE_REPLACE_EXISTING ) != 0;
+#else
+    return rename( src, dst ) == 0;
+#endif
+}
+
+static void WriteString( FILE* f, const std::string& str )
+{
+    const uint32_t sz = str.size();
+    fwrite( &sz, 1, sizeof( sz ), f );
+    fwrite( str.data(), 1, sz, f );
+}
+
+template<typename T>
+static bool ReadValue( FILE* f, T& val )
+{
+    return fread( &val, 1, sizeof( T ), f ) == sizeof( T );
+}
+
+static bool ReadString( FILE* f, std::string& str )
+{
+    uint32_t sz;
+    if( !ReadValue( f, sz ) || sz > 64*1024 ) return false;
+    str.resize( sz );
+    return fread( &str[0], 1, sz, f ) == sz;
+}
+
+SymbolCache::~SymbolCache()
+{
+    Save();
+}
+
+void SymbolCache::AddModule( uint64_t base, uint64_t size, uint64_t buildId )
+{
+    auto it = m_modules.find( buildId );
+    if( it == m_modules.end() )
+    {
+        auto module = std::make_unique<Module>();
+        module->buildId = buildId;
+        module->dirty = false;
+        Load( *module );
+        it = m_modules.emplace( buildId, std::move( module ) ).first;
+    }
+
+    // Module may have been reloaded at a different base, or unloaded and something else loaded in its place.
+    auto module = it->second.get();
+    m_ranges.erase( std::remove_if( m_ranges.begin(), m_ranges.end(), [module, base, size] ( const auto& v ) {
+        return v.module == module || ( v.base < base + size && base < v.base + v.size );
+    } ), m_ranges.end() );
+    auto rit = std::lower_bound( m_ranges.begin(), m_ranges.end(), base, [] ( const auto& l, const auto& r ) { return l.base < r; } );
+    m_ranges.insert( rit, Range { base, size, module } );
+}
+
+const SymbolCache::Range* SymbolCache::FindRange( uint64_t ptr ) const
+{
+    auto it = std::upper_bound( m_ranges.begin(), m_ranges.end(), ptr, [] ( const auto& l, const auto& r ) { return l < r.base; } );
+    if( it == m_ranges.begin() ) return nullptr;
+    --it;
+    if( ptr - it->base >= it->size ) return nullptr;
+    return &*it;
+}
+
+const SymbolCache::FrameData* SymbolCache::FindFrame( uint64_t ptr, uint64_t& base ) const
+{
+    auto range = FindRange( ptr );
+    if( !range ) return nullptr;
+    auto it = range->module->frames.find( ptr - range->base );
+    if( it == range->module->frames.end() ) return nullptr;
+    base = range->base;
+    return &it->second;
+}
+
+const SymbolCache::Symbol* SymbolCache::FindSymbol( uint64_t ptr ) const
+{
+    auto range = FindRange( ptr );
+    if( !range ) return nullptr;
+    auto it = range->module->symbols.find( ptr - range->base );
+    if( it == range->module->symbols.end() ) return nullptr;
+    return &it->second;
+}
+
+void SymbolCache::AddFrame( uint64_t ptr, FrameData&& data )
+{
+    auto range = FindRange( ptr );
+    if( !range ) return;
+    for( auto& frame : data.frames )
+    {
+        if( frame.symOffset != 0 && frame.symOffset - range->base < range->size )
+        {
+            frame.symOffset -= range->base;
+        }
+        else
+        {
+            frame.symOffset = NoSymbol;
+        }
+    }
+    range->module->frames.emplace( ptr - range->base, std::move( data ) );
+    range->module->dirty = true;
+}
+
+void SymbolCache::AddSymbol( uint64_t ptr, const char* file, uint32_t line )
+{
+    auto range = FindRange( ptr );
+    if( !range ) return;
+    range->module->symbols.emplace( ptr - range->base, Symbol { file, line } );
+    range->module->dirty = true;
+}
+
+void SymbolCache::Save()
+{
+    for( auto& v : m_modules )
+    {
+        if( !v.second->dirty ) continue;
+        Save( *v.second );
+        v.second->dirty = false;
+    }
+}
+
+void SymbolCache::Load( Module& module )
+{
+    auto path = GetCachePath( module.buildId );
+    if( !path ) return;
+    FILE* f = fopen( path, "rb" );
+    if( !f ) return;
+
+    char hdr[4];
+    uint32_t ver;
+    uint64_t buildId;
+    uint32_t cnt;
+    if( fread( hdr, 1, 4, f ) != 4 || memcmp( hdr, CacheHeader, 4 ) != 0 ||
+        !ReadValue( f, ver ) || ver != CacheVersion ||
+        !ReadValue( f, buildId ) || buildId != module.buildId ||
+        !ReadValue( f, cnt ) )
+    {
+        fclose( f );
+        return;
+    }
+
+    // Truncated or otherwise damaged files are discarded as a whole.
+    bool ok = true;
+    for( uint32_t i=0; i<cnt && ok; i++ )
+    {
+        uint64_t offset;
+        uint8_t size;
+        FrameData data;
+        ok = ReadValue( f, offset ) && ReadString( f, data.imageName ) && ReadValue( f, size );
+        if( !ok ) break;
+        data.frames.resize( size );
+        for( auto& frame : data.frames )
+        {
+            ok = ReadString( f, frame.name ) && ReadString( f, frame.file ) && ReadValue( f, frame.line ) && ReadValue( f, frame.symLen ) && ReadValue( f, frame.symOffset );
+            if( !ok ) break;
+        }
+        if( ok ) module.frames.emplace( offset, std::move( data ) );
+    }
+    if( ok ) ok = ReadValue( f, cnt );
+    for( uint32_t i=0; i<cnt && ok; i++ )
+    {
+        uint64_t offset;
+        Symbol symbol;
+        ok = ReadValue( f, offset ) && ReadString( f, symbol.file ) && ReadValue( f, symbol.line );
+        if( ok ) module.symbols.emplace( offset, std::move( symbol ) );
+    }
+    fclose( f );
+
+    if( !ok )
+    {
+        module.frames.clear();
+        module.symbols.clear();
+    }
+}
+
+void SymbolCache::Save( const Module& module )
+{
+    auto path = GetCachePath( module.buildId );
+    if( !path ) return;
+
+    // Data is written to a temporary file first, so that readers never see a partially written cache.
+    char tmp[1024];
+#ifdef _WIN32
+    const auto pid = _getpid();
+#else
+    const auto pid = getpid();
+#endif
+    if( snprintf( tmp, sizeof( tmp ), "%s.%i.tmp", path, int( pid ) ) >= int( sizeof( tmp ) ) ) return;
+    FILE* f = fopen( tmp, "wb" );
+    if( !f ) return;
+
+    const uint32_t ver = CacheVersion;
+    fwrite( CacheHeader, 1, 4, f );
+    fwrite( &ver, 1, sizeof( ver ), f );
+    fwrite( &module.buildId, 1, sizeof( module.buildId ), f );
+
+    uint32_t cnt = module.frames.size();
+    fwrite( &cnt, 1, sizeof( cnt ), f );
+    for( auto& v : module.frames )
+    {
+        const uint8_t size = v.second.frames.size();
+        fwrite( &v.first, 1, sizeof( v.first ), f );
+        WriteString( f, v.second.imageName );
+        fwrite( &size, 1, sizeof( size ), f );
+        for( auto& frame : v.second.frames )
+        {
+            WriteString( f, frame.name );
+            WriteString( f, frame.file );
+            fwrite( &frame.line, 1, sizeof( frame.line ), f );
+            fwrite( &frame.symLen, 1, sizeof( frame.symLen ), f );
+            fwrite( &frame.symOffset, 1, sizeof( frame.symOffset ), f );
+        }
+    }
+
+    cnt = module.symbols.size();
+    fwrite( &cnt, 1, sizeof( cnt ), f );
+    for( auto& v : module.symbols )
+    {
+        fwrite( &v.first, 1, sizeof( v.first ), f );
+        WriteString( f, v.second.file );
+        fwrite( &v.second.line, 1, sizeof( v.second.line ), f );
+    }
+
+    const bool ok = ferror( f ) == 0;
+    if( fclose( f ) != 0 || !ok || !MoveCacheFile( tmp, path ) ) remove( tmp );
+}
+
+}
@@ -0,0 +1,92 @@
+#ifndef __TRACYSYMBOLCACHE_HPP__
+#define __TRACYSYMBOLCACHE_HPP__
+
+#include <limits>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "tracy_robin_hood.h"
+
+namespace tracy
+{
+
+// On-disk cache of callstack frame and symbol information, shared between
+// captures of the same binaries. Entries are keyed by the module build id and
+// the offset of the address in the module, so that they remain valid when the
+// program is loaded at a different address.
+class SymbolCache
+{
+public:
+    enum : uint64_t { NoSymbol = std::numeric_limits<uint64_t>::max() };
+
+    struct Frame
+    {
+        std::string name;
+        std::string file;
+        uint32_t line;
+        uint32_t symLen;
+        uint64_t symOffset;     // NoSymbol, if not available
+    };
+
+    struct FrameData
+    {
+        std::string imageName;
+        std::vector<Frame> frames;
+    };
+
+    struct Symbol
+    {
+        std::string file;
+        uint32_t line;
+    };
+
+    SymbolCache() = default;
+    SymbolCache( const SymbolCache& ) = delete;
+    SymbolCache( SymbolCache&& ) = delete;
+    ~SymbolCache();
+
+    SymbolCache& operator=( const SymbolCache& ) = delete;
+    SymbolCache& operator=( SymbolCache&& ) = delete;
+
+    void AddModule( uint64_t base, uint64_t size, uint64_t buildId );
+    bool HasModule( uint64_t ptr ) const { return FindRange( ptr ) != nullptr; }
+
+    // Returned pointers are valid until the next call which adds data.
+    const FrameData* FindFrame( uint64_t ptr, uint64_t& base ) const;
+    const Symbol* FindSymbol( uint64_t ptr ) const;
+
+    // Symbol addresses of frames are absolute and are rebased to the module.
+    void AddFrame( uint64_t ptr, FrameData&& data );
+    void AddSymbol( uint64_t ptr, const char* file, uint32_t line );
+
+    void Save();
+
+private:
+    struct Module
+    {
+        uint64_t buildId;
+        unordered_flat_map<uint64_t, FrameData> frames;
+        unordered_flat_map<uint64_t, Symbol> symbols;
+        bool dirty;
+    };
+
+    struct Range
+    {
+        uint64_t base;
+        uint64_t size;
+        Module* module;
+    };
+
+    const Range* FindRange( uint64_t ptr ) const;
+    static void Load( Module& module );
+    static void Save( const Module& module );
+
+    unordered_flat_map<uint64_t, std::unique_ptr<Module>> m_modules;
+    std::vector<Range> m_ranges;
+};
+
+}
+
+#endif
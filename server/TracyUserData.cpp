@@ -21,7 +21,7 @@ constexpr auto FileAnnotations = "annotations";
 constexpr auto FileSourceSubstitutions = "srcsub";
 
 enum : uint32_t { VersionTimeline = 0 };
-enum : uint32_t { VersionOptions = 5 };
+enum : uint32_t { VersionOptions = 6 };
 enum : uint32_t { VersionAnnotations = 0 };
 enum : uint32_t { VersionSourceSubstitutions = 0 };
 
@@ -109,6 +109,7 @@ void UserData::LoadState( ViewData& data )
             fread( &data.drawSamples, 1, sizeof( data.drawSamples ), f );
             fread( &data.dynamicColors, 1, sizeof( data.dynamicColors ), f );
             fread( &data.ghostZones, 1, sizeof( data.ghostZones ), f );
+            fread( &data.drawFlows, 1, sizeof( data.drawFlows ), f );
         }
         fclose( f );
     }
@@ -150,6 +151,7 @@ void UserData::SaveState( const ViewData& data )
         fwrite( &data.drawSamples, 1, sizeof( data.drawSamples ), f );
         fwrite( &data.dynamicColors, 1, sizeof( data.dynamicColors ), f );
         fwrite( &data.ghostZones, 1, sizeof( data.ghostZones ), f );
+        fwrite( &data.drawFlows, 1, sizeof( data.drawFlows ), f );
         fclose( f );
     }
 }
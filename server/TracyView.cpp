@@ -27,6 +27,7 @@
 #endif
 
 #include "tracy_pdqsort.h"
+#include "../common/TracyHistogram.hpp"
 #include "TracyColor.hpp"
 #include "TracyFileRead.hpp"
 #include "TracyFileWrite.hpp"
@@ -63,8 +64,10 @@ constexpr const char* s_tracyStackFrames[] = {
     "tracy::Profiler::SendCallstack(int, unsigned long)",
     "tracy::Profiler::MemAllocCallstack",
     "tracy::Profiler::MemAllocCallstack(void const*, unsigned long, int)",
+    "tracy::Profiler::MemAllocCallstack(void const*, unsigned long, int, char const*)",
     "tracy::Profiler::MemFreeCallstack",
     "tracy::Profiler::MemFreeCallstack(void const*, int)",
+    "tracy::Profiler::MemFreeCallstack(void const*, int, char const*)",
     "tracy::ScopedZone::{ctor}",
     "tracy::ScopedZone::ScopedZone(tracy::SourceLocationData const*, int, bool)",
     "tracy::CallTrace",
@@ -75,7 +78,8 @@ constexpr const char* s_tracyStackFrames[] = {
 constexpr const char* GpuContextNames[] = {
     "Invalid",
     "OpenGL",
-    "Vulkan"
+    "Vulkan",
+    "Device"
 };
 
 
@@ -591,6 +595,16 @@ bool View::DrawImpl()
         {
             m_showCpuDataWindow = true;
         }
+        const auto& histograms = m_worker.GetHistograms();
+        if( ButtonDisablable( ICON_FA_CHART_BAR " Histograms", histograms.empty() ) )
+        {
+            m_histogram.show = true;
+        }
+        const auto& flows = m_worker.GetFlows();
+        if( ButtonDisablable( ICON_FA_LONG_ARROW_ALT_RIGHT " Flows", flows.empty() ) )
+        {
+            m_flows.show = true;
+        }
         const auto anncnt = m_annotations.size();
         if( ButtonDisablable( ICON_FA_STICKY_NOTE " Annotations", anncnt == 0 ) )
         {
@@ -758,6 +772,8 @@ bool View::DrawImpl()
     if( m_lockInfoWindow != InvalidId ) DrawLockInfoWindow();
     if( m_showPlayback ) DrawPlayback();
     if( m_showCpuDataWindow ) DrawCpuDataWindow();
+    if( m_histogram.show ) DrawHistograms();
+    if( m_flows.show ) DrawFlows();
     if( m_selectedAnnotation ) DrawSelectedAnnotation();
     if( m_showAnnotationList ) DrawAnnotationList();
     if( m_sampleParents.symAddr != 0 ) DrawSampleParents();
@@ -1090,6 +1106,7 @@ bool View::DrawConnection()
         TextDisabledUnformatted( "Real:" );
         ImGui::SameLine();
         ImGui::Text( "%6.2f Mbps", mbps / m_worker.GetCompRatio() );
+        TextFocused( "Compression:", m_worker.GetNetworkCodec() == NetworkCodecZstd ? "Zstd" : "LZ4" );
         TextFocused( "Data transferred:", MemSizeToString( m_worker.GetDataTransferred() ) );
         TextFocused( "Query backlog:", RealToString( m_worker.GetSendQueueSize() ) );
     }
@@ -2295,6 +2312,7 @@ void View::DrawZones()
     m_cpuDataThread.Decay( 0 );
     m_zoneHover = nullptr;
     m_zoneHover2.Decay( nullptr );
+    m_flowDraw.clear();
 
     if( m_vd.zvStart == m_vd.zvEnd ) return;
     assert( m_vd.zvStart < m_vd.zvEnd );
@@ -2323,6 +2341,14 @@ void View::DrawZones()
         {
             draw->AddRectFilled( linepos + ImVec2( ( tend - m_vd.zvStart ) * pxns, 0 ), linepos + ImVec2( w, lineh ), 0x44000000 );
         }
+        for( auto& gap : m_worker.GetCaptureGaps() )
+        {
+            const auto gend = gap.end < 0 ? tend : gap.end;
+            if( gend < m_vd.zvStart || gap.start > m_vd.zvEnd ) continue;
+            const auto px0 = std::max( 0.0, ( gap.start - m_vd.zvStart ) * pxns );
+            const auto px1 = std::min( double( w ), ( gend - m_vd.zvStart ) * pxns );
+            draw->AddRectFilled( linepos + ImVec2( px0, 0 ), linepos + ImVec2( px1, lineh ), 0x44000000 );
+        }
     }
 
     bool drawMouseLine = DrawZoneFramesHeader();
@@ -2628,6 +2654,7 @@ void View::DrawZones()
 
     auto& crash = m_worker.GetCrashEvent();
     LockHighlight nextLockHighlight { -1 };
+    WaitHighlight nextWaitHighlight { -1 };
     for( const auto& v : m_threadOrder )
     {
         auto& vis = Vis( v );
@@ -2697,6 +2724,10 @@ void View::DrawZones()
                 const auto lockDepth = DrawLocks( v->id, hover, pxns, wpos, offset, nextLockHighlight, yMin, yMax );
                 offset += ostep * lockDepth;
                 depth += lockDepth;
+
+                const auto waitDepth = DrawWaits( v->id, hover, pxns, wpos, offset, nextWaitHighlight, yMin, yMax );
+                offset += ostep * waitDepth;
+                depth += waitDepth;
             }
         }
         offset += ostep * 0.2f;
@@ -2988,6 +3019,34 @@ void View::DrawZones()
         ImGui::PopClipRect();
     }
     m_lockHighlight = nextLockHighlight;
+    m_waitHighlight = nextWaitHighlight;
+
+    if( m_vd.drawFlows && !m_flowDraw.empty() )
+    {
+        // Only flows with both zones visible are drawn.
+        const auto& flows = m_worker.GetFlows();
+        const auto asz = round( ty * 0.25f );
+        ImGui::PushClipRect( wpos, wpos + ImVec2( w, offset ), true );
+        for( auto& v : m_flowDraw )
+        {
+            if( !v.second.hasOut || !v.second.hasIn ) continue;
+            const auto& flow = flows[v.first];
+            const auto p0 = ImVec2( wpos.x + ( flow.timeOut - m_vd.zvStart ) * pxns, v.second.yOut );
+            const auto p1 = ImVec2( wpos.x + ( flow.timeIn - m_vd.zvStart ) * pxns, v.second.yIn );
+            draw->AddLine( p0, p1, 0xFF22DDDD, 1.5f );
+            draw->AddCircleFilled( p0, asz * 0.5f, 0xFF22DDDD );
+            const auto dx = p1.x - p0.x;
+            const auto dy = p1.y - p0.y;
+            const auto len = sqrt( dx*dx + dy*dy );
+            if( len > asz )
+            {
+                const auto ux = dx / len * asz * 2;
+                const auto uy = dy / len * asz * 2;
+                draw->AddTriangleFilled( p1, ImVec2( p1.x - ux - uy * 0.5f, p1.y - uy + ux * 0.5f ), ImVec2( p1.x - ux + uy * 0.5f, p1.y - uy - ux * 0.5f ), 0xFF22DDDD );
+            }
+        }
+        ImGui::PopClipRect();
+    }
 
     if( m_vd.drawPlots )
     {
@@ -3948,6 +4007,23 @@ int View::DrawZoneLevel( const V& vec, bool hover, double pxns, int64_t nspx, co
             const auto px1 = std::max( { std::min( pr1, double( w + 10 ) ), px0 + pxns * 0.5, px0 + MinVisSize } );
             draw->AddRectFilled( wpos + ImVec2( px0, offset ), wpos + ImVec2( px1, offset + tsz.y ), color );
             draw->AddRect( wpos + ImVec2( px0, offset ), wpos + ImVec2( px1, offset + tsz.y ), GetZoneHighlight( ev, tid, depth ), 0.f, -1, GetZoneThickness( ev ) );
+            if( m_vd.drawFlows && m_worker.HasZoneExtra( ev ) )
+            {
+                const auto& extra = m_worker.GetZoneExtra( ev );
+                const auto fy = wpos.y + offset + tsz.y / 2;
+                if( extra.flowOut != 0 )
+                {
+                    auto& fd = m_flowDraw[extra.flowOut - 1];
+                    fd.yOut = fy;
+                    fd.hasOut = true;
+                }
+                if( extra.flowIn != 0 )
+                {
+                    auto& fd = m_flowDraw[extra.flowIn - 1];
+                    fd.yIn = fy;
+                    fd.hasIn = true;
+                }
+            }
             if( dsz > MinVisSize )
             {
                 const auto diff = dsz - MinVisSize;
@@ -4644,6 +4720,7 @@ void View::DrawLockHeader( uint32_t id, const LockMap& lockmap, const SourceLoca
             ImGui::Unindent( ty );
             ImGui::Separator();
             TextFocused( "Lock events:", RealToString( lockmap.timeline.size() ) );
+            if( lockmap.uncontended != 0 ) TextFocused( "Uncontended acquisitions:", RealToString( lockmap.uncontended ) );
             ImGui::EndTooltip();
 
             if( ImGui::IsMouseClicked( 0 ) )
@@ -5204,6 +5281,232 @@ int View::DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos,
     return cnt;
 }
 
+static const char* WaitTypeName( WaitType type )
+{
+    switch( type )
+    {
+    case WaitType::ConditionVariable: return "condition variable";
+    case WaitType::Semaphore: return "semaphore";
+    case WaitType::Futex: return "futex";
+    default: assert( false ); return "";
+    }
+}
+
+int View::DrawWaits( uint64_t tid, bool hover, double pxns, const ImVec2& wpos, int _offset, WaitHighlight& highlight, float yMin, float yMax )
+{
+    const auto w = ImGui::GetWindowContentRegionWidth() - 1;
+    const auto ty = ImGui::GetFontSize();
+    const auto ostep = ty + 1;
+    auto draw = ImGui::GetWindowDrawList();
+
+    const auto ty025 = round( ty * 0.25f );
+    const auto ty05  = round( ty * 0.5f );
+
+    const auto pulse = uint8_t( ( sin( std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::system_clock::now().time_since_epoch() ).count() * 0.01 ) * 0.5 + 0.5 ) * 255 );
+
+    int cnt = 0;
+    for( const auto& v : m_worker.GetWaitMap() )
+    {
+        const auto& waitmap = *v.second;
+        if( !waitmap.valid ) continue;
+
+        auto it = waitmap.threadData.find( tid );
+        if( it == waitmap.threadData.end() ) continue;
+        const auto& waits = it->second.waits;
+        const auto& notifies = it->second.notifies;
+
+        // Waits of a thread do not overlap, only the one preceding the range may reach into it.
+        auto wit = std::lower_bound( waits.begin(), waits.end(), m_vd.zvStart, [] ( const auto& l, const auto& r ) { return l.start < r; } );
+        if( wit != waits.begin() && ( ( wit-1 )->end < 0 || ( wit-1 )->end >= m_vd.zvStart ) ) --wit;
+        const auto wend = std::lower_bound( wit, waits.end(), m_vd.zvEnd, [] ( const auto& l, const auto& r ) { return l.start < r; } );
+        auto nit = std::lower_bound( notifies.begin(), notifies.end(), m_vd.zvStart, [] ( const auto& l, const auto& r ) { return l.time < r; } );
+        const auto nend = std::lower_bound( nit, notifies.end(), m_vd.zvEnd, [] ( const auto& l, const auto& r ) { return l.time < r; } );
+        if( wit == wend && nit == nend ) continue;
+
+        const auto offset = _offset + ostep * cnt;
+        cnt++;
+        const auto yPos = wpos.y + offset;
+        if( yPos + ostep < yMin || yPos > yMax ) continue;
+
+        const auto& srcloc = m_worker.GetSourceLocation( waitmap.srcloc );
+
+        double pxend = -10;
+        while( wit < wend )
+        {
+            const auto t0 = wit->start;
+            auto t1 = wit->end < 0 ? m_worker.GetLastTime() : wit->end;
+            const auto px0 = std::max( pxend, ( t0 - m_vd.zvStart ) * pxns );
+            auto px1 = ( t1 - m_vd.zvStart ) * pxns;
+            auto next = wit + 1;
+            uint64_t condensed = 1;
+            if( px1 - px0 < MinVisSize )
+            {
+                while( next < wend )
+                {
+                    const auto nt1 = next->end < 0 ? m_worker.GetLastTime() : next->end;
+                    const auto npx1 = ( nt1 - m_vd.zvStart ) * pxns;
+                    if( npx1 - px0 >= MinVisSize ) break;
+                    t1 = nt1;
+                    px1 = npx1;
+                    ++next;
+                    condensed++;
+                }
+            }
+            pxend = std::max( px1, px0 + MinVisSize );
+
+            const auto cfilled = ( condensed == 1 && wit->timeout ) ? 0xFF666666 : 0xFF2222BD;
+            const auto rmin = wpos + ImVec2( std::max( px0, -10.0 ), offset );
+            const auto rmax = wpos + ImVec2( std::min( pxend, double( w + 10 ) ), offset + ty );
+            draw->AddRectFilled( rmin, rmax, cfilled );
+            if( condensed > 1 )
+            {
+                DrawZigZag( draw, wpos + ImVec2( 0, offset + ty05 ), px0, pxend, ty025, DarkenColor( cfilled ) );
+            }
+            else if( wit->notify >= 0 && m_waitHighlight.id == int64_t( v.first ) && m_waitHighlight.notify == wit->notify && m_waitHighlight.waker == wit->waker )
+            {
+                draw->AddRect( rmin, rmax, 0x00FFFFFF | ( pulse << 24 ), 0.f, -1, 2.f );
+            }
+            else
+            {
+                draw->AddRect( rmin, rmax, wit->timeout ? 0xFF888888 : 0xFF3B3BD6 );
+            }
+
+            if( hover && ImGui::IsMouseHoveringRect( rmin, rmax ) )
+            {
+                ImGui::BeginTooltip();
+                if( condensed > 1 )
+                {
+                    TextFocused( "Multiple waits:", RealToString( condensed ) );
+                }
+                else
+                {
+                    ImGui::TextUnformatted( m_worker.GetString( srcloc.function ) );
+                    ImGui::Separator();
+                    TextFocused( "Wait start:", TimeToString( t0 ) );
+                    if( wit->end < 0 )
+                    {
+                        TextFocused( "Wait time:", TimeToString( t1 - t0 ) );
+                        ImGui::SameLine();
+                        TextDisabledUnformatted( "(still waiting)" );
+                    }
+                    else
+                    {
+                        TextFocused( "Wait time:", TimeToString( t1 - t0 ) );
+                        if( wit->timeout )
+                        {
+                            TextDisabledUnformatted( "Timed out" );
+                        }
+                        else if( wit->notify >= 0 )
+                        {
+                            TextFocused( "Woken by:", m_worker.GetThreadName( wit->waker ) );
+                            ImGui::SameLine();
+                            ImGui::TextDisabled( "(%s)", RealToString( wit->waker ) );
+                            TextFocused( "Wake latency:", TimeToString( t1 - wit->notify ) );
+                            highlight.id = v.first;
+                            highlight.notify = wit->notify;
+                            highlight.waker = wit->waker;
+                        }
+                        else
+                        {
+                            TextDisabledUnformatted( "No notification during the wait" );
+                        }
+                    }
+                }
+                ImGui::EndTooltip();
+
+                if( ImGui::IsMouseClicked( 2 ) )
+                {
+                    ZoomToRange( t0, t1 );
+                }
+            }
+
+            wit = next;
+        }
+
+        double pxlast = -10;
+        while( nit < nend )
+        {
+            const auto px = ( nit->time - m_vd.zvStart ) * pxns;
+            if( px - pxlast < 1 )
+            {
+                ++nit;
+                continue;
+            }
+            pxlast = px;
+
+            draw->AddTriangleFilled( wpos + ImVec2( px - ty025, offset ), wpos + ImVec2( px + ty025, offset ), wpos + ImVec2( px, offset + ty05 ), 0xFF44DDDD );
+            if( m_waitHighlight.id == int64_t( v.first ) && m_waitHighlight.notify == nit->time && m_waitHighlight.waker == tid )
+            {
+                draw->AddTriangle( wpos + ImVec2( px - ty05, offset - 1 ), wpos + ImVec2( px + ty05, offset - 1 ), wpos + ImVec2( px, offset + ty ), 0x00FFFFFF | ( pulse << 24 ), 2.f );
+            }
+
+            if( hover && ImGui::IsMouseHoveringRect( wpos + ImVec2( px - ty025 - 1, offset ), wpos + ImVec2( px + ty025 + 1, offset + ty ) ) )
+            {
+                ImGui::BeginTooltip();
+                ImGui::TextUnformatted( m_worker.GetString( srcloc.function ) );
+                ImGui::Separator();
+                TextFocused( "Notification at:", TimeToString( nit->time ) );
+                if( nit->count == 0 )
+                {
+                    TextFocused( "Wakes:", "all" );
+                }
+                else
+                {
+                    TextFocused( "Wakes:", RealToString( nit->count ) );
+                }
+                bool first = true;
+                for( auto& td : waitmap.threadData )
+                {
+                    const auto& tw = td.second.waits;
+                    auto wt = std::upper_bound( tw.begin(), tw.end(), nit->time, [] ( const auto& l, const auto& r ) { return l < r.start; } );
+                    if( wt == tw.begin() ) continue;
+                    --wt;
+                    if( wt->notify != nit->time || wt->waker != tid ) continue;
+                    if( first )
+                    {
+                        ImGui::Separator();
+                        TextDisabledUnformatted( "Woken threads:" );
+                        first = false;
+                    }
+                    SmallColorBox( GetThreadColor( td.first, 0 ) );
+                    ImGui::SameLine();
+                    ImGui::TextUnformatted( m_worker.GetThreadName( td.first ) );
+                    ImGui::SameLine();
+                    ImGui::TextDisabled( "(%s later)", TimeToString( wt->end - nit->time ) );
+                }
+                ImGui::EndTooltip();
+
+                highlight.id = v.first;
+                highlight.notify = nit->time;
+                highlight.waker = tid;
+            }
+            ++nit;
+        }
+
+        char buf[1024];
+        sprintf( buf, "%" PRIu32 ": %s", v.first, m_worker.GetString( srcloc.function ) );
+        DrawTextContrast( draw, wpos + ImVec2( 0, offset ), 0xFF88DDDD, buf );
+        if( hover && ImGui::IsMouseHoveringRect( wpos + ImVec2( 0, offset ), wpos + ImVec2( ty + ImGui::CalcTextSize( buf ).x, offset + ty ) ) )
+        {
+            int64_t waitTime = 0;
+            for( auto& wait : waits )
+            {
+                if( wait.end >= 0 ) waitTime += wait.end - wait.start;
+            }
+
+            ImGui::BeginTooltip();
+            TextFocused( "Type:", WaitTypeName( waitmap.type ) );
+            ImGui::Text( "%s:%i", m_worker.GetString( srcloc.file ), srcloc.line );
+            ImGui::Separator();
+            TextFocused( "Waits:", RealToString( waits.size() ) );
+            TextFocused( "Total wait time:", TimeToString( waitTime ) );
+            TextFocused( "Notifications:", RealToString( notifies.size() ) );
+            ImGui::EndTooltip();
+        }
+    }
+    return cnt;
+}
+
 const char* View::GetThreadContextData( uint64_t thread, bool& _local, bool& _untracked, const char*& program )
 {
     static char buf[256];
@@ -5798,9 +6101,9 @@ int View::DrawPlots( int offset, double pxns, const ImVec2& wpos, bool hover, fl
 
                 if( v->type == PlotType::Memory )
                 {
-                    const auto& mem = m_worker.GetMemData();
+                    const auto& mem = m_worker.GetMemData( v->name );
 
-                    if( m_memoryAllocInfoWindow >= 0 )
+                    if( m_memoryAllocInfoWindow >= 0 && m_memoryAllocInfoPool == v->name )
                     {
                         const auto& ev = mem.data[m_memoryAllocInfoWindow];
 
@@ -5812,7 +6115,7 @@ int View::DrawPlots( int offset, double pxns, const ImVec2& wpos, bool hover, fl
                         draw->AddRectFilled( ImVec2( wpos.x + px0, yPos ), ImVec2( wpos.x + px1, yPos + PlotHeight ), 0x2288DD88 );
                         draw->AddRect( ImVec2( wpos.x + px0, yPos ), ImVec2( wpos.x + px1, yPos + PlotHeight ), 0x4488DD88 );
                     }
-                    if( m_memoryAllocHover >= 0 && m_memoryAllocHover != m_memoryAllocInfoWindow )
+                    if( m_memoryAllocHover >= 0 && m_memoryAllocHoverPool == v->name && ( m_memoryAllocHover != m_memoryAllocInfoWindow || m_memoryAllocHoverPool != m_memoryAllocInfoPool ) )
                     {
                         const auto& ev = mem.data[m_memoryAllocHover];
 
@@ -5897,7 +6200,7 @@ int View::DrawPlots( int offset, double pxns, const ImVec2& wpos, bool hover, fl
                 {
                     const auto x = ( it->time.Val() - m_vd.zvStart ) * pxns;
                     const auto y = PlotHeight - ( it->val - min ) * revrange * PlotHeight;
-                    DrawPlotPoint( wpos, x, y, offset, 0xFF44DDDD, hover, false, it, 0, false, v->type, v->format, PlotHeight );
+                    DrawPlotPoint( wpos, x, y, offset, 0xFF44DDDD, hover, false, it, 0, false, v->type, v->name, v->format, PlotHeight );
                 }
 
                 auto prevx = it;
@@ -5920,7 +6223,7 @@ int View::DrawPlots( int offset, double pxns, const ImVec2& wpos, bool hover, fl
                     const auto rsz = std::distance( it, range );
                     if( rsz == 1 )
                     {
-                        DrawPlotPoint( wpos, x1, y1, offset, 0xFF44DDDD, hover, true, it, prevy->val, false, v->type, v->format, PlotHeight );
+                        DrawPlotPoint( wpos, x1, y1, offset, 0xFF44DDDD, hover, true, it, prevy->val, false, v->type, v->name, v->format, PlotHeight );
                         prevx = it;
                         prevy = it;
                         ++it;
@@ -6037,7 +6340,7 @@ void View::DrawPlotPoint( const ImVec2& wpos, float x, float y, int offset, uint
     }
 }
 
-void View::DrawPlotPoint( const ImVec2& wpos, float x, float y, int offset, uint32_t color, bool hover, bool hasPrev, const PlotItem* item, double prev, bool merged, PlotType type, PlotValueFormatting format, float PlotHeight )
+void View::DrawPlotPoint( const ImVec2& wpos, float x, float y, int offset, uint32_t color, bool hover, bool hasPrev, const PlotItem* item, double prev, bool merged, PlotType type, uint64_t name, PlotValueFormatting format, float PlotHeight )
 {
     auto draw = ImGui::GetWindowDrawList();
     if( merged )
@@ -6079,7 +6382,7 @@ void View::DrawPlotPoint( const ImVec2& wpos, float x, float y, int offset, uint
 
             if( type == PlotType::Memory )
             {
-                auto& mem = m_worker.GetMemData();
+                auto& mem = m_worker.GetMemData( name );
                 const MemEvent* ev = nullptr;
                 if( change > 0 )
                 {
@@ -6140,10 +6443,12 @@ void View::DrawPlotPoint( const ImVec2& wpos, float x, float y, int offset, uint
                     ImGui::TextDisabled( "(%s)", RealToString( tid ) );
 
                     m_memoryAllocHover = std::distance( mem.data.begin(), ev );
+                    m_memoryAllocHoverPool = name;
                     m_memoryAllocHoverWait = 2;
                     if( ImGui::IsMouseClicked( 0 ) )
                     {
                         m_memoryAllocInfoWindow = m_memoryAllocHover;
+                        m_memoryAllocInfoPool = name;
                     }
                 }
             }
@@ -6559,6 +6864,46 @@ void View::DrawZoneInfoWindow()
     {
         TextFocused( "User text:", m_worker.GetString( m_worker.GetZoneExtra( ev ).text ) );
     }
+    if( m_worker.HasZoneExtra( ev ) )
+    {
+        const auto& extra = m_worker.GetZoneExtra( ev );
+        if( extra.flowOut != 0 )
+        {
+            const auto& flow = m_worker.GetFlows()[extra.flowOut - 1];
+            if( flow.timeIn >= 0 )
+            {
+                TextFocused( "Flow to:", m_worker.GetZoneName( m_worker.GetSourceLocation( flow.srclocIn ) ) );
+                ImGui::SameLine();
+                ImGui::TextDisabled( "(%s)", m_worker.GetThreadName( m_worker.DecompressThread( flow.threadIn ) ) );
+                ImGui::SameLine();
+                TextFocused( "latency:", TimeToString( flow.timeIn - flow.timeOut ) );
+                ImGui::SameLine();
+                if( ImGui::SmallButton( ICON_FA_SEARCH_PLUS "##flowout" ) ) ZoomToRange( flow.timeOut, std::max( flow.timeIn, flow.timeOut + 1 ) );
+            }
+            else
+            {
+                TextFocused( "Flow to:", "not received" );
+            }
+        }
+        if( extra.flowIn != 0 )
+        {
+            const auto& flow = m_worker.GetFlows()[extra.flowIn - 1];
+            if( flow.timeOut >= 0 )
+            {
+                TextFocused( "Flow from:", m_worker.GetZoneName( m_worker.GetSourceLocation( flow.srclocOut ) ) );
+                ImGui::SameLine();
+                ImGui::TextDisabled( "(%s)", m_worker.GetThreadName( m_worker.DecompressThread( flow.threadOut ) ) );
+                ImGui::SameLine();
+                TextFocused( "latency:", TimeToString( flow.timeIn - flow.timeOut ) );
+                ImGui::SameLine();
+                if( ImGui::SmallButton( ICON_FA_SEARCH_PLUS "##flowin" ) ) ZoomToRange( flow.timeOut, std::max( flow.timeIn, flow.timeOut + 1 ) );
+            }
+            else
+            {
+                TextFocused( "Flow from:", "not sent" );
+            }
+        }
+    }
 
     ImGui::Separator();
     ImGui::BeginChild( "##zoneinfo" );
@@ -6810,7 +7155,7 @@ void View::DrawZoneInfoWindow()
         }
     }
 
-    auto& mem = m_worker.GetMemData();
+    auto& mem = m_worker.GetMemData( m_memInfo.pool );
     if( !mem.data.empty() )
     {
         ImGui::Separator();
@@ -7984,6 +8329,12 @@ void View::DrawOptions()
         m_vd.ghostZones = val;
     }
 #endif
+    if( !m_worker.GetFlows().empty() )
+    {
+        val = m_vd.drawFlows;
+        SmallCheckbox( ICON_FA_LONG_ARROW_ALT_RIGHT " Draw flows", &val );
+        m_vd.drawFlows = val;
+    }
 
     int ival = m_vd.dynamicColors;
     ImGui::TextUnformatted( ICON_FA_PALETTE " Zone colors" );
@@ -12362,7 +12713,7 @@ void View::DrawMemoryAllocWindow()
     bool show = true;
     ImGui::Begin( "Memory allocation", &show, ImGuiWindowFlags_AlwaysAutoResize );
 
-    const auto& mem = m_worker.GetMemData();
+    const auto& mem = m_worker.GetMemData( m_memoryAllocInfoPool );
     const auto& ev = mem.data[m_memoryAllocInfoWindow];
     const auto tidAlloc = m_worker.DecompressThread( ev.ThreadAlloc() );
     const auto tidFree = m_worker.DecompressThread( ev.ThreadFree() );
@@ -12559,6 +12910,7 @@ void View::DrawInfo()
         }
         TextFocused( "GPU zones:", RealToString( m_worker.GetGpuZoneCount() ) );
         TextFocused( "Lock events:", RealToString( m_worker.GetLockCount() ) );
+        TextFocused( "Wait events:", RealToString( m_worker.GetWaitCount() ) );
         TextFocused( "Plot data points:", RealToString( m_worker.GetPlotCount() ) );
         if( ImGui::IsItemHovered() )
         {
@@ -12574,7 +12926,14 @@ void View::DrawInfo()
             ImGui::TextUnformatted( "Automated Tracy plots" );
             ImGui::EndTooltip();
         }
-        TextFocused( "Memory allocations:", RealToString( m_worker.GetMemData().data.size() ) );
+        size_t memAllocs = 0;
+        for( auto& v : m_worker.GetMemNameMap() ) memAllocs += v.second->data.size();
+        TextFocused( "Memory allocations:", RealToString( memAllocs ) );
+        if( m_worker.GetMemNameMap().size() > 1 )
+        {
+            ImGui::SameLine();
+            ImGui::TextDisabled( "(%s pools)", RealToString( m_worker.GetMemNameMap().size() ) );
+        }
         TextFocused( "Source locations:", RealToString( m_worker.GetSrcLocCount() ) );
         TextFocused( "Strings:", RealToString( m_worker.GetStringsCount() ) );
         TextFocused( "Symbols:", RealToString( m_worker.GetSymbolsCount() ) );
@@ -12625,6 +12984,16 @@ void View::DrawInfo()
             TextFocused( "Ratio:", buf );
             ImGui::EndTooltip();
         }
+        const auto& gaps = m_worker.GetCaptureGaps();
+        TextFocused( "Capture gaps:", RealToString( gaps.size() ) );
+        if( !gaps.empty() && ImGui::IsItemHovered() )
+        {
+            int64_t gapTime = 0;
+            for( auto& v : gaps ) gapTime += ( v.end < 0 ? m_worker.GetLastTime() : v.end ) - v.start;
+            ImGui::BeginTooltip();
+            TextFocused( "Time outside capture windows:", TimeToString( gapTime ) );
+            ImGui::EndTooltip();
+        }
         TextFocused( "Context switch regions:", RealToString( m_worker.GetContextSwitchCount() ) );
         if( ImGui::IsItemHovered() )
         {
@@ -13468,6 +13837,16 @@ void View::DrawLockInfoWindow()
         break;
     }
     TextFocused( "Lock events:", RealToString( lock.timeline.size() ) );
+    if( lock.uncontended != 0 )
+    {
+        TextFocused( "Uncontended acquisitions:", RealToString( lock.uncontended ) );
+        if( ImGui::IsItemHovered() )
+        {
+            ImGui::BeginTooltip();
+            ImGui::TextUnformatted( "Acquisitions which succeeded on the first try and were only counted, without being recorded on the timeline." );
+            ImGui::EndTooltip();
+        }
+    }
     ImGui::Separator();
 
     const auto announce = timeAnnounce;
@@ -13889,6 +14268,320 @@ void View::DrawCpuDataWindow()
     ImGui::End();
 }
 
+static const char* HistogramBucketRange( uint32_t bucket )
+{
+    static char buf[128];
+    const auto vmin = HistogramBucketMin( bucket );
+    const auto vmax = HistogramBucketMax( bucket );
+    if( vmin == vmax )
+    {
+        sprintf( buf, "%s", RealToString( vmin ) );
+    }
+    else
+    {
+        sprintf( buf, "%s - %s", RealToString( vmin ), RealToString( vmax ) );
+    }
+    return buf;
+}
+
+void View::DrawHistograms()
+{
+    const auto& histograms = m_worker.GetHistograms();
+
+    ImGui::SetNextWindowSize( ImVec2( 800, 600 ), ImGuiCond_FirstUseEver );
+    ImGui::Begin( "Histograms", &m_histogram.show );
+    if( histograms.empty() )
+    {
+        ImGui::TextWrapped( "No histograms were collected." );
+        ImGui::End();
+        return;
+    }
+
+    if( m_histogram.selected >= histograms.size() ) m_histogram.selected = 0;
+    const auto& hist = *histograms[m_histogram.selected];
+    if( ImGui::BeginCombo( "Histogram", m_worker.GetString( hist.name ) ) )
+    {
+        for( size_t i=0; i<histograms.size(); i++ )
+        {
+            ImGui::PushID( int( i ) );
+            if( ImGui::Selectable( m_worker.GetString( histograms[i]->name ), i == m_histogram.selected ) ) m_histogram.selected = i;
+            ImGui::PopID();
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::Checkbox( "Limit to view", &m_histogram.limitRange );
+    ImGui::SameLine();
+    ImGui::Checkbox( "Log values", &m_histogram.logVal );
+
+    auto it0 = hist.intervals.begin();
+    auto it1 = hist.intervals.end();
+    if( m_histogram.limitRange )
+    {
+        it0 = std::lower_bound( it0, it1, m_vd.zvStart, [] ( const auto& l, const auto& r ) { return l.end < r; } );
+        it1 = std::lower_bound( it0, it1, m_vd.zvEnd, [] ( const auto& l, const auto& r ) { return l.start < r; } );
+    }
+
+    uint64_t bins[HistogramBuckets] = {};
+    uint64_t total = 0;
+    for( auto it = it0; it != it1; ++it )
+    {
+        auto entry = hist.entries.data() + it->offset;
+        for( uint32_t i=0; i<it->count; i++ )
+        {
+            const auto cnt = HistogramEntryCount( entry[i] );
+            bins[HistogramEntryBucket( entry[i] )] += cnt;
+            total += cnt;
+        }
+    }
+
+    TextFocused( "Intervals:", RealToString( it1 - it0 ) );
+    ImGui::SameLine();
+    ImGui::Spacing();
+    ImGui::SameLine();
+    TextFocused( "Values:", RealToString( total ) );
+    if( total == 0 )
+    {
+        ImGui::End();
+        return;
+    }
+
+    uint32_t minBin = 0;
+    while( bins[minBin] == 0 ) minBin++;
+    uint32_t maxBin = HistogramBuckets - 1;
+    while( bins[maxBin] == 0 ) maxBin--;
+    uint64_t maxVal = 0;
+    for( uint32_t i=minBin; i<=maxBin; i++ ) maxVal = std::max( maxVal, bins[i] );
+
+    // Percentiles can only be given with the resolution of a bucket.
+    const double percentiles[] = { 0.5, 0.9, 0.99 };
+    const char* percentileLabels[] = { "Median:", "90th percentile:", "99th percentile:" };
+    uint64_t cumulative = 0;
+    int pidx = 0;
+    for( uint32_t i=minBin; i<=maxBin && pidx<3; i++ )
+    {
+        cumulative += bins[i];
+        while( pidx < 3 && cumulative >= percentiles[pidx] * total )
+        {
+            TextFocused( percentileLabels[pidx], HistogramBucketRange( i ) );
+            pidx++;
+        }
+    }
+    ImGui::Separator();
+
+    const auto ty = ImGui::GetTextLineHeight();
+    const auto w = ImGui::GetContentRegionAvail().x;
+    const auto Height = 200 * ty / 15.f;
+    const auto numBins = int( maxBin - minBin + 1 );
+    const auto bw = ( w - 4 ) / numBins;
+
+    ImGui::TextUnformatted( "Distribution" );
+    auto wpos = ImGui::GetCursorScreenPos();
+    ImGui::InvisibleButton( "##histogram", ImVec2( w, Height + round( ty * 1.5 ) ) );
+    bool hover = ImGui::IsItemHovered();
+
+    auto draw = ImGui::GetWindowDrawList();
+    draw->AddRectFilled( wpos, wpos + ImVec2( w, Height ), 0x22FFFFFF );
+    draw->AddRect( wpos, wpos + ImVec2( w, Height ), 0x88FFFFFF );
+
+    const auto hAdj = m_histogram.logVal ? double( Height - 4 ) / log10( maxVal + 1 ) : double( Height - 4 ) / maxVal;
+    for( int i=0; i<numBins; i++ )
+    {
+        const auto val = bins[minBin+i];
+        if( val == 0 ) continue;
+        const auto h = m_histogram.logVal ? log10( val + 1 ) * hAdj : val * hAdj;
+        draw->AddRectFilled( wpos + ImVec2( 2 + i * bw, Height - 2 - h ), wpos + ImVec2( 2 + ( i + 1 ) * bw, Height - 2 ), 0xFF22DDDD );
+    }
+
+    draw->AddText( wpos + ImVec2( 0, Height ), 0x66FFFFFF, RealToString( HistogramBucketMin( minBin ) ) );
+    const auto maxtxt = RealToString( HistogramBucketMax( maxBin ) );
+    draw->AddText( wpos + ImVec2( w - ImGui::CalcTextSize( maxtxt ).x, Height ), 0x66FFFFFF, maxtxt );
+
+    if( hover )
+    {
+        const auto bin = int( ( ImGui::GetIO().MousePos.x - wpos.x - 2 ) / bw );
+        if( bin >= 0 && bin < numBins )
+        {
+            ImGui::BeginTooltip();
+            TextFocused( "Values:", HistogramBucketRange( minBin + bin ) );
+            TextFocused( "Count:", RealToString( bins[minBin+bin] ) );
+            ImGui::EndTooltip();
+        }
+    }
+
+    // Heat map of the bucket counts over time. Intervals are merged into columns when there are
+    // more of them than pixels.
+    const auto tStart = it0->start;
+    const auto tEnd = ( it1 - 1 )->end;
+    const auto tRange = std::max<int64_t>( 1, tEnd - tStart );
+    const auto numCols = int( std::max<int64_t>( 1, std::min<int64_t>( int64_t( w - 4 ), it1 - it0 ) ) );
+    std::vector<uint64_t> cells( numCols * numBins );
+    uint64_t maxCell = 0;
+    for( auto it = it0; it != it1; ++it )
+    {
+        const auto col = std::min( numCols - 1, int( ( it->end - tStart ) * numCols / tRange ) );
+        auto entry = hist.entries.data() + it->offset;
+        for( uint32_t i=0; i<it->count; i++ )
+        {
+            auto& cell = cells[col * numBins + HistogramEntryBucket( entry[i] ) - minBin];
+            cell += HistogramEntryCount( entry[i] );
+            maxCell = std::max( maxCell, cell );
+        }
+    }
+
+    ImGui::TextUnformatted( "Over time" );
+    wpos = ImGui::GetCursorScreenPos();
+    ImGui::InvisibleButton( "##heatmap", ImVec2( w, Height + round( ty * 2.5 ) ) );
+    hover = ImGui::IsItemHovered();
+
+    draw->AddRectFilled( wpos, wpos + ImVec2( w, Height ), 0x22FFFFFF );
+    draw->AddRect( wpos, wpos + ImVec2( w, Height ), 0x88FFFFFF );
+
+    const auto cw = ( w - 4 ) / numCols;
+    const auto ch = ( Height - 4 ) / numBins;
+    const auto lmax = log10( maxCell + 1 );
+    for( int c=0; c<numCols; c++ )
+    {
+        for( int b=0; b<numBins; b++ )
+        {
+            const auto val = cells[c * numBins + b];
+            if( val == 0 ) continue;
+            const auto frac = m_histogram.logVal ? log10( val + 1 ) / lmax : double( val ) / maxCell;
+            const auto alpha = uint32_t( 0x22 + 0xDD * frac );
+            const auto y = Height - 2 - ( b + 1 ) * ch;
+            draw->AddRectFilled( wpos + ImVec2( 2 + c * cw, y ), wpos + ImVec2( 2 + ( c + 1 ) * cw, y + ch ), ( alpha << 24 ) | 0x22DDDD );
+        }
+    }
+
+    DrawHistogramMinMaxLabel( draw, tStart, tEnd, wpos + ImVec2( 0, Height + 1 ), w, ty );
+
+    if( hover )
+    {
+        const auto c = int( ( ImGui::GetIO().MousePos.x - wpos.x - 2 ) / cw );
+        const auto b = int( ( wpos.y + Height - 2 - ImGui::GetIO().MousePos.y ) / ch );
+        if( c >= 0 && c < numCols && b >= 0 && b < numBins )
+        {
+            const auto t0 = tStart + tRange * c / numCols;
+            const auto t1 = tStart + tRange * ( c + 1 ) / numCols;
+            ImGui::BeginTooltip();
+            TextFocused( "Time:", TimeToString( t0 ) );
+            ImGui::SameLine();
+            TextFocused( "Length:", TimeToString( t1 - t0 ) );
+            TextFocused( "Values:", HistogramBucketRange( minBin + b ) );
+            TextFocused( "Count:", RealToString( cells[c * numBins + b] ) );
+            ImGui::EndTooltip();
+            if( ImGui::IsMouseClicked( 0 ) ) ZoomToRange( t0, t1 );
+        }
+    }
+
+    ImGui::End();
+}
+
+void View::DrawFlows()
+{
+    struct FlowGroup
+    {
+        int16_t srclocOut;
+        int16_t srclocIn;
+        std::vector<int64_t> latency;
+        uint32_t worst;
+    };
+
+    const auto& flows = m_worker.GetFlows();
+
+    ImGui::SetNextWindowSize( ImVec2( 800, 400 ), ImGuiCond_FirstUseEver );
+    ImGui::Begin( "Flows", &m_flows.show );
+    ImGui::Checkbox( "Limit to view", &m_flows.limitRange );
+
+    // Flows are grouped by the source locations of the zones on both ends.
+    unordered_flat_map<uint32_t, FlowGroup> groups;
+    uint64_t incomplete = 0;
+    for( uint32_t i=0; i<flows.size(); i++ )
+    {
+        const auto& flow = flows[i];
+        if( flow.timeOut < 0 || flow.timeIn < 0 )
+        {
+            incomplete++;
+            continue;
+        }
+        if( m_flows.limitRange && ( flow.timeIn < m_vd.zvStart || flow.timeOut > m_vd.zvEnd ) ) continue;
+        const auto key = ( uint32_t( uint16_t( flow.srclocOut ) ) << 16 ) | uint16_t( flow.srclocIn );
+        auto it = groups.find( key );
+        if( it == groups.end() )
+        {
+            it = groups.emplace( key, FlowGroup { flow.srclocOut, flow.srclocIn, {}, i } ).first;
+        }
+        auto& group = it->second;
+        const auto latency = flow.timeIn - flow.timeOut;
+        if( latency > flows[group.worst].timeIn - flows[group.worst].timeOut ) group.worst = i;
+        group.latency.emplace_back( latency );
+    }
+
+    TextFocused( "Flows:", RealToString( flows.size() ) );
+    ImGui::SameLine();
+    ImGui::Spacing();
+    ImGui::SameLine();
+    TextFocused( "Incomplete:", RealToString( incomplete ) );
+    ImGui::Separator();
+
+    std::vector<FlowGroup*> gsort;
+    gsort.reserve( groups.size() );
+    for( auto& v : groups ) gsort.emplace_back( &v.second );
+    pdqsort_branchless( gsort.begin(), gsort.end(), [] ( const auto& l, const auto& r ) { return l->latency.size() > r->latency.size(); } );
+
+    ImGui::BeginChild( "##flows" );
+    ImGui::Columns( 7 );
+    ImGui::TextUnformatted( "Source zone" );
+    ImGui::NextColumn();
+    ImGui::TextUnformatted( "Destination zone" );
+    ImGui::NextColumn();
+    ImGui::TextUnformatted( "Count" );
+    ImGui::NextColumn();
+    ImGui::TextUnformatted( "Min latency" );
+    ImGui::NextColumn();
+    ImGui::TextUnformatted( "Mean latency" );
+    ImGui::NextColumn();
+    ImGui::TextUnformatted( "Median latency" );
+    ImGui::NextColumn();
+    ImGui::TextUnformatted( "Max latency" );
+    ImGui::SameLine();
+    DrawHelpMarker( "Click to zoom to the slowest flow." );
+    ImGui::NextColumn();
+    ImGui::Separator();
+
+    int idx = 0;
+    for( auto& group : gsort )
+    {
+        auto& lat = group->latency;
+        pdqsort_branchless( lat.begin(), lat.end() );
+        int64_t total = 0;
+        for( auto& v : lat ) total += v;
+
+        ImGui::TextUnformatted( m_worker.GetZoneName( m_worker.GetSourceLocation( group->srclocOut ) ) );
+        ImGui::NextColumn();
+        ImGui::TextUnformatted( m_worker.GetZoneName( m_worker.GetSourceLocation( group->srclocIn ) ) );
+        ImGui::NextColumn();
+        ImGui::TextUnformatted( RealToString( lat.size() ) );
+        ImGui::NextColumn();
+        ImGui::TextUnformatted( TimeToString( lat.front() ) );
+        ImGui::NextColumn();
+        ImGui::TextUnformatted( TimeToString( total / int64_t( lat.size() ) ) );
+        ImGui::NextColumn();
+        ImGui::TextUnformatted( TimeToString( lat[lat.size() / 2] ) );
+        ImGui::NextColumn();
+        ImGui::PushID( idx++ );
+        if( ImGui::Selectable( TimeToString( lat.back() ) ) )
+        {
+            const auto& worst = flows[group->worst];
+            ZoomToRange( worst.timeOut, std::max( worst.timeIn, worst.timeOut + 1 ) );
+        }
+        ImGui::PopID();
+        ImGui::NextColumn();
+    }
+    ImGui::EndColumns();
+    ImGui::EndChild();
+    ImGui::End();
+}
+
 void View::DrawSelectedAnnotation()
 {
     assert( m_selectedAnnotation );
@@ -14336,7 +15029,7 @@ void View::ListMemData( std::vector<const MemEvent*>& vec, std::function<void(co
     ImGui::NextColumn();
     ImGui::Separator();
 
-    const auto& mem = m_worker.GetMemData();
+    const auto& mem = m_worker.GetMemData( m_memInfo.pool );
 
     switch( sortBy )
     {
@@ -14365,7 +15058,7 @@ void View::ListMemData( std::vector<const MemEvent*>& vec, std::function<void(co
             auto v = vec[i];
             const auto arrIdx = std::distance( mem.data.begin(), v );
 
-            if( m_memoryAllocInfoWindow == arrIdx )
+            if( m_memoryAllocInfoWindow == arrIdx && m_memoryAllocInfoPool == m_memInfo.pool )
             {
                 ImGui::PushStyleColor( ImGuiCol_Text, ImVec4( 1.f, 0.f, 0.f, 1.f ) );
                 DrawAddress( v );
@@ -14377,6 +15070,7 @@ void View::ListMemData( std::vector<const MemEvent*>& vec, std::function<void(co
                 if( ImGui::IsItemClicked() )
                 {
                     m_memoryAllocInfoWindow = arrIdx;
+                    m_memoryAllocInfoPool = m_memInfo.pool;
                 }
             }
             if( ImGui::IsItemClicked( 2 ) )
@@ -14386,6 +15080,7 @@ void View::ListMemData( std::vector<const MemEvent*>& vec, std::function<void(co
             if( ImGui::IsItemHovered() )
             {
                 m_memoryAllocHover = arrIdx;
+                m_memoryAllocHoverPool = m_memInfo.pool;
                 m_memoryAllocHoverWait = 2;
             }
             ImGui::NextColumn();
@@ -14583,12 +15278,12 @@ unordered_flat_map<uint32_t, View::PathData> View::GetCallstackPaths( const MemD
             auto it = pathSum.find( ev.CsAlloc() );
             if( it == pathSum.end() )
             {
-                pathSum.emplace( ev.CsAlloc(), PathData { 1, ev.Size() } );
+                pathSum.emplace( ev.CsAlloc(), PathData { 1, m_worker.MemWeight( ev.Size() ) } );
             }
             else
             {
                 it->second.cnt++;
-                it->second.mem += ev.Size();
+                it->second.mem += m_worker.MemWeight( ev.Size() );
             }
         }
     }
@@ -14602,12 +15297,12 @@ unordered_flat_map<uint32_t, View::PathData> View::GetCallstackPaths( const MemD
             auto it = pathSum.find( ev.CsAlloc() );
             if( it == pathSum.end() )
             {
-                pathSum.emplace( ev.CsAlloc(), PathData { 1, ev.Size() } );
+                pathSum.emplace( ev.CsAlloc(), PathData { 1, m_worker.MemWeight( ev.Size() ) } );
             }
             else
             {
                 it->second.cnt++;
-                it->second.mem += ev.Size();
+                it->second.mem += m_worker.MemWeight( ev.Size() );
             }
         }
     }
@@ -14824,7 +15519,7 @@ std::vector<MemoryPage> View::GetMemoryPages() const
 
     static unordered_flat_map<uint64_t, MemoryPage> memmap;
 
-    const auto& mem = m_worker.GetMemData();
+    const auto& mem = m_worker.GetMemData( m_memInfo.pool );
     const auto memlow = mem.low;
 
     if( m_memInfo.restrictTime )
@@ -14880,11 +15575,38 @@ std::vector<MemoryPage> View::GetMemoryPages() const
 
 void View::DrawMemory()
 {
-    auto& mem = m_worker.GetMemData();
-
     ImGui::SetNextWindowSize( ImVec2( 1100, 500 ), ImGuiCond_FirstUseEver );
     ImGui::Begin( "Memory", &m_memInfo.show, ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse );
 
+    const auto& pools = m_worker.GetMemNameMap();
+    if( pools.size() > 1 )
+    {
+        auto poolName = [this]( uint64_t name ) { return name == 0 ? "Default" : m_worker.GetString( name ); };
+        ImGui::TextUnformatted( "Memory pool:" );
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth( ImGui::CalcTextSize( "0123456789012345678901234567890" ).x );
+        if( ImGui::BeginCombo( "##memPool", poolName( m_memInfo.pool ) ) )
+        {
+            std::vector<uint64_t> names;
+            names.reserve( pools.size() );
+            for( auto& v : pools ) names.emplace_back( v.first );
+            pdqsort_branchless( names.begin(), names.end(), [&poolName] ( const auto& l, const auto& r ) { return r != 0 && ( l == 0 || strcmp( poolName( l ), poolName( r ) ) < 0 ); } );
+            for( auto& v : names )
+            {
+                if( ImGui::Selectable( poolName( v ), v == m_memInfo.pool ) )
+                {
+                    m_memInfo.pool = v;
+                    m_memInfo.showAllocList = false;
+                    m_memInfo.allocList.clear();
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::Separator();
+    }
+
+    auto& mem = m_worker.GetMemData( m_memInfo.pool );
+
     if( mem.data.empty() )
     {
         ImGui::TextWrapped( "No memory data collected." );
@@ -14911,6 +15633,18 @@ void View::DrawMemory()
     ImGui::Text( "%-15s", MemSizeToString( mem.usage ) );
     ImGui::SameLine();
     TextFocused( "Memory span:", MemSizeToString( mem.high - mem.low ) );
+    if( m_worker.GetMemSamplingInterval() != 0 )
+    {
+        ImGui::SameLine();
+        TextDisabledUnformatted( "(sampled)" );
+        if( ImGui::IsItemHovered() )
+        {
+            ImGui::BeginTooltip();
+            TextFocused( "Sampling interval:", MemSizeToString( m_worker.GetMemSamplingInterval() ) );
+            ImGui::TextUnformatted( "Memory usage and call stack trees are estimated from sampled allocations." );
+            ImGui::EndTooltip();
+        }
+    }
 
     const auto zvMid = m_vd.zvStart + ( m_vd.zvEnd - m_vd.zvStart ) / 2;
 
@@ -14991,7 +15725,7 @@ void View::DrawMemory()
                 if( v.TimeAlloc() < zvMid && ( v.TimeFree() > zvMid || v.TimeFree() < 0 ) )
                 {
                     items.emplace_back( &v );
-                    total += v.Size();
+                    total += m_worker.MemWeight( v.Size() );
                 }
             }
         }
@@ -15097,7 +15831,7 @@ void View::DrawMemory()
         ImGui::SameLine();
         SmallCheckbox( "Only active allocations", &m_activeOnlyBottomUp );
 
-        auto& mem = m_worker.GetMemData();
+        auto& mem = m_worker.GetMemData( m_memInfo.pool );
         auto tree = GetCallstackFrameTreeBottomUp( mem );
 
         if( !tree.empty() )
@@ -15129,7 +15863,7 @@ void View::DrawMemory()
         ImGui::SameLine();
         SmallCheckbox( "Only active allocations", &m_activeOnlyTopDown );
 
-        auto& mem = m_worker.GetMemData();
+        auto& mem = m_worker.GetMemData( m_memInfo.pool );
         auto tree = GetCallstackFrameTreeTopDown( mem );
 
         if( !tree.empty() )
@@ -15194,7 +15928,7 @@ void View::DrawFrameTreeLevel( const unordered_flat_map<uint64_t, CallstackFrame
 
             if( ImGui::IsItemClicked( 1 ) )
             {
-                auto& mem = m_worker.GetMemData().data;
+                auto& mem = m_worker.GetMemData( m_memInfo.pool ).data;
                 const auto sz = mem.size();
                 m_memInfo.showAllocList = true;
                 m_memInfo.allocList.clear();
@@ -15267,7 +16001,7 @@ void View::DrawFrameTreeLevel( const unordered_flat_map<uint64_t, CallstackFrame
 void View::DrawAllocList()
 {
     std::vector<const MemEvent*> data;
-    auto basePtr = m_worker.GetMemData().data.data();
+    auto basePtr = m_worker.GetMemData( m_memInfo.pool ).data.data();
     data.reserve( m_memInfo.allocList.size() );
     for( auto& idx : m_memInfo.allocList )
     {
@@ -15290,7 +16024,7 @@ const char* View::GetPlotName( const PlotData* plot ) const
     case PlotType::User:
         return m_worker.GetString( plot->name );
     case PlotType::Memory:
-        return ICON_FA_MEMORY " Memory usage";
+        return plot->name == 0 ? ICON_FA_MEMORY " Memory usage" : m_worker.GetString( plot->name );
     case PlotType::SysTime:
         return ICON_FA_TACHOMETER_ALT " CPU usage";
     default:
@@ -116,6 +116,14 @@ private:
         uint64_t mem;
     };
 
+    struct FlowDraw
+    {
+        float yOut;
+        float yIn;
+        bool hasOut = false;
+        bool hasIn = false;
+    };
+
     void InitTextEditor( ImFont* font );
 
     const char* ShortenNamespace( const char* name ) const;
@@ -148,8 +156,9 @@ private:
     int SkipGpuZoneLevel( const V& vec, bool hover, double pxns, int64_t nspx, const ImVec2& wpos, int offset, int depth, uint64_t thread, float yMin, float yMax, int64_t begin, int drift );
     void DrawLockHeader( uint32_t id, const LockMap& lockmap, const SourceLocation& srcloc, bool hover, ImDrawList* draw, const ImVec2& wpos, float w, float ty, float offset, uint8_t tid );
     int DrawLocks( uint64_t tid, bool hover, double pxns, const ImVec2& wpos, int offset, LockHighlight& highlight, float yMin, float yMax );
+    int DrawWaits( uint64_t tid, bool hover, double pxns, const ImVec2& wpos, int offset, WaitHighlight& highlight, float yMin, float yMax );
     int DrawPlots( int offset, double pxns, const ImVec2& wpos, bool hover, float yMin, float yMax );
-    void DrawPlotPoint( const ImVec2& wpos, float x, float y, int offset, uint32_t color, bool hover, bool hasPrev, const PlotItem* item, double prev, bool merged, PlotType type, PlotValueFormatting format, float PlotHeight );
+    void DrawPlotPoint( const ImVec2& wpos, float x, float y, int offset, uint32_t color, bool hover, bool hasPrev, const PlotItem* item, double prev, bool merged, PlotType type, uint64_t name, PlotValueFormatting format, float PlotHeight );
     void DrawPlotPoint( const ImVec2& wpos, float x, float y, int offset, uint32_t color, bool hover, bool hasPrev, double val, double prev, bool merged, PlotValueFormatting format, float PlotHeight );
     int DrawCpuData( int offset, double pxns, const ImVec2& wpos, bool hover, float yMin, float yMax );
     void DrawOptions();
@@ -166,6 +175,8 @@ private:
     void DrawLockInfoWindow();
     void DrawPlayback();
     void DrawCpuDataWindow();
+    void DrawHistograms();
+    void DrawFlows();
     void DrawSelectedAnnotation();
     void DrawAnnotationList();
     void DrawSampleParents();
@@ -261,6 +272,7 @@ private:
     unordered_flat_map<uint64_t, bool> m_visibleMsgThread;
     unordered_flat_map<const void*, int> m_gpuDrift;
     unordered_flat_map<const PlotData*, PlotView> m_plotView;
+    unordered_flat_map<uint32_t, FlowDraw> m_flowDraw;
     Vector<const ThreadData*> m_threadOrder;
     Vector<float> m_threadDnd;
 
@@ -308,6 +320,7 @@ private:
     const ZoneEvent* m_zoneHighlight;
     DecayValue<int16_t> m_zoneSrcLocHighlight = 0;
     LockHighlight m_lockHighlight { -1 };
+    WaitHighlight m_waitHighlight { -1 };
     DecayValue<const MessageData*> m_msgHighlight = nullptr;
     DecayValue<uint32_t> m_lockHoverHighlight = InvalidId;
     DecayValue<const MessageData*> m_msgToFocus = nullptr;
@@ -316,7 +329,9 @@ private:
     uint64_t m_gpuInfoWindowThread;
     uint32_t m_callstackInfoWindow = 0;
     int64_t m_memoryAllocInfoWindow = -1;
+    uint64_t m_memoryAllocInfoPool = 0;
     int64_t m_memoryAllocHover = -1;
+    uint64_t m_memoryAllocHoverPool = 0;
     int m_memoryAllocHoverWait = 0;
     const FrameData* m_frames;
     uint32_t m_lockInfoWindow = InvalidId;
@@ -619,6 +634,7 @@ private:
         bool restrictTime = false;
         bool showAllocList = false;
         std::vector<size_t> allocList;
+        uint64_t pool = 0;
     } m_memInfo;
 
     struct {
@@ -656,6 +672,18 @@ private:
         bool zoom = false;
     } m_playback;
 
+    struct {
+        bool show = false;
+        size_t selected = 0;
+        bool limitRange = false;
+        bool logVal = false;
+    } m_histogram;
+
+    struct {
+        bool show = false;
+        bool limitRange = false;
+    } m_flows;
+
     struct TimeDistribution {
         enum class SortBy : int { Count, Time, Mtpc };
         SortBy sortBy = SortBy::Time;
@@ -29,6 +29,7 @@ struct ViewData
     uint8_t drawSamples = true;
     uint8_t dynamicColors = 1;
     uint8_t ghostZones = true;
+    uint8_t drawFlows = true;
 };
 
 struct Annotation
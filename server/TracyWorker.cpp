@@ -10,6 +10,7 @@
 
 #include <cctype>
 #include <chrono>
+#include <math.h>
 #include <string.h>
 
 #ifdef __MINGW32__
@@ -56,6 +57,10 @@ static bool SourceFileValid( const char* fn, uint64_t olderThan )
 
 
 static const uint8_t FileHeader[8] { 't', 'r', 'a', 'c', 'y', Version::Major, Version::Minor, Version::Patch };
+// Recorded event stream. Followed by the protocol version, the welcome message, the on-demand
+// payload (if the client is on-demand) and network frames, each prefixed with its size. A zero
+// size ends the stream.
+static const uint8_t StreamHeader[8] { 't', 'r', 'a', 'c', 'y', 'n', 'e', 't' };
 enum { FileHeaderMagic = 5 };
 static const int CurrentVersion = FileVersion( Version::Major, Version::Minor, Version::Patch );
 static const int MinSupportedVersion = FileVersion( 0, 5, 0 );
@@ -234,7 +239,7 @@ static tracy_force_inline void UpdateLockRange( LockMap& lockmap, const LockEven
 
 LoadProgress Worker::s_loadProgress;
 
-Worker::Worker( const char* addr, int port )
+Worker::Worker( const char* addr, int port, FileWrite* recording )
     : m_addr( addr )
     , m_port( port )
     , m_hasData( false )
@@ -266,10 +271,129 @@ Worker::Worker( const char* addr, int port )
     m_data.ctxUsageReady = true;
 #endif
 
+    m_recording = recording;
     m_thread = std::thread( [this] { SetThreadName( "Tracy Worker" ); Exec(); } );
     m_threadNet = std::thread( [this] { SetThreadName( "Tracy Network" ); Network(); } );
 }
 
+Worker::Worker( FileRead& stream, ReplayStats& stats, ReplayAnswers* answers )
+    : m_port( 0 )
+    , m_hasData( false )
+    , m_stream( nullptr )
+    , m_buffer( new char[TargetFrameSize] )
+    , m_bufferOffset( 0 )
+    , m_pendingStrings( 0 )
+    , m_pendingThreads( 0 )
+    , m_pendingExternalNames( 0 )
+    , m_pendingSourceLocation( 0 )
+    , m_pendingCallstackFrames( 0 )
+    , m_pendingCallstackSubframes( 0 )
+    , m_pendingCodeInformation( 0 )
+    , m_callstackFrameStaging( nullptr )
+    , m_traceVersion( CurrentVersion )
+    , m_loadTime( 0 )
+{
+    m_data.sourceLocationExpand.push_back( 0 );
+    m_data.localThreadCompress.InitZero();
+    m_data.callstackPayload.push_back( nullptr );
+    m_data.zoneExtra.push_back( ZoneExtra {} );
+
+    memset( m_gpuCtxMap, 0, sizeof( m_gpuCtxMap ) );
+
+#ifndef TRACY_NO_STATISTICS
+    m_data.sourceLocationZonesReady = true;
+    m_data.callstackSamplesReady = true;
+    m_data.ghostZonesReady = true;
+    m_data.ctxUsageReady = true;
+#endif
+
+    uint8_t hdr[sizeof( StreamHeader )];
+    stream.Read( hdr, sizeof( hdr ) );
+    if( memcmp( hdr, StreamHeader, sizeof( hdr ) ) != 0 ) throw NotTracyDump();
+    uint32_t protocolVersion;
+    stream.Read( protocolVersion );
+    if( protocolVersion != ProtocolVersion ) throw UnsupportedVersion( protocolVersion );
+
+    WelcomeMessage welcome;
+    stream.Read( welcome );
+    HandleWelcome( welcome );
+    if( welcome.onDemand != 0 )
+    {
+        OnDemandPayloadMessage onDemand;
+        stream.Read( onDemand );
+        HandleOnDemandPayload( onDemand );
+    }
+    m_replay = true;
+    m_replayAnswers = answers;
+    m_hasData.store( true, std::memory_order_release );
+
+    // Reading the stream is not a part of the processing time.
+    std::vector<char> answer;
+    bool done = false;
+    while( !done )
+    {
+        const char* ptr;
+        const char* end;
+        if( !m_serverQueryQueue.empty() )
+        {
+            // Answers may make further queries, which are handled in the next iteration.
+            answer.clear();
+            for( auto& v : m_serverQueryQueue ) m_replayAnswers->Answer( v, answer );
+            m_serverQueryQueue.clear();
+            if( answer.empty() ) continue;
+            ptr = answer.data();
+            end = ptr + answer.size();
+        }
+        else
+        {
+            uint32_t sz;
+            stream.Read( sz );
+            if( sz == 0 )
+            {
+                done = true;
+                continue;
+            }
+            if( sz > TargetFrameSize ) throw NotTracyDump();
+            stream.Read( m_buffer, sz );
+            stats.bytes += sz;
+            ptr = m_buffer;
+            end = ptr + sz;
+        }
+
+        const auto t0 = std::chrono::high_resolution_clock::now();
+
+        if( stats.timing )
+        {
+            while( ptr < end )
+            {
+                auto ev = (const QueueItem*)ptr;
+                const auto idx = ev->hdr.idx;
+                const auto te0 = std::chrono::high_resolution_clock::now();
+                const auto ok = DispatchProcess( *ev, ptr );
+                const auto te1 = std::chrono::high_resolution_clock::now();
+                stats.typeTime[idx] += std::chrono::duration_cast<std::chrono::nanoseconds>( te1 - te0 ).count();
+                stats.typeCount[idx]++;
+                stats.events++;
+                if( !ok ) break;
+            }
+        }
+        else
+        {
+            while( ptr < end )
+            {
+                auto ev = (const QueueItem*)ptr;
+                stats.events++;
+                if( !DispatchProcess( *ev, ptr ) ) break;
+            }
+        }
+        if( m_failure == Failure::None ) HandleFrameEnd();
+        const auto t1 = std::chrono::high_resolution_clock::now();
+        stats.time += std::chrono::duration_cast<std::chrono::nanoseconds>( t1 - t0 ).count();
+        if( memUsage > stats.memPeak ) stats.memPeak = memUsage;
+        if( m_failure != Failure::None ) break;
+    }
+}
+
 Worker::Worker( const std::string& program, const std::vector<ImportEventTimeline>& timeline, const std::vector<ImportEventMessages>& messages )
     : m_hasData( true )
     , m_delay( 0 )
@@ -467,6 +591,10 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
     {
         m_samplingPeriod = 0;
     }
+    if( fileVer >= FileVersion( 0, 6, 16 ) )
+    {
+        f.Read( m_memSamplingInterval );
+    }
     if( fileVer >= FileVersion( 0, 6, 7 ) )
     {
         f.Read( m_data.cpuArch );
@@ -784,6 +912,10 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
                 lockmap.timeTerminate -= m_data.baseTime;
                 if( lockmap.timeTerminate < lockmap.timeAnnounce ) lockmap.timeTerminate = 0;
             }
+            if( fileVer >= FileVersion( 0, 6, 18 ) )
+            {
+                f.Read( lockmap.uncontended );
+            }
             f.Read( tsz );
             lockmap.threadMap.reserve( tsz );
             lockmap.threadList.reserve( tsz );
@@ -889,6 +1021,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
             }
             f.Read( type );
             f.Skip( sizeof( LockMap::valid ) + sizeof( LockMap::timeAnnounce ) + sizeof( LockMap::timeTerminate ) );
+            if( fileVer >= FileVersion( 0, 6, 18 ) ) f.Skip( sizeof( LockMap::uncontended ) );
             f.Read( tsz );
             f.Skip( tsz * sizeof( uint64_t ) );
             f.Read( tsz );
@@ -967,13 +1100,27 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
         }
     }
 
-    if( fileVer >= FileVersion( 0, 6, 3 ) )
+    if( fileVer >= FileVersion( 0, 6, 20 ) )
     {
         f.Read( sz );
         assert( sz != 0 );
         m_data.zoneExtra.reserve_exact( sz, m_slab );
         f.Read( m_data.zoneExtra.data(), sz * sizeof( ZoneExtra ) );
     }
+    else if( fileVer >= FileVersion( 0, 6, 3 ) )
+    {
+        f.Read( sz );
+        assert( sz != 0 );
+        m_data.zoneExtra.reserve_exact( sz, m_slab );
+        auto extra = m_data.zoneExtra.data();
+        for( uint64_t i=0; i<sz; i++ )
+        {
+            f.Read3( extra->callstack, extra->text, extra->name );
+            extra->flowOut = 0;
+            extra->flowIn = 0;
+            extra++;
+        }
+    }
     else
     {
         m_data.zoneExtra.push_back( ZoneExtra {} );
@@ -1199,6 +1346,9 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
                     f.Read( pd->data[j].val );
                 }
             }
+            // Client self-overhead plots were briefly stored with a dedicated plot type
+            // and a stat index in place of the name. They are now regular user plots.
+            if( fileVer >= FileVersion( 0, 6, 21 ) && (uint8_t)pd->type == 3 ) continue;
             m_data.plots.Data().push_back_no_space_check( pd );
         }
     }
@@ -1238,34 +1388,7 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
         int64_t refTime = 0;
         if( fileVer >= FileVersion( 0, 5, 9 ) )
         {
-            auto& frees = m_data.memory.frees;
-            auto& active = m_data.memory.active;
-
-            for( uint64_t i=0; i<sz; i++ )
-            {
-                s_loadProgress.subProgress.store( i, std::memory_order_relaxed );
-                uint64_t ptr, size;
-                Int24 csAlloc;
-                int64_t timeAlloc, timeFree;
-                uint16_t threadAlloc, threadFree;
-                f.Read8( ptr, size, csAlloc, mem->csFree, timeAlloc, timeFree, threadAlloc, threadFree );
-                mem->SetPtr( ptr );
-                mem->SetSize( size );
-                mem->SetCsAlloc( csAlloc.Val() );
-                refTime += timeAlloc;
-                mem->SetTimeThreadAlloc( refTime, threadAlloc );
-                if( timeFree >= 0 )
-                {
-                    mem->SetTimeThreadFree( timeFree + refTime, threadFree );
-                    frees[fidx++] = i;
-                }
-                else
-                {
-                    mem->SetTimeThreadFree( timeFree, threadFree );
-                    active.emplace( ptr, i );
-                }
-                mem++;
-            }
+            ReadMemEvents( f, m_data.memory, sz );
         }
         else if( fileVer >= FileVersion( 0, 5, 2 ) )
         {
@@ -1887,6 +2010,132 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
         }
     }
 
+    if( fileVer >= FileVersion( 0, 6, 15 ) )
+    {
+        f.Read( sz );
+        m_data.captureGaps.reserve_exact( sz, m_slab );
+        f.Read( m_data.captureGaps.data(), sizeof( CaptureGap ) * sz );
+    }
+
+    if( fileVer >= FileVersion( 0, 6, 17 ) )
+    {
+        f.Read( sz );
+        for( uint64_t i=0; i<sz; i++ )
+        {
+            uint64_t name, memsz;
+            f.Read2( name, memsz );
+            if( eventMask & EventType::Memory )
+            {
+                auto mem = m_slab.AllocInit<MemData>();
+                mem->name = name;
+                m_data.memNameMap.emplace( name, mem );
+
+                mem->data.reserve_exact( memsz, m_slab );
+                uint64_t activeSz, freesSz;
+                f.Read2( activeSz, freesSz );
+                mem->active.reserve( activeSz );
+                mem->frees.reserve_exact( freesSz, m_slab );
+                ReadMemEvents( f, *mem, memsz );
+                f.Read3( mem->high, mem->low, mem->usage );
+
+                if( memsz != 0 ) reconstructMemAllocPlot = true;
+            }
+            else
+            {
+                f.Skip( 2 * sizeof( uint64_t ) );
+                f.Skip( memsz * ( sizeof( uint64_t ) + sizeof( uint64_t ) + sizeof( Int24 ) + sizeof( Int24 ) + sizeof( int64_t ) * 2 + sizeof( uint16_t ) * 2 ) );
+                f.Skip( sizeof( MemData::high ) + sizeof( MemData::low ) + sizeof( MemData::usage ) );
+            }
+        }
+    }
+
+    if( fileVer >= FileVersion( 0, 6, 19 ) )
+    {
+        f.Read( sz );
+        if( eventMask & EventType::Plots )
+        {
+            m_data.histograms.reserve_exact( sz, m_slab );
+            for( uint64_t i=0; i<sz; i++ )
+            {
+                auto hist = m_slab.AllocInit<HistogramData>();
+                uint64_t isz, esz;
+                f.Read3( hist->name, isz, esz );
+                hist->intervals.reserve_exact( isz, m_slab );
+                f.Read( hist->intervals.data(), sizeof( HistogramInterval ) * isz );
+                hist->entries.reserve_exact( esz, m_slab );
+                f.Read( hist->entries.data(), sizeof( uint64_t ) * esz );
+                m_data.histograms[i] = hist;
+            }
+        }
+        else
+        {
+            for( uint64_t i=0; i<sz; i++ )
+            {
+                uint64_t isz, esz;
+                f.Skip( sizeof( HistogramData::name ) );
+                f.Read2( isz, esz );
+                f.Skip( sizeof( HistogramInterval ) * isz + sizeof( uint64_t ) * esz );
+            }
+        }
+    }
+
+    if( fileVer >= FileVersion( 0, 6, 20 ) )
+    {
+        f.Read( sz );
+        m_data.flows.reserve_exact( sz, m_slab );
+        f.Read( m_data.flows.data(), sizeof( FlowData ) * sz );
+    }
+
+    if( fileVer >= FileVersion( 0, 6, 23 ) )
+    {
+        f.Read( sz );
+        for( uint64_t i=0; i<sz; i++ )
+        {
+            uint32_t id;
+            uint64_t tsz;
+            auto wm = ( eventMask & EventType::Locks ) ? m_slab.AllocInit<WaitMap>() : nullptr;
+            if( wm )
+            {
+                f.Read( id );
+                f.Read5( wm->srcloc, wm->type, wm->valid, wm->timeAnnounce, wm->timeTerminate );
+            }
+            else
+            {
+                f.Skip( sizeof( id ) + sizeof( WaitMap::srcloc ) + sizeof( WaitMap::type ) + sizeof( WaitMap::valid ) + sizeof( WaitMap::timeAnnounce ) + sizeof( WaitMap::timeTerminate ) );
+            }
+            f.Read( tsz );
+            for( uint64_t j=0; j<tsz; j++ )
+            {
+                uint64_t thread, wsz, nsz;
+                f.Read2( thread, wsz );
+                if( wm )
+                {
+                    auto& td = wm->threadData[thread];
+                    td.waits.reserve_exact( wsz, m_slab );
+                    for( uint64_t k=0; k<wsz; k++ )
+                    {
+                        auto& wait = td.waits[k];
+                        f.Read5( wait.start, wait.end, wait.notify, wait.waker, wait.timeout );
+                    }
+                    f.Read( nsz );
+                    td.notifies.reserve_exact( nsz, m_slab );
+                    for( uint64_t k=0; k<nsz; k++ )
+                    {
+                        auto& notify = td.notifies[k];
+                        f.Read2( notify.time, notify.count );
+                    }
+                }
+                else
+                {
+                    f.Skip( wsz * ( sizeof( WaitEvent::start ) + sizeof( WaitEvent::end ) + sizeof( WaitEvent::notify ) + sizeof( WaitEvent::waker ) + sizeof( WaitEvent::timeout ) ) );
+                    f.Read( nsz );
+                    f.Skip( nsz * ( sizeof( WaitNotify::time ) + sizeof( WaitNotify::count ) ) );
+                }
+            }
+            if( wm ) m_data.waitMap.emplace( id, wm );
+        }
+    }
+
     s_loadProgress.total.store( 0, std::memory_order_relaxed );
     m_loadTime = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::high_resolution_clock::now() - loadStart ).count();
 
@@ -1908,7 +2157,12 @@ Worker::Worker( FileRead& f, EventType::Type eventMask, bool bgTasks )
 
             if( reconstructMemAllocPlot )
             {
-                jobs.emplace_back( std::thread( [this] { ReconstructMemAllocPlot(); } ) );
+                for( auto& v : m_data.memNameMap )
+                {
+                    auto mem = v.second;
+                    if( mem->data.empty() ) continue;
+                    jobs.emplace_back( std::thread( [this, mem] { ReconstructMemAllocPlot( *mem ); } ) );
+                }
             }
 
             std::function<void(Vector<short_ptr<ZoneEvent>>&, uint16_t)> ProcessTimeline;
@@ -2128,6 +2382,7 @@ Worker::~Worker()
 
     delete[] m_buffer;
     LZ4_freeStreamDecode( (LZ4_streamDecode_t*)m_stream );
+    ZSTD_freeDStream( (ZSTD_DStream*)m_zstdStream );
 
     delete[] m_frameImageBuffer;
     delete[] m_tmpBuf;
@@ -2156,6 +2411,10 @@ Worker::~Worker()
     {
         v->~PlotData();
     }
+    for( auto& v : m_data.histograms )
+    {
+        v->~HistogramData();
+    }
     for( auto& v : m_data.frames.Data() )
     {
         v->~FrameData();
@@ -2164,6 +2423,10 @@ Worker::~Worker()
     {
         v.second->~LockMap();
     }
+    for( auto& v : m_data.waitMap )
+    {
+        v.second->~WaitMap();
+    }
     for( auto& v : m_data.zoneChildren )
     {
         v.~Vector();
@@ -2194,6 +2457,19 @@ uint64_t Worker::GetLockCount() const
     return cnt;
 }
 
+uint64_t Worker::GetWaitCount() const
+{
+    uint64_t cnt = 0;
+    for( auto& w : m_data.waitMap )
+    {
+        for( auto& td : w.second->threadData )
+        {
+            cnt += td.second.waits.size() + td.second.notifies.size();
+        }
+    }
+    return cnt;
+}
+
 uint64_t Worker::GetPlotCount() const
 {
     uint64_t cnt = 0;
@@ -2574,6 +2850,13 @@ uint32_t Worker::FindStringIdx( const char* str ) const
     }
 }
 
+const MemData& Worker::GetMemData( uint64_t name ) const
+{
+    auto it = m_data.memNameMap.find( name );
+    if( it == m_data.memNameMap.end() ) return m_data.memory;
+    return *it->second;
+}
+
 const char* Worker::GetString( uint64_t ptr ) const
 {
     const auto it = m_data.strings.find( ptr );
@@ -2851,7 +3134,7 @@ const unordered_flat_map<CallstackFrameId, uint32_t, Worker::CallstackFrameIdHas
 void Worker::Network()
 {
     auto ShouldExit = [this] { return m_shutdown.load( std::memory_order_relaxed ); };
-    auto lz4buf = std::make_unique<char[]>( LZ4Size );
+    auto lz4buf = std::make_unique<char[]>( NetFrameMaxSize );
 
     for(;;)
     {
@@ -2865,12 +3148,33 @@ void Worker::Network()
         auto buf = m_buffer + m_bufferOffset;
         lz4sz_t lz4sz;
         if( !m_sock.Read( &lz4sz, sizeof( lz4sz ), 10, ShouldExit ) ) goto close;
+        if( lz4sz > NetFrameMaxSize ) goto close;
         if( !m_sock.Read( lz4buf.get(), lz4sz, 10, ShouldExit ) ) goto close;
         auto bb = m_bytes.load( std::memory_order_relaxed );
         m_bytes.store( bb + sizeof( lz4sz ) + lz4sz, std::memory_order_relaxed );
 
-        auto sz = LZ4_decompress_safe_continue( (LZ4_streamDecode_t*)m_stream, lz4buf.get(), buf, lz4sz, TargetFrameSize );
-        assert( sz >= 0 );
+        int sz;
+        if( m_netCodec == NetworkCodecZstd )
+        {
+            ZSTD_inBuffer in = { lz4buf.get(), lz4sz, 0 };
+            ZSTD_outBuffer out = { buf, TargetFrameSize, 0 };
+            while( in.pos < in.size )
+            {
+                // Frames never decompress to more than TargetFrameSize. Input which is left once the
+                // output is full, or which can't be consumed, means the stream is damaged.
+                if( out.pos == out.size ) goto close;
+                const auto inPos = in.pos;
+                const auto outPos = out.pos;
+                if( ZSTD_isError( ZSTD_decompressStream( (ZSTD_DStream*)m_zstdStream, &out, &in ) ) ) goto close;
+                if( in.pos == inPos && out.pos == outPos ) goto close;
+            }
+            sz = int( out.pos );
+        }
+        else
+        {
+            sz = LZ4_decompress_safe_continue( (LZ4_streamDecode_t*)m_stream, lz4buf.get(), buf, lz4sz, TargetFrameSize );
+            assert( sz >= 0 );
+        }
         bb = m_decBytes.load( std::memory_order_relaxed );
         m_decBytes.store( bb + sz, std::memory_order_relaxed );
 
@@ -2906,6 +3210,8 @@ void Worker::Exec()
     m_sock.Send( HandshakeShibboleth, HandshakeShibbolethSize );
     uint32_t protocolVersion = ProtocolVersion;
     m_sock.Send( &protocolVersion, sizeof( protocolVersion ) );
+    const uint8_t codecs = ( 1 << NetworkCodecLz4 ) | ( 1 << NetworkCodecZstd );
+    m_sock.Send( &codecs, sizeof( codecs ) );
     HandshakeStatus handshake;
     if( !m_sock.Read( &handshake, sizeof( handshake ), 10, ShouldExit ) )
     {
@@ -2923,17 +3229,6 @@ void Worker::Exec()
         goto close;
     }
 
-    m_data.framesBase = m_data.frames.Retrieve( 0, [this] ( uint64_t name ) {
-        auto fd = m_slab.AllocInit<FrameData>();
-        fd->name = name;
-        fd->continuous = 1;
-        return fd;
-    }, [this] ( uint64_t name ) {
-        assert( name == 0 );
-        char tmp[6] = "Frame";
-        HandleFrameName( name, tmp, 5 );
-    } );
-
     {
         WelcomeMessage welcome;
         if( !m_sock.Read( &welcome, sizeof( welcome ), 10, ShouldExit ) )
@@ -2941,45 +3236,27 @@ void Worker::Exec()
             m_handshake.store( HandshakeDropped, std::memory_order_relaxed );
             goto close;
         }
-        m_timerMul = welcome.timerMul;
-        m_data.baseTime = welcome.initBegin;
-        const auto initEnd = TscTime( welcome.initEnd - m_data.baseTime );
-        m_data.framesBase->frames.push_back( FrameEvent{ 0, -1, -1 } );
-        m_data.framesBase->frames.push_back( FrameEvent{ initEnd, -1, -1 } );
-        m_data.lastTime = initEnd;
-        m_delay = TscTime( welcome.delay );
-        m_resolution = TscTime( welcome.resolution );
-        m_pid = welcome.pid;
-        m_samplingPeriod = welcome.samplingPeriod;
-        m_onDemand = welcome.onDemand;
-        m_captureProgram = welcome.programName;
-        m_captureTime = welcome.epoch;
-        m_ignoreMemFreeFaults = welcome.onDemand || welcome.isApple;
-        m_data.cpuArch = (CpuArchitecture)welcome.cpuArch;
-        m_data.cpuId = welcome.cpuId;
-        memcpy( m_data.cpuManufacturer, welcome.cpuManufacturer, 12 );
-        m_data.cpuManufacturer[12] = '\0';
-
-        char dtmp[64];
-        time_t date = welcome.epoch;
-        auto lt = localtime( &date );
-        strftime( dtmp, 64, "%F %T", lt );
-        char tmp[1024];
-        sprintf( tmp, "%s @ %s", welcome.programName, dtmp );
-        m_captureName = tmp;
-
-        m_hostInfo = welcome.hostInfo;
+        if( welcome.codec > NetworkCodecZstd )
+        {
+            m_handshake.store( HandshakeDropped, std::memory_order_relaxed );
+            goto close;
+        }
+        HandleWelcome( welcome );
 
+        OnDemandPayloadMessage onDemand;
         if( welcome.onDemand != 0 )
         {
-            OnDemandPayloadMessage onDemand;
             if( !m_sock.Read( &onDemand, sizeof( onDemand ), 10, ShouldExit ) )
             {
                 m_handshake.store( HandshakeDropped, std::memory_order_relaxed );
                 goto close;
             }
-            m_data.frameOffset = onDemand.frames;
-            m_data.framesBase->frames.push_back( FrameEvent{ TscTime( onDemand.currentTime - m_data.baseTime ), -1, -1 } );
+            HandleOnDemandPayload( onDemand );
+        }
+
+        if( m_recording )
+        {
+            WriteStreamHeader( *m_recording, protocolVersion, welcome, welcome.onDemand != 0 ? &onDemand : nullptr );
         }
     }
 
@@ -2987,6 +3264,7 @@ void Worker::Exec()
     m_hasData.store( true, std::memory_order_release );
 
     LZ4_setStreamDecode( (LZ4_streamDecode_t*)m_stream, nullptr, 0 );
+    if( m_netCodec == NetworkCodecZstd ) m_zstdStream = ZSTD_createDStream();
     m_connected.store( true, std::memory_order_relaxed );
     {
         std::lock_guard<std::mutex> lock( m_netWriteLock );
@@ -3016,6 +3294,13 @@ void Worker::Exec()
         const char* ptr = m_buffer + netbuf.bufferOffset;
         const char* end = ptr + netbuf.size;
 
+        if( m_recording )
+        {
+            const uint32_t sz = netbuf.size;
+            m_recording->Write( &sz, sizeof( sz ) );
+            m_recording->Write( ptr, sz );
+        }
+
         {
             std::lock_guard<std::shared_mutex> lock( m_data.lock );
             while( ptr < end )
@@ -3035,29 +3320,7 @@ void Worker::Exec()
                 m_netWriteCv.notify_one();
             }
 
-            HandlePostponedPlots();
-#ifndef TRACY_NO_STATISTICS
-            HandlePostponedSamples();
-            m_data.newFramesWereReceived = false;
-#endif
-            if( m_data.newSymbolsWereAdded )
-            {
-                m_data.newSymbolsWereAdded = false;
-#ifdef NO_PARALLEL_SORT
-                pdqsort_branchless( m_data.symbolLoc.begin(), m_data.symbolLoc.end(), [] ( const auto& l, const auto& r ) { return l.addr < r.addr; } );
-#else
-                std::sort( std::execution::par_unseq, m_data.symbolLoc.begin(), m_data.symbolLoc.end(), [] ( const auto& l, const auto& r ) { return l.addr < r.addr; } );
-#endif
-            }
-            if( m_data.newInlineSymbolsWereAdded )
-            {
-                m_data.newInlineSymbolsWereAdded = false;
-#ifdef NO_PARALLEL_SORT
-                pdqsort_branchless( m_data.symbolLocInline.begin(), m_data.symbolLocInline.end() );
-#else
-                std::sort( std::execution::par_unseq, m_data.symbolLocInline.begin(), m_data.symbolLocInline.end() );
-#endif
-            }
+            HandleFrameEnd();
 
             if( !m_serverQueryQueue.empty() && m_serverQuerySpaceLeft > 0 )
             {
@@ -3089,7 +3352,7 @@ void Worker::Exec()
             if( m_pendingStrings != 0 || m_pendingThreads != 0 || m_pendingSourceLocation != 0 || m_pendingCallstackFrames != 0 ||
                 !m_pendingCustomStrings.empty() || m_data.plots.IsPending() || m_pendingCallstackPtr != 0 ||
                 m_pendingExternalNames != 0 || m_pendingCallstackSubframes != 0 || m_pendingFrameImageData.image != nullptr ||
-                !m_pendingSymbols.empty() || !m_pendingSymbolCode.empty() || m_pendingCodeInformation != 0 ||
+                !m_pendingHistogramData.empty() || !m_pendingSymbols.empty() || !m_pendingSymbolCode.empty() || m_pendingCodeInformation != 0 ||
                 !m_serverQueryQueue.empty() || m_pendingSourceLocationPayload != 0 )
             {
                 continue;
@@ -3114,12 +3377,96 @@ void Worker::Exec()
     }
 
 close:
+    if( m_recording && m_hasData.load( std::memory_order_relaxed ) )
+    {
+        const uint32_t end = 0;
+        m_recording->Write( &end, sizeof( end ) );
+    }
     Shutdown();
     m_netWriteCv.notify_one();
     m_sock.Close();
     m_connected.store( false, std::memory_order_relaxed );
 }
 
+void Worker::HandleWelcome( const WelcomeMessage& welcome )
+{
+    m_data.framesBase = m_data.frames.Retrieve( 0, [this] ( uint64_t name ) {
+        auto fd = m_slab.AllocInit<FrameData>();
+        fd->name = name;
+        fd->continuous = 1;
+        return fd;
+    }, [this] ( uint64_t name ) {
+        assert( name == 0 );
+        char tmp[6] = "Frame";
+        HandleFrameName( name, tmp, 5 );
+    } );
+
+    m_netCodec = (NetworkCodec)welcome.codec;
+    m_timerMul = welcome.timerMul;
+    m_data.baseTime = welcome.initBegin;
+    const auto initEnd = TscTime( welcome.initEnd - m_data.baseTime );
+    m_data.framesBase->frames.push_back( FrameEvent{ 0, -1, -1 } );
+    m_data.framesBase->frames.push_back( FrameEvent{ initEnd, -1, -1 } );
+    m_data.lastTime = initEnd;
+    m_delay = TscTime( welcome.delay );
+    m_resolution = TscTime( welcome.resolution );
+    m_pid = welcome.pid;
+    m_samplingPeriod = welcome.samplingPeriod;
+    m_memSamplingInterval = welcome.memSamplingInterval;
+    m_onDemand = welcome.onDemand;
+    m_captureProgram = welcome.programName;
+    m_captureTime = welcome.epoch;
+    m_ignoreMemFreeFaults = welcome.onDemand || welcome.isApple;
+    m_data.cpuArch = (CpuArchitecture)welcome.cpuArch;
+    m_data.cpuId = welcome.cpuId;
+    memcpy( m_data.cpuManufacturer, welcome.cpuManufacturer, 12 );
+    m_data.cpuManufacturer[12] = '\0';
+
+    char dtmp[64];
+    time_t date = welcome.epoch;
+    auto lt = localtime( &date );
+    strftime( dtmp, 64, "%F %T", lt );
+    char tmp[1024];
+    sprintf( tmp, "%s @ %s", welcome.programName, dtmp );
+    m_captureName = tmp;
+
+    m_hostInfo = welcome.hostInfo;
+}
+
+void Worker::HandleOnDemandPayload( const OnDemandPayloadMessage& onDemand )
+{
+    m_data.frameOffset = onDemand.frames;
+    m_data.framesBase->frames.push_back( FrameEvent{ TscTime( onDemand.currentTime - m_data.baseTime ), -1, -1 } );
+}
+
+// Work which is done after each network frame is processed.
+void Worker::HandleFrameEnd()
+{
+    HandlePostponedPlots();
+#ifndef TRACY_NO_STATISTICS
+    HandlePostponedSamples();
+    m_data.newFramesWereReceived = false;
+#endif
+    if( m_data.newSymbolsWereAdded )
+    {
+        m_data.newSymbolsWereAdded = false;
+#ifdef NO_PARALLEL_SORT
+        pdqsort_branchless( m_data.symbolLoc.begin(), m_data.symbolLoc.end(), [] ( const auto& l, const auto& r ) { return l.addr < r.addr; } );
+#else
+        std::sort( std::execution::par_unseq, m_data.symbolLoc.begin(), m_data.symbolLoc.end(), [] ( const auto& l, const auto& r ) { return l.addr < r.addr; } );
+#endif
+    }
+    if( m_data.newInlineSymbolsWereAdded )
+    {
+        m_data.newInlineSymbolsWereAdded = false;
+#ifdef NO_PARALLEL_SORT
+        pdqsort_branchless( m_data.symbolLocInline.begin(), m_data.symbolLocInline.end() );
+#else
+        std::sort( std::execution::par_unseq, m_data.symbolLocInline.begin(), m_data.symbolLocInline.end() );
+#endif
+    }
+}
+
 void Worker::UpdateMbps( int64_t td )
 {
     const auto bytes = m_bytes.exchange( 0, std::memory_order_relaxed );
@@ -3211,7 +3558,8 @@ void Worker::DispatchFailure( const QueueItem& ev, const char*& ptr )
     {
         ptr += sizeof( QueueHeader ) + sizeof( QueueStringTransfer );
         if( ev.hdr.type == QueueType::FrameImageData ||
-            ev.hdr.type == QueueType::SymbolCode )
+            ev.hdr.type == QueueType::SymbolCode ||
+            ev.hdr.type == QueueType::HistogramData )
         {
             uint32_t sz;
             memcpy( &sz, ptr, sizeof( sz ) );
@@ -3266,6 +3614,11 @@ void Worker::DispatchFailure( const QueueItem& ev, const char*& ptr )
 void Worker::Query( ServerQuery type, uint64_t data, uint32_t extra )
 {
     ServerQueryPacket query { type, data, extra };
+    if( m_replay )
+    {
+        if( m_replayAnswers ) m_serverQueryQueue.push_back( query );
+        return;
+    }
     if( m_serverQueryQueue.empty() && m_serverQuerySpaceLeft > 0 )
     {
         m_serverQuerySpaceLeft--;
@@ -3289,7 +3642,8 @@ bool Worker::DispatchProcess( const QueueItem& ev, const char*& ptr )
     {
         ptr += sizeof( QueueHeader ) + sizeof( QueueStringTransfer );
         if( ev.hdr.type == QueueType::FrameImageData ||
-            ev.hdr.type == QueueType::SymbolCode )
+            ev.hdr.type == QueueType::SymbolCode ||
+            ev.hdr.type == QueueType::HistogramData )
         {
             uint32_t sz;
             memcpy( &sz, ptr, sizeof( sz ) );
@@ -3303,6 +3657,9 @@ bool Worker::DispatchProcess( const QueueItem& ev, const char*& ptr )
                 AddSymbolCode( ev.stringTransfer.ptr, ptr, sz );
                 m_serverQuerySpaceLeft++;
                 break;
+            case QueueType::HistogramData:
+                AddHistogramData( ptr, sz );
+                break;
             default:
                 assert( false );
                 break;
@@ -3334,6 +3691,12 @@ bool Worker::DispatchProcess( const QueueItem& ev, const char*& ptr )
             case QueueType::SourceLocationPayload:
                 AddSourceLocationPayload( ev.stringTransfer.ptr, ptr, sz );
                 break;
+            case QueueType::InternedSourceLocationPayload:
+                AddInternedSourceLocationPayload( ev.stringTransfer.ptr, ptr, sz );
+                break;
+            case QueueType::StaticSourceLocationPayload:
+                AddStaticSourceLocationPayload( ev.stringTransfer.ptr, ptr, sz );
+                break;
             case QueueType::CallstackPayload:
                 AddCallstackPayload( ev.stringTransfer.ptr, ptr, sz );
                 break;
@@ -3630,7 +3993,7 @@ void Worker::CheckThreadString( uint64_t id )
     m_data.threadNames.emplace( id, "???" );
     m_pendingThreads++;
 
-    if( m_sock.IsValid() ) Query( ServerQueryThreadString, id );
+    if( m_sock.IsValid() || m_replay ) Query( ServerQueryThreadString, id );
 }
 
 void Worker::CheckExternalName( uint64_t id )
@@ -3653,6 +4016,11 @@ void Worker::AddSourceLocation( const QueueSourceLocation& srcloc )
 
     auto it = m_data.sourceLocation.find( ptr );
     assert( it != m_data.sourceLocation.end() );
+    FillSourceLocation( it->second, srcloc );
+}
+
+void Worker::FillSourceLocation( SourceLocation& dst, const QueueSourceLocation& srcloc )
+{
     CheckString( srcloc.name );
     if( CheckString( srcloc.file ) )
     {
@@ -3673,7 +4041,7 @@ void Worker::AddSourceLocation( const QueueSourceLocation& srcloc )
     }
     CheckString( srcloc.function );
     const uint32_t color = ( srcloc.r << 16 ) | ( srcloc.g << 8 ) | srcloc.b;
-    it->second = SourceLocation { srcloc.name == 0 ? StringRef() : StringRef( StringRef::Ptr, srcloc.name ), StringRef( StringRef::Ptr, srcloc.function ), StringRef( StringRef::Ptr, srcloc.file ), srcloc.line, color };
+    dst = SourceLocation { srcloc.name == 0 ? StringRef() : StringRef( StringRef::Ptr, srcloc.name ), StringRef( StringRef::Ptr, srcloc.function ), StringRef( StringRef::Ptr, srcloc.file ), srcloc.line, color };
 }
 
 void Worker::AddSourceLocationPayload( uint64_t ptr, const char* data, size_t sz )
@@ -3731,6 +4099,41 @@ void Worker::AddSourceLocationPayload( uint64_t ptr, const char* data, size_t sz
     }
 }
 
+void Worker::AddStaticSourceLocationPayload( uint64_t ptr, const char* data, size_t sz )
+{
+    const auto end = data + sz;
+
+    QueueSourceLocation srcloc;
+    memcpy( &srcloc, data, sizeof( srcloc ) );
+    data += sizeof( srcloc );
+
+    const auto fsz = strlen( data );
+    AddStaticString( srcloc.function, data, fsz );
+    data += fsz + 1;
+    const auto ssz = strlen( data );
+    AddStaticString( srcloc.file, data, ssz );
+    data += ssz + 1;
+    if( srcloc.name != 0 ) AddStaticString( srcloc.name, data, end - data );
+
+    // Source location may have been already queried, in which case the query response will fill it.
+    if( m_data.sourceLocation.find( ptr ) != m_data.sourceLocation.end() ) return;
+    auto it = m_data.sourceLocation.emplace( ptr, SourceLocation {} ).first;
+    FillSourceLocation( it->second, srcloc );
+}
+
+void Worker::AddStaticString( uint64_t ptr, const char* str, size_t sz )
+{
+    if( m_data.strings.find( ptr ) != m_data.strings.end() ) return;
+    m_data.strings.emplace( ptr, StoreString( str, sz ).ptr );
+}
+
+void Worker::AddInternedSourceLocationPayload( uint64_t ptr, const char* data, size_t sz )
+{
+    AddSourceLocationPayload( ptr, data, sz );
+    m_internedSourceLocationMap[ptr] = m_pendingSourceLocationPayload;
+    m_pendingSourceLocationPayload = 0;
+}
+
 void Worker::AddString( uint64_t ptr, const char* str, size_t sz )
 {
     assert( m_pendingStrings > 0 );
@@ -3804,11 +4207,21 @@ void Worker::AddFrameImageData( uint64_t ptr, const char* data, size_t sz )
     m_pendingFrameImageData.image = m_texcomp.Pack( m_frameImageBuffer, sz, m_pendingFrameImageData.csz, m_slab );
 }
 
+void Worker::AddHistogramData( const char* data, size_t sz )
+{
+    assert( m_pendingHistogramData.empty() );
+    assert( sz % sizeof( uint64_t ) == 0 );
+    m_pendingHistogramData.reserve_and_use( sz / sizeof( uint64_t ) );
+    memcpy( m_pendingHistogramData.data(), data, sz );
+}
+
 void Worker::AddSymbolCode( uint64_t ptr, const char* data, size_t sz )
 {
     auto it = m_pendingSymbolCode.find( ptr );
     assert( it != m_pendingSymbolCode.end() );
     m_pendingSymbolCode.erase( it );
+    // Code of a symbol may be unavailable, e.g. when replaying a crash dump.
+    if( sz == 0 ) return;
 
     auto code = (char*)m_slab.AllocBig( sz );
     memcpy( code, data, sz );
@@ -3897,11 +4310,7 @@ void Worker::AddCallstackPayload( uint64_t ptr, const char* _data, size_t _sz )
         for( auto& frame : *arr )
         {
             auto fit = m_data.callstackFrameMap.find( frame );
-            if( fit == m_data.callstackFrameMap.end() )
-            {
-                m_pendingCallstackFrames++;
-                Query( ServerQueryCallstackFrame, GetCanonicalPointer( frame ) );
-            }
+            if( fit == m_data.callstackFrameMap.end() ) QueryCallstackFrame( frame );
         }
     }
     else
@@ -3990,11 +4399,7 @@ void Worker::AddCallstackAllocPayload( uint64_t ptr, const char* data, size_t _s
         for( auto& frame : *arr )
         {
             auto fit = m_data.callstackFrameMap.find( frame );
-            if( fit == m_data.callstackFrameMap.end() )
-            {
-                m_pendingCallstackFrames++;
-                Query( ServerQueryCallstackFrame, GetCanonicalPointer( frame ) );
-            }
+            if( fit == m_data.callstackFrameMap.end() ) QueryCallstackFrame( frame );
         }
     }
     else
@@ -4007,6 +4412,127 @@ void Worker::AddCallstackAllocPayload( uint64_t ptr, const char* data, size_t _s
     m_pendingCallstackId = idx;
 }
 
+void Worker::QueryCallstackFrame( CallstackFrameId frame )
+{
+    if( AddCachedCallstackFrame( frame ) ) return;
+    m_pendingCallstackFrames++;
+    Query( ServerQueryCallstackFrame, GetCanonicalPointer( frame ) );
+}
+
+bool Worker::AddCachedCallstackFrame( CallstackFrameId frame )
+{
+    const auto ptr = GetCanonicalPointer( frame );
+    uint64_t base;
+    auto cached = m_symbolCache.FindFrame( ptr, base );
+    if( !cached ) return false;
+
+    const auto size = uint8_t( cached->frames.size() );
+    auto data = m_slab.Alloc<CallstackFrameData>();
+    data->size = size;
+    data->data = m_slab.Alloc<CallstackFrame>( size );
+    data->imageName = StringIdx( StoreString( cached->imageName.c_str(), cached->imageName.size() ).idx );
+
+    for( uint8_t i=0; i<size; i++ )
+    {
+        const auto& f = cached->frames[i];
+        const auto name = StringIdx( StoreString( f.name.c_str(), f.name.size() ).idx );
+        const auto file = StringIdx( StoreString( f.file.c_str(), f.file.size() ).idx );
+        const auto symAddr = f.symOffset == SymbolCache::NoSymbol ? 0 : base + f.symOffset;
+        AddCallstackSubframe( data, i, ptr, name, file, f.line, symAddr, f.symLen );
+    }
+
+    m_data.callstackFrameMap.emplace( frame, data );
+#ifndef TRACY_NO_STATISTICS
+    m_data.newFramesWereReceived = true;
+#endif
+    return true;
+}
+
+void Worker::AddCallstackSubframe( CallstackFrameData* data, uint8_t idx, uint64_t ptr, StringIdx name, StringIdx file, uint32_t line, uint64_t symAddr, uint32_t symLen )
+{
+    data->data[idx].name = name;
+    data->data[idx].file = file;
+    data->data[idx].line = line;
+    data->data[idx].symAddr = symAddr;
+
+    if( symAddr != 0 && m_data.symbolMap.find( symAddr ) == m_data.symbolMap.end() && m_pendingSymbols.find( symAddr ) == m_pendingSymbols.end() )
+    {
+        const SymbolPending pending { name, data->imageName, file, line, symLen, idx < data->size - 1 };
+        auto cached = m_symbolCache.FindSymbol( symAddr );
+        if( cached )
+        {
+            AddSymbolInformation( symAddr, pending, StringIdx( StoreString( cached->file.c_str(), cached->file.size() ).idx ), cached->line );
+        }
+        else
+        {
+            m_pendingSymbols.emplace( symAddr, pending );
+            Query( ServerQuerySymbol, symAddr );
+        }
+    }
+
+    StringRef ref( StringRef::Idx, file.Idx() );
+    auto cit = m_checkedFileStrings.find( ref );
+    if( cit == m_checkedFileStrings.end() ) CacheSource( ref );
+
+#ifndef TRACY_NO_STATISTICS
+    const auto frameId = PackPointer( ptr );
+    auto it = m_data.pendingInstructionPointers.find( frameId );
+    if( it != m_data.pendingInstructionPointers.end() )
+    {
+        if( symAddr != 0 )
+        {
+            auto sit = m_data.instructionPointersMap.find( symAddr );
+            if( sit == m_data.instructionPointersMap.end() )
+            {
+                m_data.instructionPointersMap.emplace( symAddr, unordered_flat_map<CallstackFrameId, uint32_t, CallstackFrameIdHash, CallstackFrameIdCompare> { { it->first, it->second } } );
+            }
+            else
+            {
+                assert( sit->second.find( it->first ) == sit->second.end() );
+                sit->second.emplace( it->first, it->second );
+            }
+        }
+        m_data.pendingInstructionPointers.erase( it );
+    }
+#endif
+}
+
+void Worker::AddSymbolInformation( uint64_t symAddr, const SymbolPending& pending, StringIdx file, uint32_t line )
+{
+    SymbolData sd;
+    sd.name = pending.name;
+    sd.file = file;
+    sd.line = line;
+    sd.imageName = pending.imageName;
+    sd.callFile = pending.file;
+    sd.callLine = pending.line;
+    sd.isInline = pending.isInline;
+    sd.size.SetVal( pending.size );
+    m_data.symbolMap.emplace( symAddr, std::move( sd ) );
+
+    if( pending.size > 0 && pending.size <= 64*1024 )
+    {
+        assert( m_pendingSymbolCode.find( symAddr ) == m_pendingSymbolCode.end() );
+        m_pendingSymbolCode.emplace( symAddr );
+        Query( ServerQuerySymbolCode, symAddr, pending.size );
+    }
+
+    if( !pending.isInline )
+    {
+        if( !m_data.newSymbolsWereAdded ) m_data.newSymbolsWereAdded = true;
+        m_data.symbolLoc.push_back( SymbolLocation { symAddr, pending.size } );
+    }
+    else
+    {
+        if( !m_data.newInlineSymbolsWereAdded ) m_data.newInlineSymbolsWereAdded = true;
+        m_data.symbolLocInline.push_back( symAddr );
+    }
+
+    StringRef ref( StringRef::Idx, file.Idx() );
+    auto cit = m_checkedFileStrings.find( ref );
+    if( cit == m_checkedFileStrings.end() ) CacheSource( ref );
+}
+
 void Worker::InsertPlot( PlotData* plot, int64_t time, double val )
 {
     if( plot->data.empty() )
@@ -4131,9 +4657,15 @@ bool Worker::Process( const QueueItem& ev )
     case QueueType::ZoneBeginCallstack:
         ProcessZoneBeginCallstack( ev.zoneBegin );
         break;
+    case QueueType::ZoneBeginAllocSrcLoc:
+        ProcessZoneBeginInternedSrcLoc( ev.zoneBegin );
+        break;
     case QueueType::ZoneBeginAllocSrcLocLean:
         ProcessZoneBeginAllocSrcLoc( ev.zoneBeginLean );
         break;
+    case QueueType::ZoneBeginAllocSrcLocCallstack:
+        ProcessZoneBeginInternedSrcLocCallstack( ev.zoneBegin );
+        break;
     case QueueType::ZoneBeginAllocSrcLocCallstackLean:
         ProcessZoneBeginAllocSrcLocCallstack( ev.zoneBeginLean );
         break;
@@ -4168,6 +4700,12 @@ bool Worker::Process( const QueueItem& ev )
     case QueueType::ZoneValue:
         ProcessZoneValue( ev.zoneValue );
         break;
+    case QueueType::ZoneFlowOut:
+        ProcessZoneFlow( ev.zoneFlow, true );
+        break;
+    case QueueType::ZoneFlowIn:
+        ProcessZoneFlow( ev.zoneFlow, false );
+        break;
     case QueueType::LockAnnounce:
         ProcessLockAnnounce( ev.lockAnnounce );
         break;
@@ -4198,6 +4736,21 @@ bool Worker::Process( const QueueItem& ev )
     case QueueType::LockName:
         ProcessLockName( ev.lockName );
         break;
+    case QueueType::WaitAnnounce:
+        ProcessWaitAnnounce( ev.waitAnnounce );
+        break;
+    case QueueType::WaitTerminate:
+        ProcessWaitTerminate( ev.waitTerminate );
+        break;
+    case QueueType::WaitBegin:
+        ProcessWaitBegin( ev.waitBegin );
+        break;
+    case QueueType::WaitEnd:
+        ProcessWaitEnd( ev.waitEnd );
+        break;
+    case QueueType::WaitNotify:
+        ProcessWaitNotify( ev.waitNotify );
+        break;
     case QueueType::PlotData:
         ProcessPlotData( ev.plotData );
         break;
@@ -4256,10 +4809,10 @@ bool Worker::Process( const QueueItem& ev )
         ProcessGpuTime( ev.gpuTime );
         break;
     case QueueType::MemAlloc:
-        ProcessMemAlloc( ev.memAlloc );
+        ProcessMemAlloc( GetMemPool(), ev.memAlloc );
         break;
     case QueueType::MemFree:
-        ProcessMemFree( ev.memFree );
+        ProcessMemFree( GetMemPool(), ev.memFree );
         break;
     case QueueType::MemAllocCallstack:
         ProcessMemAllocCallstack( ev.memAlloc );
@@ -4326,6 +4879,24 @@ bool Worker::Process( const QueueItem& ev )
     case QueueType::CpuTopology:
         ProcessCpuTopology( ev.cpuTopology );
         break;
+    case QueueType::CaptureStart:
+        ProcessCaptureStart( ev.captureWindow );
+        break;
+    case QueueType::CaptureStop:
+        ProcessCaptureStop( ev.captureWindow );
+        break;
+    case QueueType::HistogramLean:
+        ProcessHistogram( ev.histogramLean );
+        break;
+    case QueueType::MemNamePayload:
+        ProcessMemNamePayload( ev.memName );
+        break;
+    case QueueType::LockUncontended:
+        ProcessLockUncontended( ev.lockUncontended );
+        break;
+    case QueueType::ModuleInfo:
+        ProcessModuleInfo( ev.moduleInfo );
+        break;
     default:
         assert( false );
         break;
@@ -4429,6 +5000,26 @@ void Worker::ProcessZoneBeginAllocSrcLocCallstack( const QueueZoneBeginLean& ev
     next.zone = zone;
 }
 
+void Worker::SetInternedSourceLocation( uint64_t ptr )
+{
+    assert( m_pendingSourceLocationPayload == 0 );
+    auto it = m_internedSourceLocationMap.find( ptr );
+    assert( it != m_internedSourceLocationMap.end() );
+    m_pendingSourceLocationPayload = it->second;
+}
+
+void Worker::ProcessZoneBeginInternedSrcLoc( const QueueZoneBegin& ev )
+{
+    SetInternedSourceLocation( ev.srcloc );
+    ProcessZoneBeginAllocSrcLoc( ev );
+}
+
+void Worker::ProcessZoneBeginInternedSrcLocCallstack( const QueueZoneBegin& ev )
+{
+    SetInternedSourceLocation( ev.srcloc );
+    ProcessZoneBeginAllocSrcLocCallstack( ev );
+}
+
 void Worker::ProcessZoneEnd( const QueueZoneEnd& ev )
 {
     auto td = m_threadCtxData;
@@ -4545,6 +5136,13 @@ void Worker::ZoneNameFailure( uint64_t thread )
     m_failureData.srcloc = 0;
 }
 
+void Worker::ZoneFlowFailure( uint64_t thread )
+{
+    m_failure = Failure::ZoneFlow;
+    m_failureData.thread = thread;
+    m_failureData.srcloc = 0;
+}
+
 void Worker::MemFreeFailure( uint64_t thread )
 {
     m_failure = Failure::MemFree;
@@ -4777,6 +5375,64 @@ void Worker::ProcessZoneName( const QueueZoneText& ev )
     m_pendingCustomStrings.erase( it );
 }
 
+void Worker::ProcessZoneFlow( const QueueZoneFlow& ev, bool out )
+{
+    auto td = RetrieveThread( m_threadCtx );
+    if( !td || td->stack.empty() || td->nextZoneId != td->zoneIdStack.back() )
+    {
+        ZoneFlowFailure( m_threadCtx );
+        return;
+    }
+
+    td->nextZoneId = 0;
+    auto zone = td->stack.back();
+    const auto time = TscTime( ev.time - m_data.baseTime );
+
+    // Ids may be reused by the program after a flow is complete. The ends of a flow come from
+    // different threads, and may be received in any order. Unmatched ends of the same id are
+    // kept in order of arrival, which pairs them correctly, as long as each end is emitted from
+    // a single thread.
+    uint32_t idx;
+    auto it = m_pendingFlows.find( ev.id );
+    if( it == m_pendingFlows.end() || it->second.out == out )
+    {
+        idx = uint32_t( m_data.flows.size() );
+        auto& flow = m_data.flows.push_next();
+        memset( &flow, 0, sizeof( flow ) );
+        flow.timeOut = -1;
+        flow.timeIn = -1;
+        if( it == m_pendingFlows.end() )
+        {
+            it = m_pendingFlows.emplace( ev.id, PendingFlow { out } ).first;
+        }
+        it->second.idx.push_back( idx );
+    }
+    else
+    {
+        auto& pending = it->second.idx;
+        idx = pending.front();
+        pending.erase( pending.begin() );
+        if( pending.empty() ) m_pendingFlows.erase( it );
+    }
+
+    auto& flow = m_data.flows[idx];
+    auto& extra = RequestZoneExtra( *zone );
+    if( out )
+    {
+        flow.timeOut = time;
+        flow.threadOut = CompressThread( m_threadCtx );
+        flow.srclocOut = zone->SrcLoc();
+        if( extra.flowOut == 0 ) extra.flowOut = idx + 1;
+    }
+    else
+    {
+        flow.timeIn = time;
+        flow.threadIn = CompressThread( m_threadCtx );
+        flow.srclocIn = zone->SrcLoc();
+        if( extra.flowIn == 0 ) extra.flowIn = idx + 1;
+    }
+}
+
 void Worker::ProcessZoneValue( const QueueZoneValue& ev )
 {
     char tmp[32];
@@ -4983,13 +5639,13 @@ void Worker::ProcessLockMark( const QueueLockMark& ev )
 {
     CheckSourceLocation( ev.srcloc );
     auto lit = m_data.lockMap.find( ev.id );
-    assert( lit != m_data.lockMap.end() );
+    if( lit == m_data.lockMap.end() ) return;
     auto& lockmap = *lit->second;
     auto tid = lockmap.threadMap.find( ev.thread );
-    assert( tid != lockmap.threadMap.end() );
+    if( tid == lockmap.threadMap.end() ) return;
     const auto thread = tid->second;
     auto it = lockmap.timeline.end();
-    for(;;)
+    while( it != lockmap.timeline.begin() )
     {
         --it;
         if( it->ptr->thread == thread )
@@ -5019,6 +5675,113 @@ void Worker::ProcessLockName( const QueueLockName& ev )
     m_pendingCustomStrings.erase( it );
 }
 
+void Worker::ProcessLockUncontended( const QueueLockUncontended& ev )
+{
+    auto it = m_data.lockMap.find( ev.id );
+    if( it == m_data.lockMap.end() )
+    {
+        auto lm = m_slab.AllocInit<LockMap>();
+        lm->timeAnnounce = 0;
+        lm->timeTerminate = 0;
+        lm->valid = false;
+        lm->type = ev.type;
+        lm->isContended = false;
+        it = m_data.lockMap.emplace( ev.id, lm ).first;
+    }
+    it->second->uncontended += ev.count;
+}
+
+WaitMap& Worker::GetWaitMapEntry( uint32_t id )
+{
+    auto it = m_data.waitMap.find( id );
+    if( it == m_data.waitMap.end() )
+    {
+        auto wm = m_slab.AllocInit<WaitMap>();
+        wm->timeAnnounce = 0;
+        wm->timeTerminate = 0;
+        wm->valid = false;
+        it = m_data.waitMap.emplace( id, wm ).first;
+    }
+    return *it->second;
+}
+
+void Worker::ProcessWaitAnnounce( const QueueWaitAnnounce& ev )
+{
+    auto& wm = GetWaitMapEntry( ev.id );
+    wm.srcloc = ShrinkSourceLocation( ev.srcloc );
+    wm.type = ev.type;
+    wm.timeAnnounce = TscTime( ev.time - m_data.baseTime );
+    wm.valid = true;
+    CheckSourceLocation( ev.srcloc );
+}
+
+void Worker::ProcessWaitTerminate( const QueueWaitTerminate& ev )
+{
+    GetWaitMapEntry( ev.id ).timeTerminate = TscTime( ev.time - m_data.baseTime );
+}
+
+void Worker::ProcessWaitBegin( const QueueWaitBegin& ev )
+{
+    const auto refTime = m_refTimeSerial + ev.time;
+    m_refTimeSerial = refTime;
+    const auto time = TscTime( refTime - m_data.baseTime );
+    if( m_data.lastTime < time ) m_data.lastTime = time;
+
+    NoticeThread( ev.thread );
+
+    auto& td = GetWaitMapEntry( ev.id ).threadData[ev.thread];
+    td.waits.push_back( WaitEvent { time, -1, -1, 0, 0 } );
+}
+
+void Worker::ProcessWaitEnd( const QueueWaitEnd& ev )
+{
+    const auto refTime = m_refTimeSerial + ev.time;
+    m_refTimeSerial = refTime;
+    const auto time = TscTime( refTime - m_data.baseTime );
+    if( m_data.lastTime < time ) m_data.lastTime = time;
+
+    auto& wm = GetWaitMapEntry( ev.id );
+    auto it = wm.threadData.find( ev.thread );
+    if( it == wm.threadData.end() || it->second.waits.empty() || it->second.waits.back().end >= 0 ) return;
+    auto& wait = it->second.waits.back();
+    wait.end = time;
+    wait.timeout = ev.timeout;
+    if( ev.timeout ) return;
+
+    // The notifications of each thread are ordered, find the last one issued during the wait.
+    for( auto& td : wm.threadData )
+    {
+        if( td.first == ev.thread || td.second.notifies.empty() ) continue;
+        const auto& notifies = td.second.notifies;
+        auto nit = std::upper_bound( notifies.begin(), notifies.end(), time, [] ( const auto& l, const auto& r ) { return l < r.time; } );
+        if( nit == notifies.begin() ) continue;
+        --nit;
+        if( nit->time >= wait.start && nit->time > wait.notify )
+        {
+            wait.notify = nit->time;
+            wait.waker = td.first;
+        }
+    }
+}
+
+void Worker::ProcessWaitNotify( const QueueWaitNotify& ev )
+{
+    const auto refTime = m_refTimeSerial + ev.time;
+    m_refTimeSerial = refTime;
+    const auto time = TscTime( refTime - m_data.baseTime );
+    if( m_data.lastTime < time ) m_data.lastTime = time;
+
+    NoticeThread( ev.thread );
+
+    auto& td = GetWaitMapEntry( ev.id ).threadData[ev.thread];
+    td.notifies.push_back( WaitNotify { time, ev.count } );
+}
+
+void Worker::ProcessModuleInfo( const QueueModuleInfo& ev )
+{
+    m_symbolCache.AddModule( ev.base, ev.size, ev.buildId );
+}
+
 void Worker::ProcessPlotData( const QueuePlotData& ev )
 {
     PlotData* plot = m_data.plots.Retrieve( ev.name, [this] ( uint64_t name ) {
@@ -5052,6 +5815,41 @@ void Worker::ProcessPlotData( const QueuePlotData& ev )
     }
 }
 
+void Worker::ProcessHistogram( const QueueHistogramLean& ev )
+{
+    assert( !m_pendingHistogramData.empty() );
+    CheckString( ev.name );
+
+    const auto refTime = m_refTimeThread + ev.time;
+    m_refTimeThread = refTime;
+    const auto time = TscTime( refTime - m_data.baseTime );
+    if( m_data.lastTime < time ) m_data.lastTime = time;
+
+    HistogramData* hist = nullptr;
+    for( auto& v : m_data.histograms )
+    {
+        if( v->name == ev.name )
+        {
+            hist = v;
+            break;
+        }
+    }
+    if( !hist )
+    {
+        hist = m_slab.AllocInit<HistogramData>();
+        hist->name = ev.name;
+        m_data.histograms.push_back( hist );
+    }
+
+    auto& interval = hist->intervals.push_next();
+    interval.start = time - ev.period;
+    interval.end = time;
+    interval.offset = uint32_t( hist->entries.size() );
+    interval.count = uint32_t( m_pendingHistogramData.size() );
+    for( auto& v : m_pendingHistogramData ) hist->entries.push_back( v );
+    m_pendingHistogramData.clear();
+}
+
 void Worker::ProcessPlotConfig( const QueuePlotConfig& ev )
 {
     PlotData* plot = m_data.plots.Retrieve( ev.name, [this] ( uint64_t name ) {
@@ -5233,8 +6031,8 @@ void Worker::ProcessGpuZoneBeginImpl( GpuEvent* zone, const QueueGpuZoneBegin& e
     }
     else
     {
-        // OpenGL doesn't need per-zone thread id. It still can be sent,
-        // because it may be needed for callstack collection purposes.
+        // OpenGL and device contexts don't need per-zone thread id. It still
+        // can be sent, because it may be needed for callstack collection purposes.
         zone->SetThread( 0 );
         ztid = 0;
     }
@@ -5356,7 +6154,7 @@ void Worker::ProcessGpuTime( const QueueGpuTime& ev )
     }
 }
 
-void Worker::ProcessMemAlloc( const QueueMemAlloc& ev )
+void Worker::ProcessMemAlloc( MemData& memdata, const QueueMemAlloc& ev )
 {
     const auto refTime = m_refTimeSerial + ev.time;
     m_refTimeSerial = refTime;
@@ -5364,10 +6162,10 @@ void Worker::ProcessMemAlloc( const QueueMemAlloc& ev )
     if( m_data.lastTime < time ) m_data.lastTime = time;
     NoticeThread( ev.thread );
 
-    assert( m_data.memory.active.find( ev.ptr ) == m_data.memory.active.end() );
-    assert( m_data.memory.data.empty() || m_data.memory.data.back().TimeAlloc() <= time );
+    assert( memdata.active.find( ev.ptr ) == memdata.active.end() );
+    assert( memdata.data.empty() || memdata.data.back().TimeAlloc() <= time );
 
-    m_data.memory.active.emplace( ev.ptr, m_data.memory.data.size() );
+    memdata.active.emplace( ev.ptr, memdata.data.size() );
 
     const auto ptr = ev.ptr;
     uint32_t lo;
@@ -5376,7 +6174,7 @@ void Worker::ProcessMemAlloc( const QueueMemAlloc& ev )
     memcpy( &hi, ev.size+4, 2 );
     const uint64_t size = lo | ( uint64_t( hi ) << 32 );
 
-    auto& mem = m_data.memory.data.push_next();
+    auto& mem = memdata.data.push_next();
     mem.SetPtr( ptr );
     mem.SetSize( size );
     mem.SetTimeThreadAlloc( time, CompressThread( ev.thread ) );
@@ -5384,26 +6182,26 @@ void Worker::ProcessMemAlloc( const QueueMemAlloc& ev )
     mem.SetCsAlloc( 0 );
     mem.csFree.SetVal( 0 );
 
-    const auto low = m_data.memory.low;
-    const auto high = m_data.memory.high;
+    const auto low = memdata.low;
+    const auto high = memdata.high;
     const auto ptrend = ptr + size;
 
-    m_data.memory.low = std::min( low, ptr );
-    m_data.memory.high = std::max( high, ptrend );
-    m_data.memory.usage += size;
+    memdata.low = std::min( low, ptr );
+    memdata.high = std::max( high, ptrend );
+    memdata.usage += MemWeight( size );
 
-    MemAllocChanged( time );
+    MemAllocChanged( memdata, time );
 }
 
-bool Worker::ProcessMemFree( const QueueMemFree& ev )
+bool Worker::ProcessMemFree( MemData& memdata, const QueueMemFree& ev )
 {
     const auto refTime = m_refTimeSerial + ev.time;
     m_refTimeSerial = refTime;
 
     if( ev.ptr == 0 ) return false;
 
-    auto it = m_data.memory.active.find( ev.ptr );
-    if( it == m_data.memory.active.end() )
+    auto it = memdata.active.find( ev.ptr );
+    if( it == memdata.active.end() )
     {
         if( !m_ignoreMemFreeFaults )
         {
@@ -5417,28 +6215,32 @@ bool Worker::ProcessMemFree( const QueueMemFree& ev )
     if( m_data.lastTime < time ) m_data.lastTime = time;
     NoticeThread( ev.thread );
 
-    m_data.memory.frees.push_back( it->second );
-    auto& mem = m_data.memory.data[it->second];
+    memdata.frees.push_back( it->second );
+    auto& mem = memdata.data[it->second];
     mem.SetTimeThreadFree( time, CompressThread( ev.thread ) );
-    m_data.memory.usage -= mem.Size();
-    m_data.memory.active.erase( it );
+    memdata.usage -= MemWeight( mem.Size() );
+    memdata.active.erase( it );
 
-    MemAllocChanged( time );
+    MemAllocChanged( memdata, time );
     return true;
 }
 
 void Worker::ProcessMemAllocCallstack( const QueueMemAlloc& ev )
 {
-    m_lastMemActionCallstack = m_data.memory.data.size();
-    ProcessMemAlloc( ev );
+    auto& memdata = GetMemPool();
+    m_lastMemActionPool = &memdata;
+    m_lastMemActionCallstack = memdata.data.size();
+    ProcessMemAlloc( memdata, ev );
     m_lastMemActionWasAlloc = true;
 }
 
 void Worker::ProcessMemFreeCallstack( const QueueMemFree& ev )
 {
-    if( ProcessMemFree( ev ) )
+    auto& memdata = GetMemPool();
+    m_lastMemActionPool = &memdata;
+    if( ProcessMemFree( memdata, ev ) )
     {
-        m_lastMemActionCallstack = m_data.memory.frees.back();
+        m_lastMemActionCallstack = memdata.frees.back();
         m_lastMemActionWasAlloc = false;
     }
     else
@@ -5454,7 +6256,7 @@ void Worker::ProcessCallstackMemory()
 
     if( m_lastMemActionCallstack != std::numeric_limits<uint64_t>::max() )
     {
-        auto& mem = m_data.memory.data[m_lastMemActionCallstack];
+        auto& mem = m_lastMemActionPool->data[m_lastMemActionCallstack];
         if( m_lastMemActionWasAlloc )
         {
             mem.SetCsAlloc( m_pendingCallstackId );
@@ -5718,6 +6520,13 @@ void Worker::ProcessCallstackFrameSize( const QueueCallstackFrameSize& ev )
         m_callstackFrameStaging->imageName = StringIdx( iit->second.idx );
 
         m_callstackFrameStagingPtr = ev.ptr;
+
+        m_symbolCacheStagingActive = m_symbolCache.HasModule( ev.ptr );
+        if( m_symbolCacheStagingActive )
+        {
+            m_symbolCacheStaging.imageName = GetString( m_callstackFrameStaging->imageName );
+            m_symbolCacheStaging.frames.clear();
+        }
     }
 
     m_pendingCustomStrings.erase( iit );
@@ -5741,52 +6550,29 @@ void Worker::ProcessCallstackFrame( const QueueCallstackFrame& ev )
     {
         const auto idx = m_callstackFrameStaging->size - m_pendingCallstackSubframes;
 
-        const auto name = StringIdx( nitidx );
-        const auto file = StringIdx( fitidx );
-        m_callstackFrameStaging->data[idx].name = name;
-        m_callstackFrameStaging->data[idx].file = file;
-        m_callstackFrameStaging->data[idx].line = ev.line;
-        m_callstackFrameStaging->data[idx].symAddr = ev.symAddr;
-
-        if( ev.symAddr != 0 && m_data.symbolMap.find( ev.symAddr ) == m_data.symbolMap.end() && m_pendingSymbols.find( ev.symAddr ) == m_pendingSymbols.end() )
-        {
-            uint32_t size = 0;
-            memcpy( &size, ev.symLen, 3 );
-            m_pendingSymbols.emplace( ev.symAddr, SymbolPending { name, m_callstackFrameStaging->imageName, file, ev.line, size, idx < m_callstackFrameStaging->size - 1 } );
-            Query( ServerQuerySymbol, ev.symAddr );
-        }
-
-        StringRef ref( StringRef::Idx, fitidx );
-        auto cit = m_checkedFileStrings.find( ref );
-        if( cit == m_checkedFileStrings.end() ) CacheSource( ref );
+        uint32_t size = 0;
+        memcpy( &size, ev.symLen, 3 );
+        AddCallstackSubframe( m_callstackFrameStaging, idx, m_callstackFrameStagingPtr, StringIdx( nitidx ), StringIdx( fitidx ), ev.line, ev.symAddr, size );
 
-        const auto frameId = PackPointer( m_callstackFrameStagingPtr );
-#ifndef TRACY_NO_STATISTICS
-        auto it = m_data.pendingInstructionPointers.find( frameId );
-        if( it != m_data.pendingInstructionPointers.end() )
+        // Frames without debug information have absolute addresses embedded in names.
+        if( ev.line == 0 ) m_symbolCacheStagingActive = false;
+        if( m_symbolCacheStagingActive )
         {
-            if( ev.symAddr != 0 )
-            {
-                auto sit = m_data.instructionPointersMap.find( ev.symAddr );
-                if( sit == m_data.instructionPointersMap.end() )
-                {
-                    m_data.instructionPointersMap.emplace( ev.symAddr, unordered_flat_map<CallstackFrameId, uint32_t, CallstackFrameIdHash, CallstackFrameIdCompare> { { it->first, it->second } } );
-                }
-                else
-                {
-                    assert( sit->second.find( it->first ) == sit->second.end() );
-                    sit->second.emplace( it->first, it->second );
-                }
-            }
-            m_data.pendingInstructionPointers.erase( it );
+            m_symbolCacheStaging.frames.emplace_back( SymbolCache::Frame { GetString( StringIdx( nitidx ) ), GetString( StringIdx( fitidx ) ), ev.line, size, ev.symAddr } );
         }
-#endif
 
         if( --m_pendingCallstackSubframes == 0 )
         {
+            const auto frameId = PackPointer( m_callstackFrameStagingPtr );
             assert( m_data.callstackFrameMap.find( frameId ) == m_data.callstackFrameMap.end() );
             m_data.callstackFrameMap.emplace( frameId, m_callstackFrameStaging );
             m_callstackFrameStaging = nullptr;
+
+            if( m_symbolCacheStagingActive )
+            {
+                m_symbolCache.AddFrame( m_callstackFrameStagingPtr, std::move( m_symbolCacheStaging ) );
+                m_symbolCacheStagingActive = false;
+            }
         }
     }
     else
@@ -5803,38 +6589,9 @@ void Worker::ProcessSymbolInformation( const QueueSymbolInformation& ev )
     auto fit = m_pendingCustomStrings.find( ev.file );
     assert( fit != m_pendingCustomStrings.end() );
 
-    SymbolData sd;
-    sd.name = it->second.name;
-    sd.file = StringIdx( fit->second.idx );
-    sd.line = ev.line;
-    sd.imageName = it->second.imageName;
-    sd.callFile = it->second.file;
-    sd.callLine = it->second.line;
-    sd.isInline = it->second.isInline;
-    sd.size.SetVal( it->second.size );
-    m_data.symbolMap.emplace( ev.symAddr, std::move( sd ) );
-
-    if( it->second.size > 0 && it->second.size <= 64*1024 )
-    {
-        assert( m_pendingSymbolCode.find( ev.symAddr ) == m_pendingSymbolCode.end() );
-        m_pendingSymbolCode.emplace( ev.symAddr );
-        Query( ServerQuerySymbolCode, ev.symAddr, it->second.size );
-    }
-
-    if( !it->second.isInline )
-    {
-        if( !m_data.newSymbolsWereAdded ) m_data.newSymbolsWereAdded = true;
-        m_data.symbolLoc.push_back( SymbolLocation { ev.symAddr, it->second.size } );
-    }
-    else
-    {
-        if( !m_data.newInlineSymbolsWereAdded ) m_data.newInlineSymbolsWereAdded = true;
-        m_data.symbolLocInline.push_back( ev.symAddr );
-    }
-
-    StringRef ref( StringRef::Idx, fit->second.idx );
-    auto cit = m_checkedFileStrings.find( ref );
-    if( cit == m_checkedFileStrings.end() ) CacheSource( ref );
+    const auto file = StringIdx( fit->second.idx );
+    AddSymbolInformation( ev.symAddr, it->second, file, ev.line );
+    if( ev.line != 0 ) m_symbolCache.AddSymbol( ev.symAddr, GetString( file ), ev.line );
 
     m_pendingSymbols.erase( it );
     m_pendingCustomStrings.erase( fit );
@@ -6055,40 +6812,120 @@ void Worker::ProcessCpuTopology( const QueueCpuTopology& ev )
     m_data.cpuTopologyMap.emplace( ev.thread, CpuThreadTopology { ev.package, ev.core } );
 }
 
-void Worker::MemAllocChanged( int64_t time )
+void Worker::ProcessCaptureStart( const QueueCaptureWindow& ev )
+{
+    const auto time = TscTime( ev.time - m_data.baseTime );
+    if( m_data.captureGaps.empty() || m_data.captureGaps.back().end >= 0 ) return;
+    m_data.captureGaps.back().end = time;
+    if( m_data.lastTime < time ) m_data.lastTime = time;
+}
+
+void Worker::ProcessCaptureStop( const QueueCaptureWindow& ev )
+{
+    const auto time = TscTime( ev.time - m_data.baseTime );
+    if( !m_data.captureGaps.empty() && m_data.captureGaps.back().end < 0 ) return;
+    m_data.captureGaps.push_back( CaptureGap { time, -1 } );
+    if( m_data.lastTime < time ) m_data.lastTime = time;
+}
+
+uint64_t Worker::MemWeight( uint64_t size ) const
+{
+    if( m_memSamplingInterval == 0 ) return size;
+    if( size == 0 ) return m_memSamplingInterval;
+    // Sampled allocations represent size / P( sampled ) bytes, with P = 1 - exp( -size / interval ).
+    return uint64_t( double( size ) / -expm1( -double( size ) / m_memSamplingInterval ) );
+}
+
+void Worker::ProcessMemNamePayload( const QueueMemNamePayload& ev )
+{
+    assert( m_memNamePayload == 0 );
+    m_memNamePayload = ev.name;
+}
+
+MemData& Worker::GetMemPool()
+{
+    const auto name = m_memNamePayload;
+    if( name == 0 ) return m_data.memory;
+    m_memNamePayload = 0;
+
+    auto it = m_data.memNameMap.find( name );
+    if( it != m_data.memNameMap.end() ) return *it->second;
+
+    CheckString( name );
+    auto mem = m_slab.AllocInit<MemData>();
+    mem->name = name;
+    m_data.memNameMap.emplace( name, mem );
+    return *mem;
+}
+
+void Worker::ReadMemEvents( FileRead& f, MemData& memdata, uint64_t sz )
+{
+    auto mem = memdata.data.data();
+    auto& frees = memdata.frees;
+    auto& active = memdata.active;
+    size_t fidx = 0;
+    int64_t refTime = 0;
+
+    for( uint64_t i=0; i<sz; i++ )
+    {
+        s_loadProgress.subProgress.store( i, std::memory_order_relaxed );
+        uint64_t ptr, size;
+        Int24 csAlloc;
+        int64_t timeAlloc, timeFree;
+        uint16_t threadAlloc, threadFree;
+        f.Read8( ptr, size, csAlloc, mem->csFree, timeAlloc, timeFree, threadAlloc, threadFree );
+        mem->SetPtr( ptr );
+        mem->SetSize( size );
+        mem->SetCsAlloc( csAlloc.Val() );
+        refTime += timeAlloc;
+        mem->SetTimeThreadAlloc( refTime, threadAlloc );
+        if( timeFree >= 0 )
+        {
+            mem->SetTimeThreadFree( timeFree + refTime, threadFree );
+            frees[fidx++] = i;
+        }
+        else
+        {
+            mem->SetTimeThreadFree( timeFree, threadFree );
+            active.emplace( ptr, i );
+        }
+        mem++;
+    }
+}
+
+void Worker::MemAllocChanged( MemData& mem, int64_t time )
 {
-    const auto val = (double)m_data.memory.usage;
-    if( !m_data.memory.plot )
+    const auto val = (double)mem.usage;
+    if( !mem.plot )
     {
-        CreateMemAllocPlot();
-        m_data.memory.plot->min = val;
-        m_data.memory.plot->max = val;
-        m_data.memory.plot->data.push_back( { time, val } );
+        CreateMemAllocPlot( mem );
+        mem.plot->min = val;
+        mem.plot->max = val;
+        mem.plot->data.push_back( { time, val } );
     }
     else
     {
-        assert( !m_data.memory.plot->data.empty() );
-        assert( m_data.memory.plot->data.back().time.Val() <= time );
-        if( m_data.memory.plot->min > val ) m_data.memory.plot->min = val;
-        else if( m_data.memory.plot->max < val ) m_data.memory.plot->max = val;
-        m_data.memory.plot->data.push_back_non_empty( { time, val } );
+        assert( !mem.plot->data.empty() );
+        assert( mem.plot->data.back().time.Val() <= time );
+        if( mem.plot->min > val ) mem.plot->min = val;
+        else if( mem.plot->max < val ) mem.plot->max = val;
+        mem.plot->data.push_back_non_empty( { time, val } );
     }
 }
 
-void Worker::CreateMemAllocPlot()
+void Worker::CreateMemAllocPlot( MemData& mem )
 {
-    assert( !m_data.memory.plot );
-    m_data.memory.plot = m_slab.AllocInit<PlotData>();
-    m_data.memory.plot->name = 0;
-    m_data.memory.plot->type = PlotType::Memory;
-    m_data.memory.plot->format = PlotValueFormatting::Memory;
-    m_data.memory.plot->data.push_back( { GetFrameBegin( *m_data.framesBase, 0 ), 0. } );
-    m_data.plots.Data().push_back( m_data.memory.plot );
+    assert( !mem.plot );
+    mem.plot = m_slab.AllocInit<PlotData>();
+    mem.plot->name = mem.name;
+    mem.plot->type = PlotType::Memory;
+    mem.plot->format = PlotValueFormatting::Memory;
+    mem.plot->data.push_back( { GetFrameBegin( *m_data.framesBase, 0 ), 0. } );
+    m_data.plots.Data().push_back( mem.plot );
 }
 
-void Worker::ReconstructMemAllocPlot()
+void Worker::ReconstructMemAllocPlot( MemData& mem )
 {
-    auto& mem = m_data.memory;
 #ifdef NO_PARALLEL_SORT
     pdqsort_branchless( mem.frees.begin(), mem.frees.end(), [&mem] ( const auto& lhs, const auto& rhs ) { return mem.data[lhs].TimeFree() < mem.data[rhs].TimeFree(); } );
 #else
@@ -6099,14 +6936,16 @@ void Worker::ReconstructMemAllocPlot()
 
     PlotData* plot;
     {
+        // Plots of several memory pools are reconstructed at the same time, and the slab
+        // allocator is not thread safe.
         std::lock_guard<std::shared_mutex> lock( m_data.lock );
         plot = m_slab.AllocInit<PlotData>();
+        plot->data.reserve_exact( psz, m_slab );
     }
 
-    plot->name = 0;
+    plot->name = mem.name;
     plot->type = PlotType::Memory;
     plot->format = PlotValueFormatting::Memory;
-    plot->data.reserve_exact( psz, m_slab );
 
     auto aptr = mem.data.begin();
     auto aend = mem.data.end();
@@ -6130,7 +6969,7 @@ void Worker::ReconstructMemAllocPlot()
         {
             if( atime < ftime )
             {
-                usage += int64_t( aptr->Size() );
+                usage += int64_t( MemWeight( aptr->Size() ) );
                 assert( usage >= 0 );
                 if( max < usage ) max = usage;
                 ptr->time = atime;
@@ -6142,7 +6981,7 @@ void Worker::ReconstructMemAllocPlot()
             }
             else
             {
-                usage -= int64_t( mem.data[*fptr].Size() );
+                usage -= int64_t( MemWeight( mem.data[*fptr].Size() ) );
                 assert( usage >= 0 );
                 if( max < usage ) max = usage;
                 ptr->time = ftime;
@@ -6159,7 +6998,7 @@ void Worker::ReconstructMemAllocPlot()
     {
         assert( aptr->TimeFree() < 0 );
         int64_t time = aptr->TimeAlloc();
-        usage += int64_t( aptr->Size() );
+        usage += int64_t( MemWeight( aptr->Size() ) );
         assert( usage >= 0 );
         if( max < usage ) max = usage;
         ptr->time = time;
@@ -6171,7 +7010,7 @@ void Worker::ReconstructMemAllocPlot()
     {
         const auto& memData = mem.data[*fptr];
         int64_t time = memData.TimeFree();
-        usage -= int64_t( memData.Size() );
+        usage -= int64_t( MemWeight( memData.Size() ) );
         assert( usage >= 0 );
         assert( max >= usage );
         ptr->time = time;
@@ -6185,7 +7024,7 @@ void Worker::ReconstructMemAllocPlot()
 
     std::lock_guard<std::shared_mutex> lock( m_data.lock );
     m_data.plots.Data().insert( m_data.plots.Data().begin(), plot );
-    m_data.memory.plot = plot;
+    mem.plot = plot;
 }
 
 #ifndef TRACY_NO_STATISTICS
@@ -6677,6 +7516,8 @@ void Worker::ReadTimelinePre063( FileRead& f, Vector<short_ptr<ZoneEvent>>& _vec
             }
         }
         ZoneExtra extra;
+        extra.flowOut = 0;
+        extra.flowIn = 0;
         if( fileVer <= FileVersion( 0, 5, 7 ) )
         {
             __StringIdxOld str;
@@ -6834,6 +7675,14 @@ void Worker::Disconnect()
     m_disconnect = true;
 }
 
+void Worker::WriteStreamHeader( FileWrite& f, uint32_t protocolVersion, const WelcomeMessage& welcome, const OnDemandPayloadMessage* onDemand )
+{
+    f.Write( StreamHeader, sizeof( StreamHeader ) );
+    f.Write( &protocolVersion, sizeof( protocolVersion ) );
+    f.Write( &welcome, sizeof( welcome ) );
+    if( onDemand ) f.Write( onDemand, sizeof( *onDemand ) );
+}
+
 void Worker::Write( FileWrite& f )
 {
     f.Write( FileHeader, sizeof( FileHeader ) );
@@ -6845,6 +7694,7 @@ void Worker::Write( FileWrite& f )
     f.Write( &m_data.frameOffset, sizeof( m_data.frameOffset ) );
     f.Write( &m_pid, sizeof( m_pid ) );
     f.Write( &m_samplingPeriod, sizeof( m_samplingPeriod ) );
+    f.Write( &m_memSamplingInterval, sizeof( m_memSamplingInterval ) );
     f.Write( &m_data.cpuArch, sizeof( m_data.cpuArch ) );
     f.Write( &m_data.cpuId, sizeof( m_data.cpuId ) );
     f.Write( m_data.cpuManufacturer, 12 );
@@ -7010,6 +7860,7 @@ void Worker::Write( FileWrite& f )
         f.Write( &v.second->valid, sizeof( v.second->valid ) );
         f.Write( &v.second->timeAnnounce, sizeof( v.second->timeAnnounce ) );
         f.Write( &v.second->timeTerminate, sizeof( v.second->timeTerminate ) );
+        f.Write( &v.second->uncontended, sizeof( v.second->uncontended ) );
         sz = v.second->threadList.size();
         f.Write( &sz, sizeof( sz ) );
         for( auto& t : v.second->threadList )
@@ -7125,38 +7976,9 @@ void Worker::Write( FileWrite& f )
         }
     }
 
-    {
-        int64_t refTime = 0;
-        sz = m_data.memory.data.size();
-        f.Write( &sz, sizeof( sz ) );
-        sz = m_data.memory.active.size();
-        f.Write( &sz, sizeof( sz ) );
-        sz = m_data.memory.frees.size();
-        f.Write( &sz, sizeof( sz ) );
-        for( auto& mem : m_data.memory.data )
-        {
-            const auto ptr = mem.Ptr();
-            const auto size = mem.Size();
-            const Int24 csAlloc = mem.CsAlloc();
-            f.Write( &ptr, sizeof( ptr ) );
-            f.Write( &size, sizeof( size ) );
-            f.Write( &csAlloc, sizeof( csAlloc ) );
-            f.Write( &mem.csFree, sizeof( mem.csFree ) );
-
-            int64_t timeAlloc = mem.TimeAlloc();
-            uint16_t threadAlloc = mem.ThreadAlloc();
-            int64_t timeFree = mem.TimeFree();
-            uint16_t threadFree = mem.ThreadFree();
-            WriteTimeOffset( f, refTime, timeAlloc );
-            int64_t freeOffset = timeFree < 0 ? timeFree : timeFree - timeAlloc;
-            f.Write( &freeOffset, sizeof( freeOffset ) );
-            f.Write( &threadAlloc, sizeof( threadAlloc ) );
-            f.Write( &threadFree, sizeof( threadFree ) );
-        }
-        f.Write( &m_data.memory.high, sizeof( m_data.memory.high ) );
-        f.Write( &m_data.memory.low, sizeof( m_data.memory.low ) );
-        f.Write( &m_data.memory.usage, sizeof( m_data.memory.usage ) );
-    }
+    sz = m_data.memory.data.size();
+    f.Write( &sz, sizeof( sz ) );
+    WriteMemData( f, m_data.memory );
 
     sz = m_data.callstackPayload.size() - 1;
     f.Write( &sz, sizeof( sz ) );
@@ -7309,6 +8131,105 @@ void Worker::Write( FileWrite& f )
         f.Write( &v.second.len, sizeof( v.second.len ) );
         f.Write( v.second.data, v.second.len );
     }
+
+    sz = m_data.captureGaps.size();
+    f.Write( &sz, sizeof( sz ) );
+    f.Write( m_data.captureGaps.data(), sizeof( CaptureGap ) * sz );
+
+    sz = m_data.memNameMap.size() - 1;
+    f.Write( &sz, sizeof( sz ) );
+    for( auto& v : m_data.memNameMap )
+    {
+        if( v.first == 0 ) continue;
+        f.Write( &v.first, sizeof( v.first ) );
+        sz = v.second->data.size();
+        f.Write( &sz, sizeof( sz ) );
+        WriteMemData( f, *v.second );
+    }
+
+    sz = m_data.histograms.size();
+    f.Write( &sz, sizeof( sz ) );
+    for( auto& hist : m_data.histograms )
+    {
+        f.Write( &hist->name, sizeof( hist->name ) );
+        sz = hist->intervals.size();
+        f.Write( &sz, sizeof( sz ) );
+        const uint64_t esz = hist->entries.size();
+        f.Write( &esz, sizeof( esz ) );
+        f.Write( hist->intervals.data(), sizeof( HistogramInterval ) * sz );
+        f.Write( hist->entries.data(), sizeof( uint64_t ) * esz );
+    }
+
+    sz = m_data.flows.size();
+    f.Write( &sz, sizeof( sz ) );
+    f.Write( m_data.flows.data(), sizeof( FlowData ) * sz );
+
+    sz = m_data.waitMap.size();
+    f.Write( &sz, sizeof( sz ) );
+    for( auto& v : m_data.waitMap )
+    {
+        f.Write( &v.first, sizeof( v.first ) );
+        f.Write( &v.second->srcloc, sizeof( v.second->srcloc ) );
+        f.Write( &v.second->type, sizeof( v.second->type ) );
+        f.Write( &v.second->valid, sizeof( v.second->valid ) );
+        f.Write( &v.second->timeAnnounce, sizeof( v.second->timeAnnounce ) );
+        f.Write( &v.second->timeTerminate, sizeof( v.second->timeTerminate ) );
+        sz = v.second->threadData.size();
+        f.Write( &sz, sizeof( sz ) );
+        for( auto& td : v.second->threadData )
+        {
+            f.Write( &td.first, sizeof( td.first ) );
+            sz = td.second.waits.size();
+            f.Write( &sz, sizeof( sz ) );
+            for( auto& wait : td.second.waits )
+            {
+                f.Write( &wait.start, sizeof( wait.start ) );
+                f.Write( &wait.end, sizeof( wait.end ) );
+                f.Write( &wait.notify, sizeof( wait.notify ) );
+                f.Write( &wait.waker, sizeof( wait.waker ) );
+                f.Write( &wait.timeout, sizeof( wait.timeout ) );
+            }
+            sz = td.second.notifies.size();
+            f.Write( &sz, sizeof( sz ) );
+            for( auto& notify : td.second.notifies )
+            {
+                f.Write( &notify.time, sizeof( notify.time ) );
+                f.Write( &notify.count, sizeof( notify.count ) );
+            }
+        }
+    }
+}
+
+void Worker::WriteMemData( FileWrite& f, const MemData& memdata )
+{
+    int64_t refTime = 0;
+    uint64_t sz = memdata.active.size();
+    f.Write( &sz, sizeof( sz ) );
+    sz = memdata.frees.size();
+    f.Write( &sz, sizeof( sz ) );
+    for( auto& mem : memdata.data )
+    {
+        const auto ptr = mem.Ptr();
+        const auto size = mem.Size();
+        const Int24 csAlloc = mem.CsAlloc();
+        f.Write( &ptr, sizeof( ptr ) );
+        f.Write( &size, sizeof( size ) );
+        f.Write( &csAlloc, sizeof( csAlloc ) );
+        f.Write( &mem.csFree, sizeof( mem.csFree ) );
+
+        int64_t timeAlloc = mem.TimeAlloc();
+        uint16_t threadAlloc = mem.ThreadAlloc();
+        int64_t timeFree = mem.TimeFree();
+        uint16_t threadFree = mem.ThreadFree();
+        WriteTimeOffset( f, refTime, timeAlloc );
+        int64_t freeOffset = timeFree < 0 ? timeFree : timeFree - timeAlloc;
+        f.Write( &freeOffset, sizeof( freeOffset ) );
+        f.Write( &threadAlloc, sizeof( threadAlloc ) );
+        f.Write( &threadFree, sizeof( threadFree ) );
+    }
+    f.Write( &memdata.high, sizeof( memdata.high ) );
+    f.Write( &memdata.low, sizeof( memdata.low ) );
+    f.Write( &memdata.usage, sizeof( memdata.usage ) );
 }
 
 void Worker::WriteTimeline( FileWrite& f, const Vector<short_ptr<ZoneEvent>>& vec, int64_t& refTime )
@@ -7400,6 +8321,7 @@ static const char* s_failureReasons[] = {
     "Zone is ended twice.",
     "Zone text transfer destination doesn't match active zone.",
     "Zone name transfer destination doesn't match active zone.",
+    "Zone flow destination doesn't match active zone.",
     "Memory free event without a matching allocation.",
     "Discontinuous frame begin/end mismatch.",
     "Frame image offset is invalid.",
@@ -21,6 +21,7 @@
 #include "TracyShortPtr.hpp"
 #include "TracySlab.hpp"
 #include "TracyStringDiscovery.hpp"
+#include "TracySymbolCache.hpp"
 #include "TracyTextureCompression.hpp"
 #include "TracyThreadCompress.hpp"
 #include "TracyVarArray.hpp"
@@ -194,6 +195,8 @@ private:
 
     struct DataBlock
     {
+        DataBlock() { memNameMap.emplace( 0, &memory ); }
+
         std::shared_mutex lock;
         StringDiscovery<FrameData*> frames;
         FrameData* framesBase;
@@ -203,6 +206,7 @@ private:
         Vector<ThreadData*> threads;
         Vector<ZoneExtra> zoneExtra;
         MemData memory;
+        unordered_flat_map<uint64_t, MemData*> memNameMap;
         uint64_t zonesCnt = 0;
         uint64_t gpuCnt = 0;
         uint64_t samplesCnt = 0;
@@ -256,6 +260,7 @@ private:
 #endif
 
         unordered_flat_map<uint32_t, LockMap*> lockMap;
+        unordered_flat_map<uint32_t, WaitMap*> waitMap;
 
         ThreadCompress localThreadCompress;
         ThreadCompress externalThreadCompress;
@@ -307,6 +312,12 @@ private:
         unordered_flat_map<uint64_t, Vector<uint64_t>> locationCodeAddressList;
 
         unordered_flat_map<const char*, MemoryBlock, charutil::Hasher, charutil::Comparator> sourceFileCache;
+
+        Vector<CaptureGap> captureGaps;
+
+        Vector<HistogramData*> histograms;
+
+        Vector<FlowData> flows;
     };
 
     struct MbpsBlock
@@ -350,7 +361,33 @@ private:
         uint32_t csz;
     };
 
+    struct PendingFlow
+    {
+        bool out;
+        std::vector<uint32_t> idx;
+    };
+
 public:
+    struct ReplayStats
+    {
+        bool timing = false;        // measure processing time of each event type
+        uint64_t events = 0;
+        uint64_t bytes = 0;
+        int64_t time = 0;           // ns, excluding stream reads
+        size_t memPeak = 0;
+        uint64_t typeCount[(int)QueueType::NUM_TYPES] = {};
+        int64_t typeTime[(int)QueueType::NUM_TYPES] = {};
+    };
+
+    // Answers the queries of a replayed stream which does not carry them, such as a converted
+    // crash dump. The answer data is processed right after the frame which made the query.
+    class ReplayAnswers
+    {
+    public:
+        virtual ~ReplayAnswers() = default;
+        virtual void Answer( const ServerQueryPacket& query, std::vector<char>& data ) = 0;
+    };
+
     enum class Failure
     {
         None,
@@ -358,6 +395,7 @@ public:
         ZoneDoubleEnd,
         ZoneText,
         ZoneName,
+        ZoneFlow,
         MemFree,
         FrameEnd,
         FrameImageIndex,
@@ -366,9 +404,16 @@ public:
         NUM_FAILURES
     };
 
-    Worker( const char* addr, int port );
+    // If recording is set, the decompressed event stream is written to it. It must be finished by
+    // the caller, after the worker is no longer connected.
+    Worker( const char* addr, int port, FileWrite* recording = nullptr );
     Worker( const std::string& program, const std::vector<ImportEventTimeline>& timeline, const std::vector<ImportEventMessages>& messages );
     Worker( FileRead& f, EventType::Type eventMask = EventType::All, bool bgTasks = true );
+    // Processes a recorded event stream on the calling thread, without any connection. Queries are
+    // not sent, their answers are a part of the stream, or are provided by answers. Throws
+    // NotTracyDump if the file is not a recorded stream, or UnsupportedVersion with the protocol
+    // version of the stream.
+    Worker( FileRead& stream, ReplayStats& stats, ReplayAnswers* answers = nullptr );
     ~Worker();
 
     const std::string& GetAddr() const { return m_addr; }
@@ -392,6 +437,7 @@ public:
     uint64_t GetZoneExtraCount() const { return m_data.zoneExtra.size() - 1; }
     uint64_t GetGpuZoneCount() const { return m_data.gpuCnt; }
     uint64_t GetLockCount() const;
+    uint64_t GetWaitCount() const;
     uint64_t GetPlotCount() const;
     uint64_t GetTracyPlotCount() const;
     uint64_t GetContextSwitchCount() const;
@@ -415,6 +461,9 @@ public:
     uint64_t GetFrameOffset() const { return m_data.frameOffset; }
     const FrameData* GetFramesBase() const { return m_data.framesBase; }
     const Vector<FrameData*>& GetFrames() const { return m_data.frames.Data(); }
+    const Vector<CaptureGap>& GetCaptureGaps() const { return m_data.captureGaps; }
+    const Vector<HistogramData*>& GetHistograms() const { return m_data.histograms; }
+    const Vector<FlowData>& GetFlows() const { return m_data.flows; }
     const ContextSwitch* const GetContextSwitchData( uint64_t thread )
     {
         if( m_data.ctxSwitchLast.first == thread ) return m_data.ctxSwitchLast.second;
@@ -436,12 +485,16 @@ public:
     std::pair<int, int> GetFrameRange( const FrameData& fd, int64_t from, int64_t to );
 
     const unordered_flat_map<uint32_t, LockMap*>& GetLockMap() const { return m_data.lockMap; }
+    const unordered_flat_map<uint32_t, WaitMap*>& GetWaitMap() const { return m_data.waitMap; }
     const Vector<short_ptr<MessageData>>& GetMessages() const { return m_data.messages; }
     const Vector<GpuCtxData*>& GetGpuData() const { return m_data.gpuData; }
     const Vector<PlotData*>& GetPlots() const { return m_data.plots.Data(); }
     const Vector<ThreadData*>& GetThreadData() const { return m_data.threads; }
     const ThreadData* GetThreadData( uint64_t tid ) const;
-    const MemData& GetMemData() const { return m_data.memory; }
+    const MemData& GetMemData( uint64_t name = 0 ) const;
+    const unordered_flat_map<uint64_t, MemData*>& GetMemNameMap() const { return m_data.memNameMap; }
+    uint64_t GetMemSamplingInterval() const { return m_memSamplingInterval; }
+    uint64_t MemWeight( uint64_t size ) const;
     const Vector<short_ptr<FrameImage>>& GetFrameImages() const { return m_data.frameImage; }
     const Vector<StringRef>& GetAppInfo() const { return m_data.appInfo; }
 
@@ -521,8 +574,10 @@ public:
     std::shared_mutex& GetMbpsDataLock() { return m_mbpsData.lock; }
     const std::vector<float>& GetMbpsData() const { return m_mbpsData.mbps; }
     float GetCompRatio() const { return m_mbpsData.compRatio; }
+    NetworkCodec GetNetworkCodec() const { return m_netCodec; }
     size_t GetSendQueueSize() const { return m_mbpsData.queue; }
     size_t GetSendInFlight() const { return m_serverQuerySpaceBase - m_serverQuerySpaceLeft; }
+    // Returns nullptr if the client hasn't reported the stat.
     uint64_t GetDataTransferred() const { return m_mbpsData.transferred; }
 
     bool HasData() const { return m_hasData.load( std::memory_order_acquire ); }
@@ -533,6 +588,9 @@ public:
     void Disconnect();
 
     void Write( FileWrite& f );
+    // Starts a recorded event stream. Frames follow, each preceded by its 32-bit size, and the
+    // stream ends with a zero size.
+    static void WriteStreamHeader( FileWrite& f, uint32_t protocolVersion, const WelcomeMessage& welcome, const OnDemandPayloadMessage* onDemand );
     int GetTraceVersion() const { return m_traceVersion; }
     uint8_t GetHandshakeStatus() const { return m_handshake.load( std::memory_order_relaxed ); }
     int64_t GetSamplingPeriod() const { return m_samplingPeriod; }
@@ -558,6 +616,9 @@ public:
 private:
     void Network();
     void Exec();
+    void HandleWelcome( const WelcomeMessage& welcome );
+    void HandleOnDemandPayload( const OnDemandPayloadMessage& onDemand );
+    void HandleFrameEnd();
     void Query( ServerQuery type, uint64_t data, uint32_t extra = 0 );
     void QueryTerminate();
 
@@ -568,6 +629,8 @@ private:
     tracy_force_inline void ProcessZoneBeginCallstack( const QueueZoneBegin& ev );
     tracy_force_inline void ProcessZoneBeginAllocSrcLoc( const QueueZoneBeginLean& ev );
     tracy_force_inline void ProcessZoneBeginAllocSrcLocCallstack( const QueueZoneBeginLean& ev );
+    tracy_force_inline void ProcessZoneBeginInternedSrcLoc( const QueueZoneBegin& ev );
+    tracy_force_inline void ProcessZoneBeginInternedSrcLocCallstack( const QueueZoneBegin& ev );
     tracy_force_inline void ProcessZoneEnd( const QueueZoneEnd& ev );
     tracy_force_inline void ProcessZoneValidation( const QueueZoneValidation& ev );
     tracy_force_inline void ProcessFrameMark( const QueueFrameMark& ev );
@@ -577,6 +640,7 @@ private:
     tracy_force_inline void ProcessZoneText( const QueueZoneText& ev );
     tracy_force_inline void ProcessZoneName( const QueueZoneText& ev );
     tracy_force_inline void ProcessZoneValue( const QueueZoneValue& ev );
+    tracy_force_inline void ProcessZoneFlow( const QueueZoneFlow& ev, bool out );
     tracy_force_inline void ProcessLockAnnounce( const QueueLockAnnounce& ev );
     tracy_force_inline void ProcessLockTerminate( const QueueLockTerminate& ev );
     tracy_force_inline void ProcessLockWait( const QueueLockWait& ev );
@@ -587,8 +651,16 @@ private:
     tracy_force_inline void ProcessLockSharedRelease( const QueueLockRelease& ev );
     tracy_force_inline void ProcessLockMark( const QueueLockMark& ev );
     tracy_force_inline void ProcessLockName( const QueueLockName& ev );
+    tracy_force_inline void ProcessLockUncontended( const QueueLockUncontended& ev );
+    WaitMap& GetWaitMapEntry( uint32_t id );
+    tracy_force_inline void ProcessWaitAnnounce( const QueueWaitAnnounce& ev );
+    tracy_force_inline void ProcessWaitTerminate( const QueueWaitTerminate& ev );
+    tracy_force_inline void ProcessWaitBegin( const QueueWaitBegin& ev );
+    tracy_force_inline void ProcessWaitEnd( const QueueWaitEnd& ev );
+    tracy_force_inline void ProcessWaitNotify( const QueueWaitNotify& ev );
     tracy_force_inline void ProcessPlotData( const QueuePlotData& ev );
     tracy_force_inline void ProcessPlotConfig( const QueuePlotConfig& ev );
+    tracy_force_inline void ProcessHistogram( const QueueHistogramLean& ev );
     tracy_force_inline void ProcessMessage( const QueueMessage& ev );
     tracy_force_inline void ProcessMessageLiteral( const QueueMessage& ev );
     tracy_force_inline void ProcessMessageColor( const QueueMessageColor& ev );
@@ -603,8 +675,8 @@ private:
     tracy_force_inline void ProcessGpuZoneBeginCallstack( const QueueGpuZoneBegin& ev, bool serial );
     tracy_force_inline void ProcessGpuZoneEnd( const QueueGpuZoneEnd& ev, bool serial );
     tracy_force_inline void ProcessGpuTime( const QueueGpuTime& ev );
-    tracy_force_inline void ProcessMemAlloc( const QueueMemAlloc& ev );
-    tracy_force_inline bool ProcessMemFree( const QueueMemFree& ev );
+    tracy_force_inline void ProcessMemAlloc( MemData& memdata, const QueueMemAlloc& ev );
+    tracy_force_inline bool ProcessMemFree( MemData& memdata, const QueueMemFree& ev );
     tracy_force_inline void ProcessMemAllocCallstack( const QueueMemAlloc& ev );
     tracy_force_inline void ProcessMemFreeCallstack( const QueueMemFree& ev );
     tracy_force_inline void ProcessCallstackMemory();
@@ -622,16 +694,22 @@ private:
     tracy_force_inline void ProcessTidToPid( const QueueTidToPid& ev );
     tracy_force_inline void ProcessParamSetup( const QueueParamSetup& ev );
     tracy_force_inline void ProcessCpuTopology( const QueueCpuTopology& ev );
+    tracy_force_inline void ProcessCaptureStart( const QueueCaptureWindow& ev );
+    tracy_force_inline void ProcessCaptureStop( const QueueCaptureWindow& ev );
+    tracy_force_inline void ProcessMemNamePayload( const QueueMemNamePayload& ev );
+    tracy_force_inline void ProcessModuleInfo( const QueueModuleInfo& ev );
 
     tracy_force_inline ZoneEvent* AllocZoneEvent();
     tracy_force_inline void ProcessZoneBeginImpl( ZoneEvent* zone, const QueueZoneBegin& ev );
     tracy_force_inline void ProcessZoneBeginAllocSrcLocImpl( ZoneEvent* zone, const QueueZoneBeginLean& ev );
+    tracy_force_inline void SetInternedSourceLocation( uint64_t ptr );
     tracy_force_inline void ProcessGpuZoneBeginImpl( GpuEvent* zone, const QueueGpuZoneBegin& ev, bool serial );
 
     void ZoneStackFailure( uint64_t thread, const ZoneEvent* ev );
     void ZoneDoubleEndFailure( uint64_t thread, const ZoneEvent* ev );
     void ZoneTextFailure( uint64_t thread );
     void ZoneNameFailure( uint64_t thread );
+    void ZoneFlowFailure( uint64_t thread );
     void MemFreeFailure( uint64_t thread );
     void FrameEndFailure();
     void FrameImageIndexFailure();
@@ -647,9 +725,11 @@ private:
     int16_t ShrinkSourceLocationReal( uint64_t srcloc );
     int16_t NewShrinkedSourceLocation( uint64_t srcloc );
 
-    tracy_force_inline void MemAllocChanged( int64_t time );
-    void CreateMemAllocPlot();
-    void ReconstructMemAllocPlot();
+    tracy_force_inline void MemAllocChanged( MemData& mem, int64_t time );
+    MemData& GetMemPool();
+    void ReadMemEvents( FileRead& f, MemData& memdata, uint64_t sz );
+    void CreateMemAllocPlot( MemData& mem );
+    void ReconstructMemAllocPlot( MemData& mem );
 
     void InsertMessageData( MessageData* msg );
 
@@ -692,7 +772,11 @@ private:
     void CheckExternalName( uint64_t id );
 
     void AddSourceLocation( const QueueSourceLocation& srcloc );
+    void FillSourceLocation( SourceLocation& dst, const QueueSourceLocation& srcloc );
     void AddSourceLocationPayload( uint64_t ptr, const char* data, size_t sz );
+    void AddInternedSourceLocationPayload( uint64_t ptr, const char* data, size_t sz );
+    void AddStaticSourceLocationPayload( uint64_t ptr, const char* data, size_t sz );
+    void AddStaticString( uint64_t ptr, const char* str, size_t sz );
 
     void AddString( uint64_t ptr, const char* str, size_t sz );
     void AddThreadString( uint64_t id, const char* str, size_t sz );
@@ -701,9 +785,14 @@ private:
     void AddExternalThreadName( uint64_t ptr, const char* str, size_t sz );
     void AddFrameImageData( uint64_t ptr, const char* data, size_t sz );
     void AddSymbolCode( uint64_t ptr, const char* data, size_t sz );
+    void AddHistogramData( const char* data, size_t sz );
 
     tracy_force_inline void AddCallstackPayload( uint64_t ptr, const char* data, size_t sz );
     tracy_force_inline void AddCallstackAllocPayload( uint64_t ptr, const char* data, size_t sz );
+    void QueryCallstackFrame( CallstackFrameId frame );
+    bool AddCachedCallstackFrame( CallstackFrameId frame );
+    void AddCallstackSubframe( CallstackFrameData* data, uint8_t idx, uint64_t ptr, StringIdx name, StringIdx file, uint32_t line, uint64_t symAddr, uint32_t symLen );
+    void AddSymbolInformation( uint64_t symAddr, const SymbolPending& pending, StringIdx file, uint32_t line );
 
     void InsertPlot( PlotData* plot, int64_t time, double val );
     void HandlePlotName( uint64_t name, const char* str, size_t sz );
@@ -759,6 +848,7 @@ private:
     void ReadTimeline( FileRead& f, Vector<short_ptr<GpuEvent>>& vec, uint64_t size, int64_t& refTime, int64_t& refGpuTime, int32_t& childIdx );
     void ReadTimelinePre0510( FileRead& f, Vector<short_ptr<GpuEvent>>& vec, uint64_t size, int64_t& refTime, int64_t& refGpuTime, int fileVer );
 
+    void WriteMemData( FileWrite& f, const MemData& memdata );
     tracy_force_inline void WriteTimeline( FileWrite& f, const Vector<short_ptr<ZoneEvent>>& vec, int64_t& refTime );
     tracy_force_inline void WriteTimeline( FileWrite& f, const Vector<short_ptr<GpuEvent>>& vec, int64_t& refTime, int64_t& refGpuTime );
     template<typename Adapter, typename V>
@@ -791,25 +881,34 @@ private:
     std::string m_hostInfo;
     uint64_t m_pid;
     int64_t m_samplingPeriod;
+    uint64_t m_memSamplingInterval = 0;
     bool m_terminate = false;
     bool m_crashed = false;
     bool m_disconnect = false;
     void* m_stream;     // LZ4_streamDecode_t*
+    void* m_zstdStream = nullptr;   // ZSTD_DStream*
+    NetworkCodec m_netCodec = NetworkCodecLz4;
     char* m_buffer;
     int m_bufferOffset;
     bool m_onDemand;
     bool m_ignoreMemFreeFaults;
+    bool m_replay = false;
+    ReplayAnswers* m_replayAnswers = nullptr;
+    FileWrite* m_recording = nullptr;
 
     short_ptr<GpuCtxData> m_gpuCtxMap[256];
     unordered_flat_map<uint64_t, StringLocation> m_pendingCustomStrings;
     uint64_t m_pendingCallstackPtr = 0;
     uint32_t m_pendingCallstackId;
     int16_t m_pendingSourceLocationPayload = 0;
+    unordered_flat_map<uint64_t, int16_t> m_internedSourceLocationMap;
     Vector<uint64_t> m_sourceLocationQueue;
     unordered_flat_map<uint64_t, int16_t> m_sourceLocationShrink;
     unordered_flat_map<uint64_t, ThreadData*> m_threadMap;
     unordered_flat_map<uint64_t, NextCallstack> m_nextCallstack;
     FrameImagePending m_pendingFrameImageData = {};
+    Vector<uint64_t> m_pendingHistogramData;
+    unordered_flat_map<uint64_t, PendingFlow> m_pendingFlows;
     unordered_flat_map<uint64_t, SymbolPending> m_pendingSymbols;
     unordered_flat_set<uint64_t> m_pendingSymbolCode;
     unordered_flat_set<StringRef, StringRefHasher, StringRefComparator> m_pendingFileStrings;
@@ -825,11 +924,16 @@ private:
 
     CallstackFrameData* m_callstackFrameStaging;
     uint64_t m_callstackFrameStagingPtr;
+    bool m_symbolCacheStagingActive = false;
+    SymbolCache::FrameData m_symbolCacheStaging;
+    SymbolCache m_symbolCache;
     uint64_t m_callstackAllocNextIdx = 0;
     uint64_t m_callstackParentNextIdx = 0;
 
     uint64_t m_lastMemActionCallstack;
     bool m_lastMemActionWasAlloc;
+    MemData* m_lastMemActionPool = nullptr;
+    uint64_t m_memNamePayload = 0;
 
     Slab<64*1024*1024> m_slab;
 
@@ -3,10 +3,13 @@
 #endif
 
 #include <chrono>
+#include <memory>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string>
 
+#include "../../server/TracyCrashDump.hpp"
 #include "../../server/TracyFileRead.hpp"
 #include "../../server/TracyFileWrite.hpp"
 #include "../../server/TracyPrint.hpp"
@@ -26,9 +29,77 @@ void Usage()
     printf( "  --hc: enable LZ4HC compression\n" );
     printf( "  --extreme: enable extreme LZ4HC compression (very slow)\n" );
     printf( "  --zstd level: use Zstd compression with given compression level\n" );
+    printf( "\nInput may also be a crash dump, written by a client with TRACY_CRASH_DUMP set.\n" );
     exit( 1 );
 }
 
+void ConvertCrashDump( tracy::CrashDump& dump, const char* output, tracy::FileWrite::Compression clev, int zstdLevel )
+{
+    if( dump.GetProtocolVersion() != tracy::ProtocolVersion )
+    {
+        fprintf( stderr, "The crash dump was written by an incompatible client version.\n" );
+        exit( 1 );
+    }
+
+    printf( "Replaying crash dump...\r" );
+    fflush( stdout );
+    const auto t0 = std::chrono::high_resolution_clock::now();
+
+    // The dump is replayed as a recorded event stream, through a temporary file next to the output.
+    const auto streamPath = std::string( output ) + ".stream";
+    {
+        auto s = std::unique_ptr<tracy::FileWrite>( tracy::FileWrite::Open( streamPath.c_str() ) );
+        if( !s )
+        {
+            fprintf( stderr, "Cannot open temporary file %s!\n", streamPath.c_str() );
+            exit( 1 );
+        }
+        const auto ok = dump.WriteStream( *s );
+        s->Finish();
+        if( !ok )
+        {
+            remove( streamPath.c_str() );
+            fprintf( stderr, "Crash dump is damaged!\n" );
+            exit( 1 );
+        }
+    }
+
+    std::unique_ptr<tracy::Worker> worker;
+    try
+    {
+        auto s = std::unique_ptr<tracy::FileRead>( tracy::FileRead::Open( streamPath.c_str() ) );
+        if( s )
+        {
+            tracy::Worker::ReplayStats stats;
+            worker.reset( new tracy::Worker( *s, stats, &dump ) );
+        }
+    }
+    catch( const std::exception& )
+    {
+    }
+    remove( streamPath.c_str() );
+    if( !worker || !worker->HasData() )
+    {
+        fprintf( stderr, "Crash dump replay failed!\n" );
+        exit( 1 );
+    }
+
+    auto w = std::unique_ptr<tracy::FileWrite>( tracy::FileWrite::Open( output, clev, zstdLevel ) );
+    if( !w )
+    {
+        fprintf( stderr, "Cannot open output file!\n" );
+        exit( 1 );
+    }
+    printf( "Saving...              \r" );
+    fflush( stdout );
+    worker->Write( *w );
+    w->Finish();
+    const auto t1 = std::chrono::high_resolution_clock::now();
+
+    printf( "Crash dump -> %s (%i.%i.%i), %s zones, %s\n", output, tracy::Version::Major, tracy::Version::Minor, tracy::Version::Patch,
+        tracy::RealToString( worker->GetZoneCount() ), tracy::TimeToString( std::chrono::duration_cast<std::chrono::nanoseconds>( t1 - t0 ).count() ) );
+}
+
 int main( int argc, char** argv )
 {
 #ifdef _WIN32
@@ -75,6 +146,13 @@ int main( int argc, char** argv )
     const char* input = argv[1];
     const char* output = argv[2];
 
+    auto crashDump = std::unique_ptr<tracy::CrashDump>( tracy::CrashDump::Open( input ) );
+    if( crashDump )
+    {
+        ConvertCrashDump( *crashDump, output, clev, zstdLevel );
+        return 0;
+    }
+
     printf( "Loading...\r" );
     fflush( stdout );
     auto f = std::unique_ptr<tracy::FileRead>( tracy::FileRead::Open( input ) );